@@ -17,12 +17,16 @@ static Animation *animations;
 static gint num_anims;
 
 /* Internal functions */
-static Animation create_new_animation(char *filename);
+static Animation create_new_animation(char *filename, gboolean load_pixmaps);
 
 /* Create the animation database. Because this calls functions that call 
  * gdk_imlib_render, it assumes that you've pushed a visual and colormap. This
- * is currently handled in the init_canvas() function in gui.c */
-void init_animations(void) {
+ * is currently handled in the init_canvas() function in gui.c
+ *
+ * Without load_pixmaps, only the number of frames in each animation is found
+ * out, which is all that the game itself needs. This is for running games
+ * without a display */
+void init_animations(gboolean load_pixmaps) {
 	char *filename;
 	char **animloc;
 	Animation *anims;
@@ -34,7 +38,7 @@ void init_animations(void) {
 	anims = animations;
 	while(*animloc) {
 		filename = g_strdup_printf("%s/%s", PIXMAPDIR, *animloc);
-		*anims = create_new_animation(filename);
+		*anims = create_new_animation(filename, load_pixmaps);
 		g_assert(anims->num_frames);
 		g_assert(anims->pixmaps);
 		g_free(filename);
@@ -43,7 +47,7 @@ void init_animations(void) {
 	}
 }
 
-static Animation create_new_animation(char *filename) {
+static Animation create_new_animation(char *filename, gboolean load_pixmaps) {
 	Animation newanim;
 	char *fullfilename;
 	int i;
@@ -52,17 +56,19 @@ static Animation create_new_animation(char *filename) {
 	fullfilename = g_strdup_printf("%s.%d.png", filename, 0);
 	for(i = 0; g_file_test(fullfilename, G_FILE_TEST_EXISTS);) {
 		i++;
+		g_free(fullfilename);
 		fullfilename = g_strdup_printf("%s.%d.png", filename, i);
 	} 
 	if(!i)
 		gb_error("Cannot find animation pixmap %s", fullfilename);
+	g_free(fullfilename);
 
 	newanim.num_frames = i;
 
 	/* Now add each frame */
-	newanim.pixmaps = g_malloc(newanim.num_frames *
+	newanim.pixmaps = g_malloc0(newanim.num_frames *
 			sizeof(GdkPixbuf *));
-	for(i = 0; i < newanim.num_frames; i++) {
+	for(i = 0; load_pixmaps && i < newanim.num_frames; i++) {
 		fullfilename = g_strdup_printf("%s.%d.png", filename, i);
                 GError *gerror = NULL;
 		newanim.pixmaps[i] = gdk_pixbuf_new_from_file(fullfilename,
@@ -71,6 +77,7 @@ static Animation create_new_animation(char *filename) {
 			gb_error("Cannot open %s: %s", fullfilename,
                                 gerror->message);
 		}
+		g_free(fullfilename);
                 /*
 		gdk_imlib_render(newanim.pixmaps[i],
 				newanim.pixmaps[i]->rgb_width,
@@ -129,6 +136,37 @@ Animation get_loop_animation(gint id) {
 	return newanim;
 }
 
+/* Returns which animation an animation is a copy of, or -1 if it isn't one.
+ * This is how animations are saved, see savegame.c */
+gint animation_id(Animation *animation) {
+	gint i;
+
+	for(i = 0; i < num_anims; i++) {
+		if(animations[i].pixmaps == animation->pixmaps)
+			return i;
+	}
+
+	return -1;
+}
+
+/* Sets animation to be animation id, of type type and at frame frame_no, using
+ * the pixmaps that are already loaded. Returns FALSE if there's no such
+ * animation or frame */
+gboolean restore_animation(Animation *animation, gint id, AnimType type,
+		gint frame_no) {
+	if(id < 0 || id >= num_anims || frame_no < 0
+			|| frame_no >= animations[id].num_frames
+			|| (type != ANIM_STATIC && type != ANIM_LOOP
+				&& type != ANIM_ONCE))
+		return FALSE;
+
+	*animation = animations[id];
+	animation->type = type;
+	animation->frame_no = frame_no;
+
+	return TRUE;
+}
+
 /* Iterates an animation, and updates the canvas pixmap if necessary */
 void iterate_animation(Entity *entity) {
 
@@ -32,9 +32,12 @@
 #define ANIM_BLOCK_EXPLODE 21
 #define ANIM_BLOCK_EXPLODE_DIE 22
 
-void init_animations(void);
+void init_animations(gboolean load_pixmaps);
 Animation get_animation(gint id);
 Animation get_static_animation(gint id);
 Animation get_once_animation(gint id);
 Animation get_loop_animation(gint id);
+gint animation_id(Animation *animation);
+gboolean restore_animation(Animation *animation, gint id, AnimType type,
+		gint frame_no);
 void iterate_animation(Entity *entity);
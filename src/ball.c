@@ -18,20 +18,27 @@
 #include "game.h"
 #include "anim.h"
 #include "ball.h"
+#include "rng.h"
 #include "collision.h"
 #include "block.h"
+#include "memstats.h"
+#include "fixed.h"
 
 #define PI 3.14159265
 #define DEFAULT_DIRECTION PI
 #define FIRE1_DIRECTION (PI + PI / 4.0)
 #define FIRE2_DIRECTION (PI - PI / 4.0)
-#define MAX_AIRTIME 1000 /* Twenty seconds at 50 FPS */
+#define FIRE1_ANGLE ANGLE_DEGREES(225)
+#define FIRE2_ANGLE ANGLE_DEGREES(135)
 
 /* Internal Functions */
 static void iterate_ball_default(Game *game, Ball *ball);
 static void iterate_ball_stuck(Game *game, Ball *ball);
 static void ball_default_die(Game *game, Ball *ball);
 static GList *remove_ball(GList *balls, Ball *ball);
+static void randomise_direction(Game *game, Ball *ball);
+static void launch_ball(Game *game, Ball *ball, gdouble direction,
+		gint angle);
 
 /* Creates a new ball. ATM, we only have one per game, but the Game structure
  * is designed in such a way to allow multiple balls */
@@ -40,6 +47,7 @@ void new_ball_stuck(Game *game) {
 	gint x, y;
 
 	ball = g_malloc(sizeof(Ball));
+	memstats_add(MEM_BALL, sizeof(Ball));
 	g_assert(game->bat);
 	x = game->bat->geometry.x1 + BAT_WIDTH / 2;
 	y = game->bat->geometry.y1 - BALL_HEIGHT / 2;
@@ -58,6 +66,7 @@ void new_ball_stuck(Game *game) {
 	ball->direction = 0;
 
 	ball->type = BALL_STUCK;
+	ball->fixed_point = game->fixed_point;
 	add_to_canvas((Entity *) ball);
 	game->balls = g_list_prepend(game->balls, ball);
 }
@@ -66,6 +75,7 @@ void new_ball_stuck(Game *game) {
  * or hit some sort of "bad" block or somesuch. Will handle loss of life and
  * endgame */
 void ball_die(Game *game, Ball *ball) {
+	game->stats.balls_lost++;
 	switch(ball->type) {
 		case BALL_STUCK :
 		case BALL_DEFAULT :
@@ -84,6 +94,7 @@ static void ball_default_die(Game *game, Ball *ball) {
 static GList *remove_ball(GList *balls, Ball *ball) {
 	balls = g_list_remove(balls, ball);
 	remove_from_canvas((Entity *) ball);
+	memstats_remove(MEM_BALL, sizeof(Ball));
 	g_free(ball);
 
 	return balls;
@@ -149,21 +160,21 @@ static void iterate_ball_default(Game *game, Ball *ball) {
 		if(ball->airtime < MAX_AIRTIME) {
 			ball->airtime++;
 		} else {
- 			ball->direction = (PI * 2.0 * rand() / RAND_MAX);  
-			ball->airtime = 0;
+			randomise_direction(game, ball);
 		}
 	
 		/* This is a bit of a hack, but it's the best way I can think
-		 * of to stop the stuck-in-block bug. */
+		 * of to stop the stuck-in-block bug. If there's no block to
+		 * blame, send the ball off somewhere else rather than leave
+		 * it where it is. */
 		if(old_x1 == ball->geometry.x1 
 				&& old_y1 == ball->geometry.y1
 				&& old_direction == ball->direction) {
 			block = find_block_from_position(game, (Entity *) ball);
-			if(block) {
+			if(block)
 				destroy_block(game, block);
-			} else {
-				g_assert_not_reached();
-			}
+			else
+				randomise_direction(game, ball);
 		}
 	}
 }
@@ -183,37 +194,96 @@ static void iterate_ball_stuck(Game *game, Ball *ball) {
 	update_canvas_position((Entity *) ball);
 
 	if(game->fire1_pressed) {
-		ball->type = BALL_DEFAULT;
-		ball->speed = game->flags->ball_initial_speed;
-		ball->direction = FIRE1_DIRECTION;
-		ball->airtime = 0;
+		launch_ball(game, ball, FIRE1_DIRECTION, FIRE1_ANGLE);
 		game->fire1_pressed = FALSE;
 	} else if (game->fire2_pressed) {
-		ball->type = BALL_DEFAULT;
-		ball->speed = game->flags->ball_initial_speed;
-		ball->direction = FIRE2_DIRECTION;
-		ball->airtime = 0;
+		launch_ball(game, ball, FIRE2_DIRECTION, FIRE2_ANGLE);
 		game->fire2_pressed = FALSE;
 	}
 }
 
-/* Moves the ball one frame */
+/* Points the ball in a random direction, picked from the angle table if
+ * it's a fixed point ball */
+static void randomise_direction(Game *game, Ball *ball) {
+	if(ball->fixed_point)
+		ball->direction = angle_to_radians(rng_range(&game->rng,
+				ANGLE_STEPS));
+	else
+		ball->direction = PI * 2.0 * rng_double(&game->rng);
+	ball->airtime = 0;
+}
+
+/* Sends a stuck ball off in direction, or angle if it's a fixed point
+ * ball */
+static void launch_ball(Game *game, Ball *ball, gdouble direction,
+		gint angle) {
+	ball->type = BALL_DEFAULT;
+	ball->speed = game->flags->ball_initial_speed;
+	ball->direction = direction;
+	if(ball->fixed_point) {
+		ball->speed = fixed_quantise(ball->speed);
+		ball->direction = angle_to_radians(angle);
+	}
+	ball->airtime = 0;
+}
+
+/* Moves the ball one frame. This is done for every ball on every tick, so
+ * a ball that isn't fixed point steps itself here rather than through
+ * ball_step */
 void move_ball(Ball *ball) {
-	ball->pseudo_x1 += ball->speed * sin(ball->direction);
-	ball->pseudo_y1 += ball->speed * cos(ball->direction);
+	gdouble dx, dy;
 
+	if(ball->fixed_point) {
+		ball_step(ball, &dx, &dy);
+		ball->pseudo_x1 += dx;
+		ball->pseudo_y1 += dy;
+	} else {
+		ball->pseudo_x1 += ball->speed * sin(ball->direction);
+		ball->pseudo_y1 += ball->speed * cos(ball->direction);
+	}
+	place_ball(ball);
+}
 
-	ball->geometry.x1 = (gint) ball->pseudo_x1;
-	ball->geometry.y1 = (gint) ball->pseudo_y1;
+/* Puts the ball where its pseudo values say it is. These are rounded
+ * down, not towards zero, so a ball just past the top or left wall is
+ * outside it */
+void place_ball(Ball *ball) {
+	ball->geometry.x1 = (gint) floor(ball->pseudo_x1);
+	ball->geometry.y1 = (gint) floor(ball->pseudo_y1);
 	ball->geometry.x2 = ball->geometry.x1 + BALL_WIDTH;
 	ball->geometry.y2 = ball->geometry.y1 + BALL_HEIGHT;
 	update_canvas_position((Entity *) ball);
 }
 
+/* Finds how far the ball moves in a frame. For a fixed point ball this
+ * comes from the sine table, and is a Q16.16 number, so adding it to the
+ * pseudo values is exact */
+void ball_step(Ball *ball, gdouble *dx, gdouble *dy) {
+	Fixed speed;
+	gint angle;
+
+	if(ball->fixed_point) {
+		speed = fixed_from_double(ball->speed);
+		angle = angle_from_radians(ball->direction);
+		*dx = fixed_to_double(fixed_mul(speed, fixed_sin(angle)));
+		*dy = fixed_to_double(fixed_mul(speed, fixed_cos(angle)));
+	} else {
+		*dx = ball->speed * sin(ball->direction);
+		*dy = ball->speed * cos(ball->direction);
+	}
+}
+
 /* Increases the speed of the ball */
 void increase_ball_speed(Game *game, Ball *ball) {
-	if(ball->speed < game->flags->ball_max_speed)
-		ball->speed += game->flags->ball_speed_increment;
+	if(ball->speed < game->flags->ball_max_speed) {
+		if(ball->fixed_point)
+			ball->speed = fixed_to_double(
+					fixed_from_double(ball->speed)
+					+ fixed_from_double(
+					game->flags->ball_speed_increment));
+		else
+			ball->speed += game->flags->ball_speed_increment;
+	}
 }
 
 /* Slows all of the balls down to half their initial speed */
@@ -226,6 +296,8 @@ void slow_balls(Game *game) {
 
 		if(ball->type != BALL_STUCK) {
 			ball->speed = game->flags->ball_initial_speed / 2;
+			if(ball->fixed_point)
+				ball->speed = fixed_quantise(ball->speed);
 		}
 	}
 }
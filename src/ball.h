@@ -7,10 +7,16 @@
  * "COPYING" for more details.
  */
 
+/* How long a ball may go without touching the bat before it's sent off in a
+ * random direction */
+#define MAX_AIRTIME 1000 /* Twenty seconds at 50 FPS */
+
 void new_ball_stuck(Game *game);
 void ball_die(Game *game, Ball *ball);
 void destroy_ball_list(GList *balls);
 void move_ball(Ball *ball);
+void place_ball(Ball *ball);
+void ball_step(Ball *ball, gdouble *dx, gdouble *dy);
 void iterate_balls(Game *game);
 void increase_ball_speed(Game *game, Ball *ball);
 void slow_balls(Game *game);
@@ -12,6 +12,7 @@
 #include "block.h"
 #include "anim.h"
 #include "gui.h"
+#include "memstats.h"
 
 #define LASER_SPEED 19
 #define LASER_WIDTH 15
@@ -37,13 +38,13 @@ static void move_bat(Game *game) {
         if(game->flags->keyboard_control) {
                 bat_move = game->keyboard_move;
                 if(bat->geometry.x1 + bat_move > 0
-                                && bat->geometry.x2 + bat_move < GAME_WIDTH) {
+                                && bat->geometry.x2 + bat_move < GAME_WIDTH(game->level)) {
                         bat->geometry.x1 += bat_move;
                         bat->geometry.x2 += bat_move;
                 } else {
-                        if(bat->geometry.x2 + bat_move >= GAME_WIDTH) {
-                                bat->geometry.x2 = GAME_WIDTH;
-                                bat->geometry.x1 = GAME_WIDTH - bat->width;
+                        if(bat->geometry.x2 + bat_move >= GAME_WIDTH(game->level)) {
+                                bat->geometry.x2 = GAME_WIDTH(game->level);
+                                bat->geometry.x1 = GAME_WIDTH(game->level) - bat->width;
                         } else {
                                 bat->geometry.x1 = 0;
                                 bat->geometry.x2 = bat->width;
@@ -53,8 +54,8 @@ static void move_bat(Game *game) {
                 bat_move = game->mouse_move;
                 if(bat_move < bat->width / 2)
                         bat_move = bat->width /2;
-                else if(bat_move > GAME_WIDTH - bat->width /2)
-                        bat_move = GAME_WIDTH - bat->width /2;
+                else if(bat_move > GAME_WIDTH(game->level) - bat->width /2)
+                        bat_move = GAME_WIDTH(game->level) - bat->width /2;
 
                 bat->geometry.x1 = bat_move - bat->width / 2;
                 bat->geometry.x2 = bat->geometry.x1 + bat->width;
@@ -70,20 +71,31 @@ void new_bat(Game *game) {
         g_assert(bat);
 
 	bat->width = BAT_WIDTH;
-        bat->geometry.y2 = GAME_HEIGHT - BLOCK_WALL_PADDING;
-        bat->geometry.y1 = bat->geometry.y2 - BAT_HEIGHT;
-        bat->geometry.x1 = GAME_WIDTH / 2 - bat->width / 2;
-        bat->geometry.x2 = bat->geometry.x1 + bat->width;
-        g_assert(bat->geometry.x1 > BLOCK_WALL_PADDING);
-        g_assert(bat->geometry.x2 < GAME_WIDTH - BLOCK_WALL_PADDING);
-
         bat->animation = get_static_animation(ANIM_BAT_DEFAULT);
 	bat->children = NULL;
-        add_to_canvas((Entity *) bat);
         bat->type = BAT_DEFAULT;
 	bat->num_lasers = 0;
+	bat->num_lasers_allowed = 0;
 
 	game->bat = bat;
+	place_bat(game);
+        add_to_canvas((Entity *) bat);
+}
+
+/* Puts the bat in the middle of the bottom of the current level. Levels can
+ * be different sizes, so this needs doing at each new level too */
+void place_bat(Game *game) {
+	Bat *bat;
+
+	bat = game->bat;
+        bat->geometry.y2 = GAME_HEIGHT(game->level) - BLOCK_WALL_PADDING;
+        bat->geometry.y1 = bat->geometry.y2 - BAT_HEIGHT;
+        bat->geometry.x1 = GAME_WIDTH(game->level) / 2 - bat->width / 2;
+        bat->geometry.x2 = bat->geometry.x1 + bat->width;
+        g_assert(bat->geometry.x1 > BLOCK_WALL_PADDING);
+        g_assert(bat->geometry.x2 < GAME_WIDTH(game->level) - BLOCK_WALL_PADDING);
+
+	update_canvas_position((Entity *) bat);
 }
 
 /* Iterates the bat */
@@ -235,6 +247,7 @@ static void iterate_bat_laser(Game *game) {
 			+ game->bat->width / 2;
 
 		laser = g_malloc(sizeof(Entity));
+		memstats_add(MEM_LASER, sizeof(Entity));
 		laser->geometry.x1 = bat_center - LASER_WIDTH / 2;
 		laser->geometry.x2 = laser->geometry.x1 + LASER_WIDTH;
 		laser->geometry.y2 = game->bat->geometry.y1;
@@ -252,6 +265,7 @@ void remove_child_laser(Bat *bat, Entity *child) {
 	remove_from_canvas(child);
 	bat->num_lasers--;
 	bat->children = g_list_remove(bat->children, child);
+	memstats_remove(MEM_LASER, sizeof(Entity));
 	g_free(child);
 }
 
@@ -260,15 +274,15 @@ void destroy_children_laser(Bat *bat) {
 	GList *children;
 	Entity *laser;
 
-	children = bat->children;
-	while(children) {
+	for(children = bat->children; children;
+			children = g_list_next(children)) {
 		laser = (Entity *) children->data;
-		children = g_list_next(children);
-		g_list_remove(bat->children, laser);
 		remove_from_canvas(laser);
+		memstats_remove(MEM_LASER, sizeof(Entity));
 		g_free(laser);
 	}
 
+	g_list_free(bat->children);
 	bat->children = NULL;
 	bat->num_lasers = 0;
 }
@@ -9,6 +9,7 @@
 
 void iterate_bat(Game *game);
 void new_bat(Game *game);
+void place_bat(Game *game);
 void change_bat_type(Game *game, BatType type);
 void reset_bat_type(Game *game);
 void destroy_bat(Game *game);
@@ -0,0 +1,484 @@
+/*
+ * bench-collision: times the functions in collision.c, and the block lookup
+ * they lean on, over large sets of random balls in random levels, and checks
+ * the times against a baseline. Run it before and after changing any of
+ * them.
+ *
+ * Usage: bench-collision [-n calls] [-r repeats] [-s seed] [-l levels]
+ *                        [-i inputs] [-t tolerance] [-B baseline] [-w]
+ *
+ * The levels and balls are made from the seed, so every run times the same
+ * calls. Each function is called -n times, going round its -i inputs, and
+ * this is done -r times. Each of those runs takes turns, a slice at a time,
+ * with a reference loop that steps a copy of the ball over the same inputs
+ * without calling into the game. The function's time over the reference
+ * loop's is the run's ratio, and the median run's ratio counts. A slower or
+ * busier machine slows both down, so the ratio moves much less than the
+ * time does. ns_per_call is from the fastest run. For each function, prints
+ *   name=N ns_per_call=N calls_per_s=N ratio=N baseline_ratio=N change_pct=N
+ * where the last two are left out if the baseline doesn't have the function.
+ * The functions that change the ball they're given are timed on a fresh copy
+ * of it each call, and the copying is counted in their times.
+ * ball_block_collision is timed on copies of the levels in which every block
+ * is invincible, so that the levels don't change under it as it goes.
+ *
+ * The baseline file has a line for each function, of the form
+ *   name ratio
+ * and lines starting with # are ignored. With -B, the last line printed is
+ * result=pass, or result=fail if any function's ratio was more than -t
+ * percent over the baseline's, and the exit status is 1 on a fail. With -w
+ * as well, the baseline is written out from this run instead.
+ *
+ * Ratios still shift a little between compilers, libms and CPUs, as the
+ * reference loop doesn't use the memory the way the functions do. Run to
+ * run on one loaded machine they were seen to move by up to about 30%,
+ * hence the default -t of 40. If a different machine fails without any
+ * change to collision.c, write a baseline there from the unchanged code
+ * first, and compare against that.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "anim.h"
+#include "ball.h"
+#include "block.h"
+#include "collision.h"
+#include "flags.h"
+#include "leveldata.h"
+#include "levelparse.h"
+#include "rng.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define PI 3.14159265
+
+/* How many of the squares in a random level have a block in them, in
+ * percent */
+#define BLOCK_DENSITY 60
+
+/* How many pieces each repeat is timed in, taking turns with the reference
+ * loop */
+#define NUM_SLICES 16
+
+/* Internal Data Structures */
+typedef struct {
+	Level *level;
+	Ball ball;
+	Block *block; /* The block the ball is in, for the block cases */
+} Input;
+
+typedef struct {
+	const gchar *name;
+	void (*run)(Input *input);
+	GArray *inputs; /* Contains Inputs */
+	gdouble ns_per_call;
+	gdouble ratio; /* ns_per_call over the reference loop's */
+} Case;
+
+/* Internal Functions */
+static void make_levels(Rng *rng);
+static void random_ball(Rng *rng, Ball *ball, gdouble x1, gdouble y1,
+		gdouble x2, gdouble y2);
+static void make_inputs(Rng *rng, Case *cases);
+static gdouble time_calls(Case *bench, void (*run)(Input *input));
+static void time_case(Case *bench);
+static gint compare_doubles(const void *a, const void *b);
+static GHashTable *read_baseline(const gchar *filename);
+static gboolean write_baseline(const gchar *filename, Case *cases);
+static void run_reference(Input *input);
+static void run_find_block_from_position(Input *input);
+static void run_find_touched_blocks(Input *input);
+static void run_ball_block_contact(Input *input);
+static void run_ball_block_collision(Input *input);
+static void run_ball_wall_collision(Input *input);
+static void run_ball_bat_collision(Input *input);
+
+/* Internal Variables */
+static gint num_calls = 2000000;
+static gint slice_calls;
+static gint num_repeats = 5;
+static gint seed = 1;
+static gint num_levels = 64;
+static gint num_inputs = 65536;
+static gint tolerance = 40;
+static gchar *baseline_file = NULL;
+static gboolean write_out = FALSE;
+
+static Game game;
+static Bat bat;
+static Level **levels, **solid_levels;
+
+/* Keeps the results of the calls being timed from being thrown away */
+static volatile gint sink;
+
+static GOptionEntry options[] = {
+	{ "calls", 'n', 0, G_OPTION_ARG_INT, &num_calls,
+		"Calls to time of each function (default: 2000000)", "N" },
+	{ "repeats", 'r', 0, G_OPTION_ARG_INT, &num_repeats,
+		"Times to time each function, keeping the best (default: 5)",
+		"N" },
+	{ "seed", 's', 0, G_OPTION_ARG_INT, &seed,
+		"Seed for the levels and balls (default: 1)", "N" },
+	{ "levels", 'l', 0, G_OPTION_ARG_INT, &num_levels,
+		"Number of random levels (default: 64)", "N" },
+	{ "inputs", 'i', 0, G_OPTION_ARG_INT, &num_inputs,
+		"Number of random balls for each function (default: 65536)",
+		"N" },
+	{ "tolerance", 't', 0, G_OPTION_ARG_INT, &tolerance,
+		"How much slower than the baseline, in percent, fails "
+		"(default: 40)", "N" },
+	{ "baseline", 'B', 0, G_OPTION_ARG_FILENAME, &baseline_file,
+		"Baseline file to compare against", "FILE" },
+	{ "write", 'w', 0, G_OPTION_ARG_NONE, &write_out,
+		"Write the baseline file from this run instead", NULL },
+	{ NULL }
+};
+
+static Case cases[] = {
+	{ "find_block_from_position", run_find_block_from_position },
+	{ "find_touched_blocks", run_find_touched_blocks },
+	{ "ball_block_contact", run_ball_block_contact },
+	{ "ball_block_collision", run_ball_block_collision },
+	{ "ball_wall_collision", run_ball_wall_collision },
+	{ "ball_bat_collision", run_ball_bat_collision },
+	{ NULL }
+};
+
+int main(int argc, char **argv) {
+	GOptionContext *context;
+	GError *error = NULL;
+	GHashTable *baseline = NULL;
+	Rng rng;
+	Case *bench;
+	gdouble *baseline_ratio;
+	gboolean failed = FALSE;
+
+	context = g_option_context_new("- time the collision code");
+	g_option_context_add_main_entries(context, options, NULL);
+	if(!g_option_context_parse(context, &argc, &argv, &error)) {
+		g_printerr("%s\n", error->message);
+		return 2;
+	}
+	g_option_context_free(context);
+
+	if(num_calls < NUM_SLICES || num_repeats < 1 || num_levels < 1
+			|| num_inputs < 1) {
+		g_printerr("-n must be at least %d, and -r, -l and -i at "
+				"least 1\n", NUM_SLICES);
+		return 2;
+	}
+	slice_calls = num_calls / NUM_SLICES;
+	if(write_out && !baseline_file) {
+		g_printerr("-w needs a baseline file given with -B\n");
+		return 2;
+	}
+	if(baseline_file && !write_out) {
+		baseline = read_baseline(baseline_file);
+		if(!baseline)
+			return 1;
+	}
+
+	init_animations(FALSE);
+
+	game.flags = g_malloc0(sizeof(Flags));
+	game.flags->mouse_control = TRUE;
+	game.flags->bat_speed = MIN_BATSPEED;
+	game.flags->difficulty = DIFFICULTY_MEDIUM;
+	game.flags->next_game_difficulty = DIFFICULTY_MEDIUM;
+	compute_flags(game.flags);
+	rng_seed(&game.rng, seed);
+
+	rng_seed(&rng, seed);
+	make_levels(&rng);
+	make_inputs(&rng, cases);
+
+	for(bench = cases; bench->name; bench++) {
+		time_case(bench);
+		g_print("name=%s ns_per_call=%.2f calls_per_s=%.0f ratio=%.3f",
+				bench->name, bench->ns_per_call,
+				1e9 / bench->ns_per_call, bench->ratio);
+		baseline_ratio = baseline ? g_hash_table_lookup(baseline,
+				bench->name) : NULL;
+		if(baseline_ratio) {
+			g_print(" baseline_ratio=%.3f change_pct=%+.1f",
+					*baseline_ratio, (bench->ratio
+					/ *baseline_ratio - 1.0) * 100.0);
+			if(bench->ratio > *baseline_ratio
+					* (1.0 + tolerance / 100.0))
+				failed = TRUE;
+		}
+		g_print("\n");
+	}
+
+	if(write_out)
+		return write_baseline(baseline_file, cases) ? 0 : 1;
+	if(baseline) {
+		g_print("result=%s\n", failed ? "fail" : "pass");
+		return failed ? 1 : 0;
+	}
+
+	return 0;
+}
+
+/* Makes num_levels random levels, and a copy of each with every block made
+ * invincible */
+static void make_levels(Rng *rng) {
+	RawLevel *rawlevel;
+	gint i, j;
+
+	levels = g_new(Level *, num_levels);
+	solid_levels = g_new(Level *, num_levels);
+	for(i = 0; i < num_levels; i++) {
+		rawlevel = new_rawlevel(BLOCKS_X, BLOCKS_Y, 1, "Random",
+				"bench-collision", "Random");
+		rawlevel->blocks = g_malloc(sizeof(gchar) * BLOCKS_X * BLOCKS_Y);
+		for(j = 0; j < BLOCKS_X * BLOCKS_Y; j++) {
+			if(rng_range(rng, 100) < BLOCK_DENSITY)
+				rawlevel->blocks[j] = 1 + rng_range(rng,
+						MAX_BLOCK_CODE);
+			else
+				rawlevel->blocks[j] = BLOCK_NONE_CODE;
+		}
+		levels[i] = new_level(rawlevel);
+
+		for(j = 0; j < BLOCKS_X * BLOCKS_Y; j++) {
+			if(rawlevel->blocks[j] != BLOCK_NONE_CODE)
+				rawlevel->blocks[j] = BLOCK_INVINCIBLE_CODE;
+		}
+		solid_levels[i] = new_level(rawlevel);
+		free_rawlevel(rawlevel);
+	}
+
+	bat.width = BAT_WIDTH;
+	bat.geometry.y2 = GAME_HEIGHT(levels[0]) - BLOCK_WALL_PADDING;
+	bat.geometry.y1 = bat.geometry.y2 - BAT_HEIGHT;
+	bat.geometry.x1 = GAME_WIDTH(levels[0]) / 2 - bat.width / 2;
+	bat.geometry.x2 = bat.geometry.x1 + bat.width;
+}
+
+/* Sets up ball somewhere in the box x1, y1 to x2, y2, heading in any
+ * direction at any speed the game allows */
+static void random_ball(Rng *rng, Ball *ball, gdouble x1, gdouble y1,
+		gdouble x2, gdouble y2) {
+	memset(ball, 0, sizeof(Ball));
+	ball->type = BALL_DEFAULT;
+	ball->pseudo_x1 = x1 + rng_double(rng) * (x2 - x1);
+	ball->pseudo_y1 = y1 + rng_double(rng) * (y2 - y1);
+	ball->geometry.x1 = (gint) ball->pseudo_x1;
+	ball->geometry.y1 = (gint) ball->pseudo_y1;
+	ball->geometry.x2 = ball->geometry.x1 + BALL_WIDTH;
+	ball->geometry.y2 = ball->geometry.y1 + BALL_HEIGHT;
+	ball->direction = rng_double(rng) * 2.0 * PI;
+	ball->speed = game.flags->ball_initial_speed + rng_double(rng)
+		* (game.flags->ball_max_speed
+		   - game.flags->ball_initial_speed);
+}
+
+/* Fills in each case's inputs. ball_block_contact only gets balls that are
+ * in a block, as that's the only time the game calls it */
+static void make_inputs(Rng *rng, Case *cases) {
+	Case *bench;
+	Input input;
+	gint width, height, level_no;
+
+	width = GAME_WIDTH(levels[0]);
+	height = GAME_HEIGHT(levels[0]);
+
+	for(bench = cases; bench->name; bench++) {
+		bench->inputs = g_array_new(FALSE, FALSE, sizeof(Input));
+		while(bench->inputs->len < (guint) num_inputs) {
+			level_no = rng_range(rng, num_levels);
+			input.level = bench->run == run_ball_block_collision
+				? solid_levels[level_no] : levels[level_no];
+			input.block = NULL;
+			game.level = input.level;
+
+			if(bench->run == run_ball_wall_collision) {
+				random_ball(rng, &input.ball, -BALL_WIDTH,
+						-BALL_HEIGHT, width, height);
+			} else if(bench->run == run_ball_bat_collision) {
+				random_ball(rng, &input.ball,
+						bat.geometry.x1 - BALL_WIDTH * 2,
+						bat.geometry.y1 - BALL_HEIGHT * 2,
+						bat.geometry.x2 + BALL_WIDTH,
+						bat.geometry.y2 + BALL_HEIGHT);
+			} else {
+				random_ball(rng, &input.ball, 0, 0, width,
+						BLOCK_WALL_PADDING + BLOCKS_Y
+						* BLOCK_HEIGHT);
+			}
+
+			if(bench->run == run_ball_block_contact) {
+				input.block = find_block_from_position(&game,
+						(Entity *) &input.ball);
+				if(!input.block)
+					continue;
+			}
+
+			g_array_append_val(bench->inputs, input);
+		}
+	}
+}
+
+/* Returns how long a slice of calls of run on bench's inputs took, in
+ * nanoseconds per call */
+static gdouble time_calls(Case *bench, void (*run)(Input *input)) {
+	Input *inputs;
+	gint64 start;
+	gint i, j;
+
+	inputs = (Input *) bench->inputs->data;
+	start = now_ns();
+	for(i = 0, j = 0; i < slice_calls; i++) {
+		run(&inputs[j]);
+		if(++j == num_inputs)
+			j = 0;
+	}
+
+	return (gdouble) (now_ns() - start) / slice_calls;
+}
+
+/* Times bench num_repeats times, and fills in its fastest time per call
+ * and its median ratio to the reference loop. Each repeat is cut into
+ * NUM_SLICES slices, and each slice of bench is followed by one of the
+ * reference loop, so that both see the same machine */
+static void time_case(Case *bench) {
+	gdouble *ratios, ns, reference_ns, best = G_MAXDOUBLE;
+	gint repeat, slice;
+
+	ratios = g_new(gdouble, num_repeats);
+	for(repeat = 0; repeat < num_repeats; repeat++) {
+		ns = reference_ns = 0;
+		for(slice = 0; slice < NUM_SLICES; slice++) {
+			ns += time_calls(bench, bench->run);
+			reference_ns += time_calls(bench, run_reference);
+		}
+		best = MIN(best, ns / NUM_SLICES);
+		ratios[repeat] = ns / reference_ns;
+	}
+	qsort(ratios, num_repeats, sizeof(gdouble), compare_doubles);
+
+	bench->ns_per_call = best;
+	bench->ratio = ratios[num_repeats / 2];
+	g_free(ratios);
+}
+
+static gint compare_doubles(const void *a, const void *b) {
+	const gdouble *x = a, *y = b;
+
+	return *x < *y ? -1 : *x > *y;
+}
+
+/* Reads a baseline file into a table of name -> gdouble ratio.
+ * Returns NULL, having said why, if it can't be read */
+static GHashTable *read_baseline(const gchar *filename) {
+	GHashTable *baseline;
+	gchar *contents, **lines, name[64];
+	gdouble ratio, *value;
+	gint i;
+
+	if(!g_file_get_contents(filename, &contents, NULL, NULL)) {
+		g_printerr("Couldn't read baseline %s\n", filename);
+		return NULL;
+	}
+
+	baseline = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			g_free);
+	lines = g_strsplit(contents, "\n", -1);
+	for(i = 0; lines[i]; i++) {
+		if(lines[i][0] == '#' || lines[i][0] == '\0')
+			continue;
+		if(sscanf(lines[i], "%63s %lf", name, &ratio) != 2
+				|| ratio <= 0) {
+			g_printerr("%s:%d: Couldn't understand \"%s\"\n",
+					filename, i + 1, lines[i]);
+			g_hash_table_destroy(baseline);
+			baseline = NULL;
+			break;
+		}
+		value = g_new(gdouble, 1);
+		*value = ratio;
+		g_hash_table_insert(baseline, g_strdup(name), value);
+	}
+	g_strfreev(lines);
+	g_free(contents);
+
+	return baseline;
+}
+
+static gboolean write_baseline(const gchar *filename, Case *cases) {
+	GString *out;
+	Case *bench;
+	gboolean ok;
+
+	out = g_string_new("# Written by bench-collision -w. Each line is a "
+			"function and its time per call over the reference "
+			"loop's\n");
+	for(bench = cases; bench->name; bench++)
+		g_string_append_printf(out, "%s %.3f\n", bench->name,
+				bench->ratio);
+	ok = g_file_set_contents(filename, out->str, out->len, NULL);
+	if(!ok)
+		g_printerr("Couldn't write baseline %s\n", filename);
+	g_string_free(out, TRUE);
+
+	return ok;
+}
+
+/* Steps a copy of the ball, the way move_ball does, without calling into
+ * the game. The other functions are timed against this */
+static void run_reference(Input *input) {
+	Ball ball = input->ball;
+
+	ball.pseudo_x1 += ball.speed * sin(ball.direction);
+	ball.pseudo_y1 += ball.speed * cos(ball.direction);
+	sink = (gint) ball.pseudo_x1 + (gint) ball.pseudo_y1;
+}
+
+static void run_find_block_from_position(Input *input) {
+	game.level = input->level;
+	sink = find_block_from_position(&game, (Entity *) &input->ball)
+		!= NULL;
+}
+
+static void run_find_touched_blocks(Input *input) {
+	gint block_nos[MAX_TOUCHED_BLOCKS];
+
+	game.level = input->level;
+	sink = find_touched_blocks(&game, &input->ball, block_nos);
+}
+
+static void run_ball_block_contact(Input *input) {
+	Contact contact;
+
+	game.level = input->level;
+	sink = ball_block_contact(&game, input->block, &input->ball,
+			&contact);
+}
+
+static void run_ball_block_collision(Input *input) {
+	Ball ball = input->ball;
+
+	game.level = input->level;
+	sink = ball_block_collision(&game, &ball);
+}
+
+static void run_ball_wall_collision(Input *input) {
+	Ball ball = input->ball;
+
+	game.level = input->level;
+	sink = ball_wall_collision(&game, &ball);
+}
+
+static void run_ball_bat_collision(Input *input) {
+	Ball ball = input->ball;
+
+	sink = ball_bat_collision(&ball, &bat);
+}
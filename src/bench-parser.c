@@ -0,0 +1,446 @@
+/*
+ * bench-parser: times the levelfile parser and leveldata.c's index of the
+ * levels, over made up levelfiles of a given number of levels each. Run it
+ * before and after changing either of them.
+ *
+ * Usage: bench-parser [-c counts] [-m max] [-s seed] [-C comments]
+ *                     [-a gets] [-d directory] [-k]
+ *
+ * For each count in -c (comma separated, 1000,100000,1000000 by default) a
+ * levelfile of that many levels is written, made from the seed. The levels
+ * have their directives in any order, leave some out to get the defaults,
+ * and are sometimes other sizes than the default, and -C percent of the
+ * lines (10 by default) have a comment or a blank line before them. The file
+ * is then
+ *   - parsed on its own with levelparse_load, and freed again
+ *   - added with leveldata_add, which parses it and then rebuilds the sorted
+ *     list of levels, as happens when the game starts up
+ *   - read back with -a calls (10000 by default) to leveldata_get, in each of
+ *     the orders below, and removed again
+ * and for each file prints
+ *   levels=N bytes=N parse_ms=N parse_mb_per_s=N parse_levels_per_s=N
+ *   load_ms=N load_mb_per_s=N load_levels_per_s=N peak_rss_kb=N
+ * where the load_ numbers are for the whole of leveldata_add, and
+ * peak_rss_kb is the most memory the process had while parsing and adding
+ * the file. Then, for each order,
+ *   levels=N access=ORDER gets=N ns_per_get=N
+ * with the orders being
+ *   sequential  0, 1, 2, ... as a game goes through them
+ *   random      anywhere in the list
+ *   last        the last 16 levels, over and over
+ *
+ * leveldata.c builds its list of levels by walking it to find where each one
+ * goes, and walks it again for each leveldata_get, so both go up with the
+ * square of the number of levels: 100000 levels take minutes, and a million
+ * would take hours. Files of more than -m levels (100000 by default) are
+ * only parsed, and the load_ numbers and the access lines are left out for
+ * them.
+ *
+ * The files are written to -d (the temporary directory by default), and
+ * deleted afterwards unless -k is given.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "leveldata.h"
+#include "levelparse.h"
+#include "rng.h"
+#include "util.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* How many of the levels have a WIDTH and HEIGHT of their own, in percent */
+#define ODD_SIZE_PERCENT 20
+
+/* How many of the levels have no BEGIN_DATA, and so come out empty, in
+ * percent */
+#define NO_DATA_PERCENT 5
+
+/* How many levels at the end of the list the "last" order goes over */
+#define LAST_LEVELS 16
+
+/* Internal Data Structures */
+typedef enum {
+	ACCESS_SEQUENTIAL,
+	ACCESS_RANDOM,
+	ACCESS_LAST
+} AccessOrder;
+
+/* Internal Functions */
+static gboolean bench_count(gint count);
+static gboolean write_levelfile(const gchar *filename, gint count, Rng *rng);
+static void write_level(FILE *fp, gint level_no, Rng *rng);
+static void maybe_comment(FILE *fp, Rng *rng);
+static void write_words(FILE *fp, Rng *rng, gint max_words);
+static gdouble time_gets(AccessOrder order, Rng *rng);
+static void reset_peak_rss(void);
+static glong peak_rss_kb(void);
+
+/* Internal Variables */
+static gchar *counts_string = "1000,100000,1000000";
+static gint max_load = 100000;
+static gint seed = 1;
+static gint comment_percent = 10;
+static gint num_gets = 10000;
+static gchar *directory = NULL;
+static gboolean keep = FALSE;
+
+static GArray *counts; /* Contains gints */
+
+/* Keeps the results of the calls being timed from being thrown away */
+static volatile gint sink;
+
+static const gchar *access_names[] = { "sequential", "random", "last" };
+
+static const gchar *words[] = {
+	"Red", "Green", "Blue", "Wall", "Castle", "Ladder", "Maze", "Tower",
+	"Easy", "Hard", "Stripes", "Checks", "Arrow", "Face", "Bridge",
+	"Gate", "the", "of", "and", "Big", "Little", "Old", "New", "Last"
+};
+
+static GOptionEntry options[] = {
+	{ "counts", 'c', 0, G_OPTION_ARG_STRING, &counts_string,
+		"Levels in each levelfile, comma separated "
+		"(default: 1000,100000,1000000)", "N,N,..." },
+	{ "max-load", 'm', 0, G_OPTION_ARG_INT, &max_load,
+		"Only parse levelfiles of more levels than this "
+		"(default: 100000)", "N" },
+	{ "seed", 's', 0, G_OPTION_ARG_INT, &seed,
+		"Seed for the levelfiles (default: 1)", "N" },
+	{ "comments", 'C', 0, G_OPTION_ARG_INT, &comment_percent,
+		"Percentage of lines with a comment or blank line before them "
+		"(default: 10)", "N" },
+	{ "gets", 'a', 0, G_OPTION_ARG_INT, &num_gets,
+		"Calls to leveldata_get to time in each order "
+		"(default: 10000)", "N" },
+	{ "directory", 'd', 0, G_OPTION_ARG_FILENAME, &directory,
+		"Where to write the levelfiles (default: the temporary "
+		"directory)", "DIR" },
+	{ "keep", 'k', 0, G_OPTION_ARG_NONE, &keep,
+		"Don't delete the levelfiles afterwards", NULL },
+	{ NULL }
+};
+
+int main(int argc, char **argv) {
+	GOptionContext *context;
+	GError *error = NULL;
+	guint i;
+
+	context = g_option_context_new("- time the levelfile parser");
+	g_option_context_add_main_entries(context, options, NULL);
+	if(!g_option_context_parse(context, &argc, &argv, &error)) {
+		g_printerr("%s\n", error->message);
+		return 2;
+	}
+	g_option_context_free(context);
+
+	counts = parse_counts(counts_string);
+	if(!counts) {
+		g_printerr("-c must be a comma separated list of numbers of "
+				"levels, each at least 1\n");
+		return 2;
+	}
+	if(comment_percent < 0 || comment_percent > 100 || num_gets < 1) {
+		g_printerr("-C must be between 0 and 100, and -a at least 1\n");
+		return 2;
+	}
+	if(!directory)
+		directory = g_strdup(g_get_tmp_dir());
+
+	for(i = 0; i < counts->len; i++) {
+		if(!bench_count(g_array_index(counts, gint, i)))
+			return 1;
+	}
+
+	return 0;
+}
+
+/* Writes, times and deletes the levelfile of count levels. Returns FALSE,
+ * having said why, if the file couldn't be written or loaded */
+static gboolean bench_count(gint count) {
+	GList *levels = NULL, *warnings = NULL, *curr;
+	AccessOrder order;
+	Rng rng;
+	gchar *filename, *basename, *title = NULL, *added;
+	struct stat st;
+	gint64 start, parse_ns, load_ns;
+	gdouble ns_per_get;
+	gboolean ok = FALSE;
+
+	basename = g_strdup_printf("bench-parser-%d-%d.gbl", seed, count);
+	filename = g_build_filename(directory, basename, NULL);
+	g_free(basename);
+
+	rng_seed(&rng, seed);
+	if(!write_levelfile(filename, count, &rng))
+		goto out;
+	if(stat(filename, &st) < 0) {
+		g_printerr("Couldn't stat %s: %s\n", filename, strerror(errno));
+		goto out;
+	}
+
+	reset_peak_rss();
+
+	start = now_ns();
+	if(!levelparse_load(filename, &title, &levels, &warnings)) {
+		for(curr = warnings; curr; curr = g_list_next(curr))
+			g_printerr("%s\n", (gchar *) curr->data);
+		levelparse_free_warnings(warnings);
+		goto out;
+	}
+	parse_ns = now_ns() - start;
+	for(curr = levels; curr; curr = g_list_next(curr))
+		free_rawlevel((RawLevel *) curr->data);
+	g_list_free(levels);
+	g_free(title);
+	levelparse_free_warnings(warnings);
+
+	g_print("levels=%d bytes=%ld parse_ms=%.1f parse_mb_per_s=%.2f "
+			"parse_levels_per_s=%.0f", count, (glong) st.st_size,
+			parse_ns / 1e6, st.st_size / 1048576.0
+			/ (parse_ns / 1e9), count / (parse_ns / 1e9));
+	if(count > max_load) {
+		g_print(" peak_rss_kb=%ld\n", peak_rss_kb());
+		ok = TRUE;
+		goto out;
+	}
+
+	start = now_ns();
+	added = leveldata_add(filename);
+	load_ns = now_ns() - start;
+	if(!added) {
+		g_print("\n");
+		goto out;
+	}
+	g_print(" load_ms=%.1f load_mb_per_s=%.2f load_levels_per_s=%.0f "
+			"peak_rss_kb=%ld\n", load_ns / 1e6, st.st_size
+			/ 1048576.0 / (load_ns / 1e9),
+			count / (load_ns / 1e9), peak_rss_kb());
+
+	for(order = ACCESS_SEQUENTIAL; order <= ACCESS_LAST; order++) {
+		ns_per_get = time_gets(order, &rng);
+		g_print("levels=%d access=%s gets=%d ns_per_get=%.1f\n",
+				count, access_names[order], num_gets,
+				ns_per_get);
+	}
+
+	g_free(leveldata_remove(added));
+	ok = TRUE;
+
+out:
+	if(!keep)
+		unlink(filename);
+	g_free(filename);
+
+	return ok;
+}
+
+/* Writes out a levelfile of count levels. Returns FALSE, having said why,
+ * if it can't */
+static gboolean write_levelfile(const gchar *filename, gint count, Rng *rng) {
+	FILE *fp;
+	gint i;
+	gboolean ok;
+
+	fp = fopen(filename, "w");
+	if(!fp) {
+		g_printerr("Couldn't write %s: %s\n", filename,
+				strerror(errno));
+		return FALSE;
+	}
+
+	fprintf(fp, "# Written by bench-parser, %d levels from seed %d\n",
+			count, seed);
+	maybe_comment(fp, rng);
+	if(rng_range(rng, 2))
+		fprintf(fp, "GLOBAL_AUTHOR bench-parser\n");
+	maybe_comment(fp, rng);
+	if(rng_range(rng, 2))
+		fprintf(fp, "GLOBAL_DIFFICULTY %d\n", 1 + rng_range(rng, 5));
+	maybe_comment(fp, rng);
+	if(rng_range(rng, 2))
+		fprintf(fp, "GLOBAL_NAME Unnamed\n");
+	maybe_comment(fp, rng);
+	fprintf(fp, "TITLE Bench %d %d\n", seed, count);
+
+	for(i = 0; i < count; i++)
+		write_level(fp, i, rng);
+
+	ok = !ferror(fp);
+	if(fclose(fp) != 0)
+		ok = FALSE;
+	if(!ok)
+		g_printerr("Couldn't write %s: %s\n", filename,
+				strerror(errno));
+
+	return ok;
+}
+
+/* Writes out one level, with its directives in a random order */
+static void write_level(FILE *fp, gint level_no, Rng *rng) {
+	gint order[5] = { 0, 1, 2, 3, 4 };
+	gint width = BLOCKS_X, height = BLOCKS_Y;
+	gint i, j, tmp, x, y;
+
+	if(rng_range(rng, 100) < ODD_SIZE_PERCENT) {
+		width = MIN_BLOCKS_X + rng_range(rng, BLOCKS_X * 2
+				- MIN_BLOCKS_X);
+		height = MIN_BLOCKS_Y + rng_range(rng, BLOCKS_Y * 2
+				- MIN_BLOCKS_Y);
+	}
+	for(i = 4; i > 0; i--) {
+		j = rng_range(rng, i + 1);
+		tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+
+	maybe_comment(fp, rng);
+	fprintf(fp, "BEGIN_LEVEL\n");
+	for(i = 0; i < 5; i++) {
+		maybe_comment(fp, rng);
+		switch(order[i]) {
+			case 0:
+				if(rng_range(rng, 4)) {
+					fprintf(fp, "\tNAME ");
+					write_words(fp, rng, 4);
+					fprintf(fp, " %d\n", level_no);
+				}
+				break;
+			case 1:
+				if(rng_range(rng, 2)) {
+					fprintf(fp, "\tAUTHOR ");
+					write_words(fp, rng, 2);
+					fprintf(fp, "\n");
+				}
+				break;
+			case 2:
+				if(rng_range(rng, 4))
+					fprintf(fp, "\tDIFFICULTY %d\n",
+							1 + rng_range(rng, 10));
+				break;
+			case 3:
+				if(width != BLOCKS_X)
+					fprintf(fp, "\tWIDTH %d\n", width);
+				break;
+			case 4:
+				if(height != BLOCKS_Y)
+					fprintf(fp, "\tHEIGHT %d\n", height);
+				break;
+		}
+	}
+
+	if(rng_range(rng, 100) >= NO_DATA_PERCENT) {
+		maybe_comment(fp, rng);
+		fprintf(fp, "\tBEGIN_DATA\n");
+		for(y = 0; y < height; y++) {
+			maybe_comment(fp, rng);
+			fprintf(fp, "\t");
+			for(x = 0; x < width; x++) {
+				/* Mostly empty or plain blocks, like the
+				 * levels that come with the game */
+				j = rng_range(rng, 3) ? rng_range(rng, 2)
+					: rng_range(rng, MAX_BLOCK_CODE + 1);
+				fprintf(fp, x ? ",%d" : "%d", j);
+			}
+			fprintf(fp, "\n");
+		}
+		fprintf(fp, "\tEND_DATA\n");
+	}
+
+	maybe_comment(fp, rng);
+	fprintf(fp, "END_LEVEL\n");
+}
+
+/* Writes a comment or a blank line, comment_percent of the time */
+static void maybe_comment(FILE *fp, Rng *rng) {
+	if(rng_range(rng, 100) >= comment_percent)
+		return;
+
+	if(rng_range(rng, 4)) {
+		fprintf(fp, "# ");
+		write_words(fp, rng, 12);
+	}
+	fprintf(fp, "\n");
+}
+
+/* Writes between 1 and max_words words, separated by spaces */
+static void write_words(FILE *fp, Rng *rng, gint max_words) {
+	gint i, num_words;
+
+	num_words = 1 + rng_range(rng, max_words);
+	for(i = 0; i < num_words; i++)
+		fprintf(fp, i ? " %s" : "%s", words[rng_range(rng,
+					G_N_ELEMENTS(words))]);
+}
+
+/* Returns the time per call, in nanoseconds, of num_gets calls to
+ * leveldata_get in the given order */
+static gdouble time_gets(AccessOrder order, Rng *rng) {
+	gint *level_nums;
+	gint64 start, elapsed;
+	gint i, num_levels;
+
+	num_levels = leveldata_num_levels();
+	level_nums = g_new(gint, num_gets);
+	for(i = 0; i < num_gets; i++) {
+		switch(order) {
+			case ACCESS_SEQUENTIAL:
+				level_nums[i] = i % num_levels;
+				break;
+			case ACCESS_RANDOM:
+				level_nums[i] = rng_range(rng, num_levels);
+				break;
+			case ACCESS_LAST:
+				level_nums[i] = num_levels - 1
+					- i % MIN(LAST_LEVELS, num_levels);
+				break;
+		}
+	}
+
+	start = now_ns();
+	for(i = 0; i < num_gets; i++)
+		sink = leveldata_get(level_nums[i])->difficulty;
+	elapsed = now_ns() - start;
+	g_free(level_nums);
+
+	return (gdouble) elapsed / num_gets;
+}
+
+/* Starts peak_rss_kb counting again from what the process has now. Only
+ * Linux can do this; elsewhere the peak is for the whole run so far */
+static void reset_peak_rss(void) {
+	FILE *fp;
+
+	fp = fopen("/proc/self/clear_refs", "w");
+	if(fp) {
+		fputs("5", fp);
+		fclose(fp);
+	}
+}
+
+/* Returns the most memory the process has had resident, in kB, or -1 if
+ * that can't be found out */
+static glong peak_rss_kb(void) {
+	FILE *fp;
+	gchar line[256];
+	glong kb = -1;
+
+	fp = fopen("/proc/self/status", "r");
+	if(!fp)
+		return -1;
+	while(fgets(line, sizeof(line), fp)) {
+		if(sscanf(line, "VmHWM: %ld", &kb) == 1)
+			break;
+	}
+	fclose(fp);
+
+	return kb;
+}
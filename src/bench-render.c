@@ -0,0 +1,274 @@
+/*
+ * bench-render: times drawing frames of many moving, animating sprites
+ * through gui.h, to see how the drawing keeps up as the number of things on
+ * screen goes up. Run it on a virtual framebuffer, so that the timings don't
+ * depend on what else is on the desktop:
+ *
+ *   xvfb-run -s "-screen 0 1024x768x24" ./bench-render
+ *
+ * Usage: bench-render [-c counts] [-f frames] [-w warmup] [-s seed]
+ *
+ * For each count in -c (comma separated, 16,64,256,1024,4096 by default)
+ * that many sprites are put on the canvas, each showing one of the game's
+ * animations from init_animations, looping if it has more than one frame,
+ * and moving in a straight line, bouncing off the edges of the playing
+ * field. A frame is what iterate_game does for one tick: every sprite is
+ * moved and animated, then gui_update_game and process_gnome_events are
+ * called, and the frame is over once the X server has caught up. -w frames
+ * (30 by default) are run and thrown away, then -f frames (600 by default)
+ * are timed, and for each count prints
+ *   sprites=N frames=N mean_ms=N p50_ms=N p90_ms=N p99_ms=N max_ms=N
+ *   over_budget_pct=N
+ * where over_budget_pct is how many of the frames took longer than the
+ * game gives a frame, 1/FRAMES_PER_SECOND of a second.
+ *
+ * This times gui.c, the GnomeCanvas one. Another implementation of gui.h is
+ * timed the same way by building this against it in place of gui.c, and the
+ * two sets of lines compared count by count.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "anim.h"
+#include "block.h"
+#include "game.h"
+#include "gui.h"
+#include "leveldata.h"
+#include "levelparse.h"
+#include "rng.h"
+#include "util.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PI 3.14159265
+
+/* The animations the sprites are picked from: all of them */
+#define NUM_SPRITE_ANIMS (ANIM_BLOCK_EXPLODE_DIE + 1)
+
+/* Sprites move between 1 and this many pixels a frame */
+#define MAX_SPRITE_SPEED 8.0
+
+/* Internal Data Structures */
+typedef struct {
+	Entity entity;
+	gdouble x, y; /* Where the sprite is, more exactly than geometry */
+	gdouble dx, dy; /* How far it moves each frame */
+} Sprite;
+
+/* Internal Functions */
+static void bench_count(gint count, Rng *rng);
+static void add_sprite(Sprite *sprite, Rng *rng);
+static void move_sprite(Sprite *sprite);
+static gint64 draw_frame(Sprite *sprites, gint count);
+static gint compare_times(gconstpointer a, gconstpointer b);
+static gdouble percentile_ms(gint64 *times, gint num_times, gint percent);
+
+/* Internal Variables */
+static gchar *counts_string = "16,64,256,1024,4096";
+static gint num_frames = 600;
+static gint num_warmup = 30;
+static gint seed = 1;
+
+static GArray *counts; /* Contains gints */
+static Game game;
+
+static GOptionEntry options[] = {
+	{ "counts", 'c', 0, G_OPTION_ARG_STRING, &counts_string,
+		"Numbers of sprites to time, comma separated "
+		"(default: 16,64,256,1024,4096)", "N,N,..." },
+	{ "frames", 'f', 0, G_OPTION_ARG_INT, &num_frames,
+		"Frames to time for each number of sprites (default: 600)",
+		"N" },
+	{ "warmup", 'w', 0, G_OPTION_ARG_INT, &num_warmup,
+		"Frames to run before timing (default: 30)", "N" },
+	{ "seed", 's', 0, G_OPTION_ARG_INT, &seed,
+		"Seed for where the sprites go (default: 1)", "N" },
+	{ NULL }
+};
+
+int main(int argc, char **argv) {
+	GOptionContext *context;
+	GError *error = NULL;
+	RawLevel *rawlevel;
+	Rng rng;
+	guint i;
+
+	/* Our options come out of argv here, and GNOME's are left for
+	 * gnome_program_init */
+	context = g_option_context_new("- time drawing sprites");
+	g_option_context_add_main_entries(context, options, NULL);
+	g_option_context_set_ignore_unknown_options(context, TRUE);
+	if(!g_option_context_parse(context, &argc, &argv, &error)) {
+		g_printerr("%s\n", error->message);
+		return 2;
+	}
+	g_option_context_free(context);
+
+	counts = parse_counts(counts_string);
+	if(!counts) {
+		g_printerr("-c must be a comma separated list of numbers of "
+				"sprites, each at least 1\n");
+		return 2;
+	}
+	if(num_frames < 1 || num_warmup < 0) {
+		g_printerr("-f must be at least 1, and -w at least 0\n");
+		return 2;
+	}
+
+	memset(&game, 0, sizeof(Game));
+	game.time_scale = 1;
+	gnome_program_init(PACKAGE, VERSION, LIBGNOMEUI_MODULE, argc, argv,
+			GNOME_PARAM_NONE);
+	gui_init(&game, argc, argv);
+	init_animations(TRUE);
+
+	/* An empty level, so that the canvas is the size of a game's */
+	rawlevel = new_rawlevel(BLOCKS_X, BLOCKS_Y, 1, "bench-render",
+			"bench-render", "bench-render");
+	rawlevel->blocks = g_malloc0(sizeof(gchar) * BLOCKS_X * BLOCKS_Y);
+	game.level = new_level(rawlevel);
+	free_rawlevel(rawlevel);
+	gui_begin_game();
+	gui_new_level(game.level);
+	process_gnome_events();
+
+	rng_seed(&rng, seed);
+	for(i = 0; i < counts->len; i++)
+		bench_count(g_array_index(counts, gint, i), &rng);
+
+	return 0;
+}
+
+/* Puts count sprites on the canvas, times num_frames frames of them and
+ * takes them off again */
+static void bench_count(gint count, Rng *rng) {
+	Sprite *sprites;
+	gint64 *times, total = 0;
+	gint i, over_budget = 0;
+
+	sprites = g_new0(Sprite, count);
+	for(i = 0; i < count; i++)
+		add_sprite(&sprites[i], rng);
+
+	for(i = 0; i < num_warmup; i++)
+		draw_frame(sprites, count);
+
+	times = g_new(gint64, num_frames);
+	for(i = 0; i < num_frames; i++) {
+		times[i] = draw_frame(sprites, count);
+		total += times[i];
+		if(times[i] > 1000000000 / FRAMES_PER_SECOND)
+			over_budget++;
+	}
+	qsort(times, num_frames, sizeof(gint64), compare_times);
+
+	g_print("sprites=%d frames=%d mean_ms=%.3f p50_ms=%.3f p90_ms=%.3f "
+			"p99_ms=%.3f max_ms=%.3f over_budget_pct=%.1f\n",
+			count, num_frames, total / 1e6 / num_frames,
+			percentile_ms(times, num_frames, 50),
+			percentile_ms(times, num_frames, 90),
+			percentile_ms(times, num_frames, 99),
+			times[num_frames - 1] / 1e6,
+			over_budget * 100.0 / num_frames);
+
+	for(i = 0; i < count; i++)
+		remove_from_canvas(&sprites[i].entity);
+	process_gnome_events();
+	g_free(times);
+	g_free(sprites);
+}
+
+/* Sets sprite up as a random animation, somewhere on the playing field,
+ * heading in any direction, and puts it on the canvas */
+static void add_sprite(Sprite *sprite, Rng *rng) {
+	Entity *entity = &sprite->entity;
+	gdouble direction, speed;
+	gint width, height;
+
+	entity->animation = get_animation(rng_range(rng, NUM_SPRITE_ANIMS));
+	entity->animation.frame_no = rng_range(rng,
+			entity->animation.num_frames);
+	width = gdk_pixbuf_get_width(entity->animation.pixmaps[0]);
+	height = gdk_pixbuf_get_height(entity->animation.pixmaps[0]);
+
+	sprite->x = rng_double(rng) * (GAME_WIDTH(game.level) - width);
+	sprite->y = rng_double(rng) * (GAME_HEIGHT(game.level) - height);
+	direction = rng_double(rng) * 2.0 * PI;
+	speed = 1.0 + rng_double(rng) * (MAX_SPRITE_SPEED - 1.0);
+	sprite->dx = cos(direction) * speed;
+	sprite->dy = sin(direction) * speed;
+
+	entity->geometry.x1 = (gint) sprite->x;
+	entity->geometry.y1 = (gint) sprite->y;
+	entity->geometry.x2 = entity->geometry.x1 + width;
+	entity->geometry.y2 = entity->geometry.y1 + height;
+
+	add_to_canvas(entity);
+}
+
+/* Moves sprite along, bouncing it off the edges of the playing field */
+static void move_sprite(Sprite *sprite) {
+	Entity *entity = &sprite->entity;
+	gint width, height;
+
+	width = entity->geometry.x2 - entity->geometry.x1;
+	height = entity->geometry.y2 - entity->geometry.y1;
+
+	sprite->x += sprite->dx;
+	sprite->y += sprite->dy;
+	if(sprite->x < 0 || sprite->x > GAME_WIDTH(game.level) - width) {
+		sprite->dx = -sprite->dx;
+		sprite->x = CLAMP(sprite->x, 0,
+				GAME_WIDTH(game.level) - width);
+	}
+	if(sprite->y < 0 || sprite->y > GAME_HEIGHT(game.level) - height) {
+		sprite->dy = -sprite->dy;
+		sprite->y = CLAMP(sprite->y, 0,
+				GAME_HEIGHT(game.level) - height);
+	}
+
+	entity->geometry.x1 = (gint) sprite->x;
+	entity->geometry.y1 = (gint) sprite->y;
+	entity->geometry.x2 = entity->geometry.x1 + width;
+	entity->geometry.y2 = entity->geometry.y1 + height;
+}
+
+/* Draws one frame, the way iterate_game does, and returns how long it
+ * took in nanoseconds */
+static gint64 draw_frame(Sprite *sprites, gint count) {
+	gint64 start;
+	gint i;
+
+	start = now_ns();
+	for(i = 0; i < count; i++) {
+		move_sprite(&sprites[i]);
+		update_canvas_position(&sprites[i].entity);
+		iterate_animation(&sprites[i].entity);
+	}
+	gui_update_game(&game);
+	process_gnome_events();
+	gdk_flush();
+
+	return now_ns() - start;
+}
+
+static gint compare_times(gconstpointer a, gconstpointer b) {
+	gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Returns the time that percent of the sorted times are at or under, in
+ * milliseconds */
+static gdouble percentile_ms(gint64 *times, gint num_times, gint percent) {
+	gint i;
+
+	i = (num_times * percent + 99) / 100 - 1;
+
+	return times[CLAMP(i, 0, num_times - 1)] / 1e6;
+}
@@ -0,0 +1,321 @@
+/*
+ * bench-startup: starts the game over and over with --exit-after-paint, and
+ * sums up how long each part of starting up took (see startup.c). Needs a
+ * display, which can be a virtual one:
+ *
+ *   xvfb-run ./bench-startup
+ *
+ * Usage: bench-startup [-g game] [-n runs] [-c] [-s]
+ *
+ * The game (./gnome-breakout by default) is run -n times (10 by default).
+ * With -c, the page cache is emptied before each run, so that every start
+ * is a cold one that has to read the game and its libraries off the disk;
+ * this needs root. Otherwise the first run warms the cache up and is left
+ * out. For each part, prints
+ *   phase=NAME runs=N mean_ms=N p50_ms=N max_ms=N mean_majflt=N
+ * with a last one, phase=total, for the whole of starting up.
+ *
+ * With -s, the game is run under "strace -f", and each line also gets
+ *   mean_syscalls=N mean_opens=N
+ * counting every system call, and every open, openat or creat whether or
+ * not it found the file, made by any thread during the part. The trace is
+ * split into parts where startup.c opens /proc/self/io to take a mark, so
+ * the calls that take a mark count in the part after it, and the loading
+ * done before main is left out. strace slows everything down, so the times
+ * printed with -s are not worth much.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/* Internal Data Structures */
+typedef struct {
+	gchar *name;
+	GArray *ms; /* Contains gdoubles, one for each run */
+	gdouble total_majflt;
+	gdouble total_syscalls, total_opens; /* Only with -s */
+} Phase;
+
+/* Internal Functions */
+static gboolean drop_caches(void);
+static gboolean run_game(GPtrArray *phases);
+static gboolean count_trace(const gchar *path, GPtrArray *order);
+static Phase *find_phase(GPtrArray *phases, const gchar *name);
+static void print_phase(Phase *phase);
+static gint compare_doubles(gconstpointer a, gconstpointer b);
+
+/* Internal Variables */
+static gchar *game_path = "./gnome-breakout";
+static gint num_runs = 10;
+static gboolean cold = FALSE;
+static gboolean use_strace = FALSE;
+
+static GOptionEntry options[] = {
+	{ "game", 'g', 0, G_OPTION_ARG_FILENAME, &game_path,
+		"The game to start (default: ./gnome-breakout)", "FILE" },
+	{ "runs", 'n', 0, G_OPTION_ARG_INT, &num_runs,
+		"Times to start it (default: 10)", "N" },
+	{ "cold", 'c', 0, G_OPTION_ARG_NONE, &cold,
+		"Empty the page cache before each start. Needs root", NULL },
+	{ "strace", 's', 0, G_OPTION_ARG_NONE, &use_strace,
+		"Count each part's system calls and opens with strace", NULL },
+	{ NULL }
+};
+
+int main(int argc, char **argv) {
+	GOptionContext *context;
+	GError *error = NULL;
+	GPtrArray *phases, *warmup;
+	gint i;
+
+	context = g_option_context_new("- time starting the game up");
+	g_option_context_add_main_entries(context, options, NULL);
+	if(!g_option_context_parse(context, &argc, &argv, &error)) {
+		g_printerr("%s\n", error->message);
+		return 2;
+	}
+	g_option_context_free(context);
+
+	if(num_runs < 1) {
+		g_printerr("-n must be at least 1\n");
+		return 2;
+	}
+
+	/* A warm start needs something to have warmed the cache up */
+	if(!cold) {
+		warmup = g_ptr_array_new();
+		if(!run_game(warmup))
+			return 1;
+	}
+
+	phases = g_ptr_array_new();
+	for(i = 0; i < num_runs; i++) {
+		if(cold && !drop_caches())
+			return 1;
+		if(!run_game(phases))
+			return 1;
+	}
+
+	for(i = 0; i < (gint) phases->len; i++)
+		print_phase(g_ptr_array_index(phases, i));
+
+	return 0;
+}
+
+/* Writes everything out and throws the page cache away. Returns FALSE,
+ * having said why, if it can't */
+static gboolean drop_caches(void) {
+	FILE *fp;
+
+	sync();
+	fp = fopen("/proc/sys/vm/drop_caches", "w");
+	if(!fp || fputs("3\n", fp) == EOF || fclose(fp) != 0) {
+		g_printerr("Couldn't empty the page cache, -c needs root\n");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Starts the game once, and adds the times it prints to phases. Returns
+ * FALSE, having said why, if it didn't start up properly */
+static gboolean run_game(GPtrArray *phases) {
+	gchar *args[8], *out = NULL, **lines, name[64];
+	gchar *trace_path = NULL;
+	GError *error = NULL;
+	GPtrArray *order;
+	Phase *phase;
+	gdouble ms;
+	glong majflt;
+	gint status, i = 0, fd, found = 0;
+	gboolean ok;
+	gchar *p;
+
+	if(use_strace) {
+		fd = g_file_open_tmp("bench-startup-XXXXXX", &trace_path,
+				&error);
+		if(fd < 0) {
+			g_printerr("Couldn't make a file for the trace: %s\n",
+					error->message);
+			return FALSE;
+		}
+		close(fd);
+		args[i++] = "strace";
+		args[i++] = "-f";
+		args[i++] = "-qq";
+		args[i++] = "-o";
+		args[i++] = trace_path;
+	}
+	args[i++] = game_path;
+	args[i++] = "--exit-after-paint";
+	args[i] = NULL;
+	ok = g_spawn_sync(NULL, args, NULL, G_SPAWN_SEARCH_PATH, NULL, NULL,
+			&out, NULL, &status, &error);
+	if(!ok) {
+		g_printerr("Couldn't start %s: %s\n", args[0],
+				error->message);
+	} else if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		g_printerr("%s didn't exit cleanly\n", game_path);
+		ok = FALSE;
+	}
+	if(!ok) {
+		if(trace_path) {
+			unlink(trace_path);
+			g_free(trace_path);
+		}
+		g_free(out);
+		return FALSE;
+	}
+
+	order = g_ptr_array_new();
+	lines = g_strsplit(out, "\n", -1);
+	for(i = 0; lines[i]; i++) {
+		if(sscanf(lines[i], "startup phase=%63s ms=%lf", name, &ms)
+				!= 2)
+			continue;
+		phase = find_phase(phases, name);
+		g_ptr_array_add(order, phase);
+		g_array_append_val(phase->ms, ms);
+		p = strstr(lines[i], " majflt=");
+		if(p && sscanf(p, " majflt=%ld", &majflt) == 1)
+			phase->total_majflt += majflt;
+		found++;
+	}
+	g_strfreev(lines);
+	g_free(out);
+
+	ok = TRUE;
+	if(!found) {
+		g_printerr("%s didn't print any startup times\n", game_path);
+		ok = FALSE;
+	} else if(trace_path) {
+		ok = count_trace(trace_path, order);
+	}
+
+	if(trace_path) {
+		unlink(trace_path);
+		g_free(trace_path);
+	}
+	g_ptr_array_free(order, TRUE);
+
+	return ok;
+}
+
+/* Adds up the system calls and opens in the strace output at path, for each
+ * of the parts in order, which are as the game printed them, phase=total
+ * last. Returns FALSE, having said why, if the trace doesn't split up into
+ * those parts */
+static gboolean count_trace(const gchar *path, GPtrArray *order) {
+	gchar *contents, **lines, *call;
+	GError *error = NULL;
+	Phase *phase, *total;
+	gint i, mark = -1;
+	guint num_parts;
+	gdouble syscalls = 0, opens = 0;
+
+	if(!g_file_get_contents(path, &contents, NULL, &error)) {
+		g_printerr("Couldn't read the trace: %s\n", error->message);
+		return FALSE;
+	}
+
+	/* The marks are the top of main and the end of each part but the
+	 * total, so each mark starts the part after it */
+	num_parts = order->len - 1;
+	total = g_ptr_array_index(order, num_parts);
+
+	lines = g_strsplit(contents, "\n", -1);
+	for(i = 0; lines[i]; i++) {
+		/* Each line starts with the thread's pid. Signals, and the
+		 * second half of a call that another thread interrupted, are
+		 * not calls of their own */
+		call = lines[i] + strspn(lines[i], "0123456789");
+		call += strspn(call, " ");
+		if(!g_ascii_isalpha(*call))
+			continue;
+
+		if(strstr(call, "\"/proc/self/io\"")) {
+			if(mark >= 0 && mark < (gint) num_parts) {
+				phase = g_ptr_array_index(order, mark);
+				phase->total_syscalls += syscalls;
+				phase->total_opens += opens;
+				total->total_syscalls += syscalls;
+				total->total_opens += opens;
+			}
+			mark++;
+			syscalls = opens = 0;
+		}
+
+		syscalls++;
+		if(g_str_has_prefix(call, "open(")
+				|| g_str_has_prefix(call, "openat(")
+				|| g_str_has_prefix(call, "openat2(")
+				|| g_str_has_prefix(call, "creat("))
+			opens++;
+	}
+	g_strfreev(lines);
+	g_free(contents);
+
+	/* startup_begin's mark and one for each part */
+	if(mark != (gint) num_parts) {
+		g_printerr("Couldn't split the trace into the %u parts the "
+				"game printed\n", num_parts);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Returns the phase called name, adding it to the end of phases if it
+ * isn't there yet */
+static Phase *find_phase(GPtrArray *phases, const gchar *name) {
+	Phase *phase;
+	guint i;
+
+	for(i = 0; i < phases->len; i++) {
+		phase = g_ptr_array_index(phases, i);
+		if(!strcmp(phase->name, name))
+			return phase;
+	}
+
+	phase = g_malloc0(sizeof(Phase));
+	phase->name = g_strdup(name);
+	phase->ms = g_array_new(FALSE, FALSE, sizeof(gdouble));
+	g_ptr_array_add(phases, phase);
+
+	return phase;
+}
+
+static void print_phase(Phase *phase) {
+	gdouble *ms, total = 0;
+	guint i, n;
+
+	n = phase->ms->len;
+	ms = (gdouble *) phase->ms->data;
+	qsort(ms, n, sizeof(gdouble), compare_doubles);
+	for(i = 0; i < n; i++)
+		total += ms[i];
+
+	g_print("phase=%s runs=%u mean_ms=%.2f p50_ms=%.2f max_ms=%.2f "
+			"mean_majflt=%.1f", phase->name, n, total / n,
+			ms[(n - 1) / 2], ms[n - 1], phase->total_majflt / n);
+	if(use_strace)
+		g_print(" mean_syscalls=%.1f mean_opens=%.1f",
+				phase->total_syscalls / n,
+				phase->total_opens / n);
+	g_print("\n");
+}
+
+static gint compare_doubles(gconstpointer a, gconstpointer b) {
+	gdouble x = *(const gdouble *) a, y = *(const gdouble *) b;
+
+	return x < y ? -1 : x > y;
+}
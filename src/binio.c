@@ -0,0 +1,154 @@
+/*
+ * Reading and writing compact binary files. Integers are little endian, or
+ * LEB128 varints where they are usually small. Signed varints are zigzag
+ * encoded, so that small negative numbers are small too.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include <glib.h>
+#include <string.h>
+#include "binio.h"
+
+/* Longest string binio_get_string will accept */
+#define MAX_STRING_LENGTH 4096
+
+void binio_put_u8(GString *out, guint8 value) {
+	g_string_append_c(out, (gchar) value);
+}
+
+void binio_put_u32(GString *out, guint32 value) {
+	gint i;
+
+	for(i = 0; i < 4; i++)
+		g_string_append_c(out, (gchar) ((value >> (i * 8)) & 0xff));
+}
+
+void binio_put_varint(GString *out, guint64 value) {
+	while(value >= 0x80) {
+		g_string_append_c(out, (gchar) ((value & 0x7f) | 0x80));
+		value >>= 7;
+	}
+	g_string_append_c(out, (gchar) value);
+}
+
+void binio_put_svarint(GString *out, gint64 value) {
+	binio_put_varint(out, ((guint64) value << 1) ^ (guint64) (value >> 63));
+}
+
+/* Writes the exact bits of a double, so that it reads back identically */
+void binio_put_double(GString *out, gdouble value) {
+	guint64 bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	binio_put_u32(out, (guint32) bits);
+	binio_put_u32(out, (guint32) (bits >> 32));
+}
+
+/* Writes a length prefixed string. NULL is written as an empty string */
+void binio_put_string(GString *out, const gchar *string) {
+	gsize len;
+
+	len = string ? strlen(string) : 0;
+	binio_put_varint(out, len);
+	if(len)
+		g_string_append_len(out, string, len);
+}
+
+void binio_reader_init(BinReader *reader, const guchar *data, gsize len) {
+	reader->data = data;
+	reader->len = len;
+	reader->pos = 0;
+	reader->error = FALSE;
+}
+
+guint8 binio_get_u8(BinReader *reader) {
+	if(reader->error || reader->pos >= reader->len) {
+		reader->error = TRUE;
+		return 0;
+	}
+
+	return reader->data[reader->pos++];
+}
+
+guint32 binio_get_u32(BinReader *reader) {
+	guint32 ret = 0;
+	gint i;
+
+	for(i = 0; i < 4; i++)
+		ret |= (guint32) binio_get_u8(reader) << (i * 8);
+
+	return ret;
+}
+
+guint64 binio_get_varint(BinReader *reader) {
+	guint64 ret = 0;
+	guint8 byte;
+	gint shift;
+
+	for(shift = 0; shift < 64; shift += 7) {
+		byte = binio_get_u8(reader);
+		ret |= (guint64) (byte & 0x7f) << shift;
+		if(!(byte & 0x80))
+			return ret;
+	}
+
+	/* Too long to be a 64 bit number */
+	reader->error = TRUE;
+	return 0;
+}
+
+gint64 binio_get_svarint(BinReader *reader) {
+	guint64 value;
+
+	value = binio_get_varint(reader);
+	return (gint64) (value >> 1) ^ -(gint64) (value & 1);
+}
+
+gdouble binio_get_double(BinReader *reader) {
+	guint64 bits;
+	gdouble value;
+
+	bits = binio_get_u32(reader);
+	bits |= (guint64) binio_get_u32(reader) << 32;
+	memcpy(&value, &bits, sizeof(value));
+
+	return value;
+}
+
+/* Returns a newly allocated string, or NULL on an error */
+gchar *binio_get_string(BinReader *reader) {
+	const guchar *bytes;
+	guint64 len;
+
+	len = binio_get_varint(reader);
+	if(len > MAX_STRING_LENGTH) {
+		reader->error = TRUE;
+		return NULL;
+	}
+
+	bytes = binio_get_bytes(reader, (gsize) len);
+	if(!bytes)
+		return NULL;
+
+	return g_strndup((const gchar *) bytes, (gsize) len);
+}
+
+/* Returns a pointer to the next len bytes, which stay owned by the buffer,
+ * or NULL if there aren't that many */
+const guchar *binio_get_bytes(BinReader *reader, gsize len) {
+	const guchar *ret;
+
+	if(reader->error || len > reader->len - reader->pos) {
+		reader->error = TRUE;
+		return NULL;
+	}
+
+	ret = reader->data + reader->pos;
+	reader->pos += len;
+
+	return ret;
+}
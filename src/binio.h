@@ -0,0 +1,34 @@
+/*
+ * Reading and writing compact binary files
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+/* Reads from a buffer. Reading past the end, or anything else malformed, sets
+ * error and returns zeroes from then on, so callers need only check error
+ * once they're done */
+typedef struct {
+	const guchar *data;
+	gsize len;
+	gsize pos;
+	gboolean error;
+} BinReader;
+
+void binio_put_u8(GString *out, guint8 value);
+void binio_put_u32(GString *out, guint32 value);
+void binio_put_varint(GString *out, guint64 value);
+void binio_put_svarint(GString *out, gint64 value);
+void binio_put_double(GString *out, gdouble value);
+void binio_put_string(GString *out, const gchar *string);
+
+void binio_reader_init(BinReader *reader, const guchar *data, gsize len);
+guint8 binio_get_u8(BinReader *reader);
+guint32 binio_get_u32(BinReader *reader);
+guint64 binio_get_varint(BinReader *reader);
+gint64 binio_get_svarint(BinReader *reader);
+gdouble binio_get_double(BinReader *reader);
+gchar *binio_get_string(BinReader *reader);
+const guchar *binio_get_bytes(BinReader *reader, gsize len);
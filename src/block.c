@@ -13,10 +13,16 @@
 #include "leveldata.h"
 #include "gui.h"
 #include "block.h"
+#include "statehash.h"
+#include "memstats.h"
+#include "trace.h"
 
 /* Internal functions */
-static void remove_block(Block **blocks, Block *block);
-static Block *new_block(char type, gint block_no);
+static void remove_block(Level *level, Block *block);
+static Block *new_block(Level *level, char type, gint block_no);
+static Block *alloc_block(Level *level, gint block_no);
+static void activate_block(Level *level, Block *block);
+static void set_block_type(Level *level, Block *block, BlockType type);
 static void block_default_hit(Game *game, Block *block);
 static void block_strong_hit(Game *game, Block *block);
 static void iterate_block(Game *game, Block *block);
@@ -25,18 +31,37 @@ static Block **get_nearby_blocks(Game *game, Block *block);
 
 /* 
  * This function takes a levels.h level definition and transforms it into a
- * block list.
+ * block list, and puts the blocks on the canvas.
  */
-Level *generate_level(gint level_num) {
+Level *generate_level(RawLevel *rawlevel) {
+	Level *level;
+
+	level = new_level(rawlevel);
+	realize_level(level, level->width * level->height);
+	gui_show_layer(level->layer);
+
+	return level;
+}
+
+/* Builds the blocks of a level without touching the canvas, so that this is
+ * safe to call from a thread other than the GUI's. realize_level does the
+ * rest. */
+Level *new_level(RawLevel *rawlevel) {
 	Level *level;
-	RawLevel *rawlevel;
 	gint i; 
 
 	level = g_malloc(sizeof(Level));
 	level->blocks_left = 0;
-
-	rawlevel = leveldata_get(level_num);
-	for(i = 0; i < BLOCKS_TOTAL; i++) {
+	level->width = rawlevel->width;
+	level->height = rawlevel->height;
+	level->blocks = g_malloc(sizeof(Block *) * level->width * level->height);
+	level->active_blocks = NULL;
+	level->block_hash = 0;
+	level->layer = NULL;
+	level->realized = 0;
+	level->reaped = 0;
+
+	for(i = 0; i < level->width * level->height; i++) {
 		switch(rawlevel->blocks[i]) {
 			case BLOCK_STRONG_1_CODE :
 			case BLOCK_STRONG_2_CODE :
@@ -46,7 +71,7 @@ Level *generate_level(gint level_num) {
 				level->blocks_left++;
 				/* follow through */
 			case BLOCK_INVINCIBLE_CODE :
-				level->blocks[i] = new_block(rawlevel->blocks[i], i);
+				level->blocks[i] = new_block(level, rawlevel->blocks[i], i);
 				break;
 			case BLOCK_NONE_CODE :
 				level->blocks[i] = NULL;
@@ -61,32 +86,72 @@ Level *generate_level(gint level_num) {
 	level->name = g_strdup(rawlevel->name);
 	level->author = g_strdup(rawlevel->author);
 	level->levelfile_title = g_strdup(rawlevel->levelfile_title);
+	memstats_add_string(MEM_LEVEL_STRING, level->name);
+	memstats_add_string(MEM_LEVEL_STRING, level->author);
+	memstats_add_string(MEM_LEVEL_STRING, level->levelfile_title);
 	return level;
 }
 
-/* Make a new block of type at x/y */
-static Block *new_block(char type, gint block_no) {
-	Block *newblock;
-	gint x, y;
+/* Adds up to count more of a level's blocks to its canvas layer, which is
+ * created hidden if necessary. Returns TRUE once every block is on the
+ * canvas */
+gboolean realize_level(Level *level, gint count) {
+	gint total;
 
-	x = block_no % BLOCKS_X;
-	y = block_no / BLOCKS_X;
-	g_assert(y < BLOCKS_Y);
-	newblock = g_malloc(sizeof(Block));
+	total = level->width * level->height;
 
-	/* Set the geometry */
-	newblock->geometry.x1 = BLOCK_WALL_PADDING + BLOCK_WIDTH * x;
-	newblock->geometry.y1 = BLOCK_WALL_PADDING + BLOCK_HEIGHT * y;
-	newblock->geometry.x2 = newblock->geometry.x1 + BLOCK_WIDTH;
-	newblock->geometry.y2 = newblock->geometry.y1 + BLOCK_HEIGHT;
+	if(!level->layer)
+		level->layer = gui_new_layer();
 
-	g_assert(newblock->geometry.x1 >= BLOCK_WALL_PADDING);
-	g_assert(newblock->geometry.y1 >= BLOCK_WALL_PADDING);
-	g_assert(newblock->geometry.x2 <= GAME_WIDTH - BLOCK_WALL_PADDING);
-	g_assert(newblock->geometry.y2 <= GAME_HEIGHT - BLOCK_WALL_PADDING - BAT_SPACE);
+	for(; level->realized < total && count > 0; level->realized++) {
+		if(level->blocks[level->realized]) {
+			add_to_canvas_layer((Entity *) level->blocks[level->realized],
+					level->layer);
+			count--;
+		}
+	}
 
-	/* Set block_no */
-	newblock->block_no = block_no;
+	return level->realized == total;
+}
+
+/* Frees up to count of a level's blocks. Returns TRUE, having freed the level
+ * itself, once there are none left. Use this rather than destroy_level to
+ * spread the teardown of an old level over several frames */
+gboolean reap_level(Level *level, gint count) {
+	gint total;
+
+	total = level->width * level->height;
+
+	for(; level->reaped < total && count > 0; level->reaped++) {
+		if(level->blocks[level->reaped]) {
+			remove_block(level, level->blocks[level->reaped]);
+			count--;
+		}
+	}
+
+	if(level->reaped < total)
+		return FALSE;
+
+	g_assert(!level->active_blocks);
+	if(level->layer)
+		gui_destroy_layer(level->layer);
+	g_free(level->blocks);
+	memstats_remove_string(MEM_LEVEL_STRING, level->name);
+	memstats_remove_string(MEM_LEVEL_STRING, level->author);
+	memstats_remove_string(MEM_LEVEL_STRING, level->levelfile_title);
+	g_free(level->name);
+	g_free(level->author);
+	g_free(level->levelfile_title);
+	g_free(level);
+
+	return TRUE;
+}
+
+/* Make a new block of type at x/y */
+static Block *new_block(Level *level, char type, gint block_no) {
+	Block *newblock;
+
+	newblock = alloc_block(level, block_no);
 
 	/* Set everything else */
 	switch(type) {
@@ -123,25 +188,175 @@ static Block *new_block(char type, gint block_no) {
 		default :
 			g_assert_not_reached();
 	}
+	level->block_hash ^= statehash_block(block_no, newblock->type);
+
+	return newblock;
+}
+
+/* Puts a block of type type back at block_no of a level being restored from
+ * a saved game, see savegame.c. Blocks that are part way through changing
+ * need the animation they had; other blocks get their usual one, and
+ * animation should be NULL. Returns FALSE if this doesn't make sense */
+gboolean restore_block(Level *level, gint block_no, BlockType type,
+		Animation *animation) {
+	Block *block;
+	gboolean changing;
+	gint anim;
+
+	changing = type == BLOCK_DEAD || type == BLOCK_STRONG_1_DIE
+		|| type == BLOCK_STRONG_2_DIE || type == BLOCK_STRONG_3_DIE;
+	if(changing != (animation != NULL) || level->blocks[block_no])
+		return FALSE;
+
+	switch(type) {
+		case BLOCK_DEFAULT :
+			anim = ANIM_BLOCK_DEFAULT;
+			break;
+		case BLOCK_INVINCIBLE :
+			anim = ANIM_BLOCK_INVINCIBLE;
+			break;
+		case BLOCK_STRONG_1 :
+			anim = ANIM_BLOCK_STRONG_1;
+			break;
+		case BLOCK_STRONG_2 :
+			anim = ANIM_BLOCK_STRONG_2;
+			break;
+		case BLOCK_STRONG_3 :
+			anim = ANIM_BLOCK_STRONG_3;
+			break;
+		case BLOCK_EXPLODE :
+			anim = ANIM_BLOCK_EXPLODE;
+			break;
+		default :
+			anim = -1;
+	}
+
+	block = alloc_block(level, block_no);
+	block->type = type;
+	if(changing) {
+		block->animation = *animation;
+		activate_block(level, block);
+	} else {
+		block->animation = get_static_animation(anim);
+	}
+	level->blocks[block_no] = block;
+	level->block_hash ^= statehash_block(block_no, type);
+
+	return TRUE;
+}
+
+/* Makes level, which is being played, the same as saved, a level of the
+ * same size read back from a saved game, and frees saved. Blocks that are
+ * the same in both, and not changing, are left as they are, so only the
+ * blocks that differ touch the canvas. The rest are moved across from
+ * saved. Returns FALSE, leaving both alone, if saved isn't the same size */
+gboolean restore_level(Level *level, Level *saved) {
+	Block *block, *saved_block;
+	guint32 block_hash;
+	gint i, total;
+
+	if(saved->width != level->width || saved->height != level->height)
+		return FALSE;
+
+	/* Taken now, as freeing saved's blocks changes it */
+	block_hash = saved->block_hash;
+
+	total = level->width * level->height;
+	for(i = 0; i < total; i++) {
+		block = level->blocks[i];
+		saved_block = saved->blocks[i];
+
+		if(block && saved_block && block->type == saved_block->type
+				&& !block->active && !saved_block->active) {
+			remove_block(saved, saved_block);
+			continue;
+		}
+
+		if(block)
+			remove_block(level, block);
+		if(saved_block) {
+			saved->blocks[i] = NULL;
+			level->blocks[i] = saved_block;
+			if(i < level->realized)
+				add_to_canvas_layer((Entity *) saved_block,
+						level->layer);
+		}
+	}
+
+	/* Only blocks that were moved across can be active now */
+	g_assert(!level->active_blocks);
+	level->active_blocks = saved->active_blocks;
+	saved->active_blocks = NULL;
+	level->block_hash = block_hash;
+	level->blocks_left = saved->blocks_left;
+
+	reap_level(saved, total);
+
+	return TRUE;
+}
+
+/* Allocates a block at block_no and works out where it goes. Its type and
+ * animation are left for the caller */
+static Block *alloc_block(Level *level, gint block_no) {
+	Block *newblock;
+	gint x, y;
+
+	x = block_no % level->width;
+	y = block_no / level->width;
+	g_assert(y < level->height);
+	newblock = g_malloc(sizeof(Block));
+	memstats_add(MEM_BLOCK, sizeof(Block));
+
+	/* Set the geometry */
+	newblock->geometry.x1 = BLOCK_WALL_PADDING + BLOCK_WIDTH * x;
+	newblock->geometry.y1 = BLOCK_WALL_PADDING + BLOCK_HEIGHT * y;
+	newblock->geometry.x2 = newblock->geometry.x1 + BLOCK_WIDTH;
+	newblock->geometry.y2 = newblock->geometry.y1 + BLOCK_HEIGHT;
+
+	g_assert(newblock->geometry.x1 >= BLOCK_WALL_PADDING);
+	g_assert(newblock->geometry.y1 >= BLOCK_WALL_PADDING);
+	g_assert(newblock->geometry.x2 <= GAME_WIDTH(level) - BLOCK_WALL_PADDING);
+	g_assert(newblock->geometry.y2 <= GAME_HEIGHT(level) - BLOCK_WALL_PADDING - BAT_SPACE);
+
+	/* Set block_no */
+	newblock->block_no = block_no;
+	newblock->active = FALSE;
 
-	/* Add it to the gnome-canvas */
-	add_to_canvas((Entity *) newblock);
-	
 	return newblock;
 }
 
 /* Remove a block from the list */
-static void remove_block(Block **blocks, Block *block) {
+static void remove_block(Level *level, Block *block) {
 	remove_from_canvas((Entity *) block);
-	blocks[block->block_no] = NULL;	
+	level->block_hash ^= statehash_block(block->block_no, block->type);
+	if(block->active)
+		level->active_blocks = g_list_remove(level->active_blocks, block);
+	level->blocks[block->block_no] = NULL;	
+	memstats_remove(MEM_BLOCK, sizeof(Block));
 	g_free(block);
 }
 
+/* Puts a block that has just started animating on the level's active list */
+static void activate_block(Level *level, Block *block) {
+	if(!block->active) {
+		block->active = TRUE;
+		level->active_blocks = g_list_prepend(level->active_blocks, block);
+	}
+}
+
+/* Changes a block's type, keeping the level's block_hash up to date */
+static void set_block_type(Level *level, Block *block, BlockType type) {
+	level->block_hash ^= statehash_block(block->block_no, block->type)
+		^ statehash_block(block->block_no, type);
+	block->type = type;
+}
+
 /* Hit a block */
 void hit_block(Game *game, Block *block) {
 	gint block_no;
 
 	block_no = block->block_no;
+	TRACE_INSTANT("hit_block", "block_no", block_no);
 
 	switch(block->type) {
 		case BLOCK_STRONG_1 :
@@ -157,11 +372,13 @@ void hit_block(Game *game, Block *block) {
 			block_default_hit(game, block);
 			ADD_SCORE(game, 50);
 			game->level->blocks_left--;
+			game->stats.blocks_cleared++;
 			break;
 		case BLOCK_EXPLODE :
 			block_explode_hit(game, block);
 			ADD_SCORE(game, 100);
 			game->level->blocks_left--;
+			game->stats.blocks_cleared++;
 			break;
 		case BLOCK_INVINCIBLE :
 		case BLOCK_DEAD :
@@ -177,8 +394,9 @@ static void block_default_hit(Game *game, Block *block) {
 	/* Make the block "fade out" */
 	remove_from_canvas((Entity *) block);
 	block->animation = get_once_animation(ANIM_BLOCK_DEFAULT_DIE);
-	block->type = BLOCK_DEAD;
-	add_to_canvas((Entity *) block);
+	set_block_type(game->level, block, BLOCK_DEAD);
+	add_to_canvas_layer((Entity *) block, game->level->layer);
+	activate_block(game->level, block);
 
 	/* Spawn a new powerup */
 	new_powerup(game, block->geometry.x1, block->geometry.y2);
@@ -192,13 +410,17 @@ static void block_explode_hit(Game *game, Block *block) {
         /* Make the block "fade out" */
         remove_from_canvas((Entity *) block);
         block->animation = get_once_animation(ANIM_BLOCK_EXPLODE_DIE);
-        block->type = BLOCK_DEAD;
-        add_to_canvas((Entity *) block);
+        set_block_type(game->level, block, BLOCK_DEAD);
+        add_to_canvas_layer((Entity *) block, game->level->layer);
+	activate_block(game->level, block);
 
         /* Spawn a new powerup */
         new_powerup(game, block->geometry.x1, block->geometry.y2);
 
-	/* Hit the blocks around the exploder block */
+	/* Hit the blocks around the exploder block. Each explosion in a chain
+	 * is traced as a span inside the one that set it off */
+	TRACE_BEGIN("explosion");
+	TRACE_INSTANT("explode", "block_no", block->block_no);
 	nearby = get_nearby_blocks(game, block);
 	for(i = 0; i < 8; i++) {
 		if(nearby[i]) {
@@ -207,6 +429,7 @@ static void block_explode_hit(Game *game, Block *block) {
 		}
 	}
 	g_free(nearby);
+	TRACE_END("explosion");
 }
 
 static void block_strong_hit(Game *game, Block *block) {
@@ -219,40 +442,31 @@ static void block_strong_hit(Game *game, Block *block) {
 		case BLOCK_STRONG_3 :
 			block->animation = get_once_animation
 				(ANIM_BLOCK_STRONG_3_DIE);
-			block->type = BLOCK_STRONG_3_DIE;
+			set_block_type(game->level, block, BLOCK_STRONG_3_DIE);
 			break;
 		case BLOCK_STRONG_2 :
 		case BLOCK_STRONG_3_DIE :
 			block->animation = get_once_animation
 				(ANIM_BLOCK_STRONG_2_DIE);
-			block->type = BLOCK_STRONG_2_DIE;
+			set_block_type(game->level, block, BLOCK_STRONG_2_DIE);
 			break;
 		case BLOCK_STRONG_1 :
 		case BLOCK_STRONG_2_DIE :
 			block->animation = get_once_animation
 				(ANIM_BLOCK_STRONG_1_DIE);
-			block->type = BLOCK_STRONG_1_DIE;
+			set_block_type(game->level, block, BLOCK_STRONG_1_DIE);
 			break;
 		default :
 			g_assert_not_reached();
 	}
 
-	add_to_canvas((Entity *) block);
+	add_to_canvas_layer((Entity *) block, game->level->layer);
+	activate_block(game->level, block);
 }
 	
 /* De-allocate the blocks, and the level structure */
 void destroy_level(Game *game) {
-	int i;
-
-	for(i = 0; i < BLOCKS_X * BLOCKS_Y; i++)
-		if(game->level->blocks[i]) 
-			remove_block(game->level->blocks,
-					game->level->blocks[i]);
-
-	g_free(game->level->name);
-	g_free(game->level->author);
-	g_free(game->level->levelfile_title);
-	g_free(game->level);
+	reap_level(game->level, game->level->width * game->level->height);
 	game->level = NULL;
 }
 
@@ -262,17 +476,18 @@ gboolean check_level_end(Game *game) {
 }
 
 /* Iterate the blocks. Currently, this just animates the dying blocks and
- * kills the ones which have run out of frames. */
+ * kills the ones which have run out of frames. Only the blocks on the active
+ * list can be animating, so the rest of the grid is left alone. */
 void iterate_blocks(Game *game) {
-	Block **blocks;
-	int i;
+	GList *curr;
+	Block *block;
 
 	if(game->level) {
-		blocks = game->level->blocks;
-		for(i = 0; i < BLOCKS_X * BLOCKS_Y; i++) {
-			if(blocks[i]) {
-				iterate_block(game, blocks[i]);
-			}
+		curr = game->level->active_blocks;
+		while(curr) {
+			block = (Block *) curr->data;
+			curr = g_list_next(curr);
+			iterate_block(game, block);
 		}
 	}
 }
@@ -289,29 +504,37 @@ static void iterate_block(Game *game, Block *block) {
 		remove_from_canvas((Entity *) block);
 		switch(block->type) {
 			case BLOCK_STRONG_3_DIE :
-				block->type = BLOCK_STRONG_2;
+				set_block_type(game->level, block,
+						BLOCK_STRONG_2);
 				block->animation = get_static_animation
 					(ANIM_BLOCK_STRONG_2);
 				break;
 			case BLOCK_STRONG_2_DIE :
-				block->type = BLOCK_STRONG_1;
+				set_block_type(game->level, block,
+						BLOCK_STRONG_1);
 				block->animation = get_static_animation
 					(ANIM_BLOCK_STRONG_1);
 				break;
 			case BLOCK_STRONG_1_DIE :
-				block->type = BLOCK_DEFAULT;
+				set_block_type(game->level, block,
+						BLOCK_DEFAULT);
 				block->animation = get_static_animation
 					(ANIM_BLOCK_DEFAULT);
 				break;
 			case BLOCK_DEAD :
-				remove_block(game->level->blocks, block);
+				remove_block(game->level, block);
 				block = NULL;
 				break;
 			default :
 				g_assert_not_reached();
 		}
-		if(block)
-			add_to_canvas((Entity *) block);
+		if(block) {
+			add_to_canvas_layer((Entity *) block,
+					game->level->layer);
+			block->active = FALSE;
+			game->level->active_blocks = g_list_remove(
+					game->level->active_blocks, block);
+		}
 	}
 }
 
@@ -323,12 +546,16 @@ Block *find_block_from_position(Game *game, Entity *entity) {
 	gint return_val = -1;
 	gint x1, x2, y1, y2;
 	gint block_no = -1, i;
+	gint width, height;
 	Block **blocks;
 
+	width = game->level->width;
+	height = game->level->height;
+
 	if(entity->geometry.x2 > BLOCK_WALL_PADDING
-			&& entity->geometry.x1 < GAME_WIDTH - BLOCK_WALL_PADDING
+			&& entity->geometry.x1 < GAME_WIDTH(game->level) - BLOCK_WALL_PADDING
 			&& entity->geometry.y2 > BLOCK_WALL_PADDING
-			&& entity->geometry.y1 < BLOCK_WALL_PADDING + BLOCKS_Y *
+			&& entity->geometry.y1 < BLOCK_WALL_PADDING + height *
 			BLOCK_HEIGHT) {
 		blocks = game->level->blocks;
 		x1 = entity->geometry.x1 - BLOCK_WALL_PADDING;
@@ -341,31 +568,31 @@ Block *find_block_from_position(Game *game, Entity *entity) {
 		y1 /= BLOCK_HEIGHT;
 		y2 /= BLOCK_HEIGHT;
 
-		g_assert(x1 < BLOCKS_X);
-		if(x2 == BLOCKS_X)
-			x2 = BLOCKS_X - 1;
-		g_assert(y1 < BLOCKS_Y);
-		if(y2 == BLOCKS_Y)
-			y2 = BLOCKS_Y - 1;
+		g_assert(x1 < width);
+		if(x2 == width)
+			x2 = width - 1;
+		g_assert(y1 < height);
+		if(y2 == height)
+			y2 = height - 1;
 
 		for(i = 0; i < 4; i++) {
 			switch(i) {
 				case 0 :
-					block_no = x1 + y1 * BLOCKS_X;
+					block_no = x1 + y1 * width;
 					break;
 				case 1 :
-					block_no = x2 + y1 * BLOCKS_X;
+					block_no = x2 + y1 * width;
 					break;
 				case 2 :
-					block_no = x1 + y2 * BLOCKS_X;
+					block_no = x1 + y2 * width;
 					break;
 				case 3 :
-					block_no = x2 + y2 * BLOCKS_X;
+					block_no = x2 + y2 * width;
 					break;
 				default :
 					g_assert_not_reached();
 			}
-			if(block_no >= 0 && block_no < BLOCKS_X * BLOCKS_Y) {
+			if(block_no >= 0 && block_no < width * height) {
 				if(blocks[block_no] && blocks[block_no]->type !=
 						BLOCK_DEAD) {
 					return_val = block_no;
@@ -381,114 +608,110 @@ Block *find_block_from_position(Game *game, Entity *entity) {
 		return NULL;
 }
 
-/* Returns whether the neighbour of 'block_no' on 'side' exists
- * The if statements rely on the fact that if the first condition fails, the
- * other conditions will not be evaluated. I'm not sure, but I think that
- * this is standard for all compilers.
- */
+/* Puts the live blocks in the squares that area covers into blocks, in order
+ * of block number, up to max of them. Returns how many it found */
+gint find_blocks_in_area(Game *game, Geometry *area, Block **blocks,
+		gint max) {
+	gint x1, x2, y1, y2, x, y, found = 0;
+	Level *level = game->level;
+	Block *block;
+
+	if(area->x2 <= BLOCK_WALL_PADDING
+			|| area->x1 >= GAME_WIDTH(level) - BLOCK_WALL_PADDING
+			|| area->y2 <= BLOCK_WALL_PADDING
+			|| area->y1 >= BLOCK_WALL_PADDING + level->height
+			* BLOCK_HEIGHT)
+		return 0;
+
+	x1 = MAX(area->x1 - BLOCK_WALL_PADDING, 0) / BLOCK_WIDTH;
+	x2 = MIN((area->x2 - BLOCK_WALL_PADDING) / BLOCK_WIDTH,
+			level->width - 1);
+	y1 = MAX(area->y1 - BLOCK_WALL_PADDING, 0) / BLOCK_HEIGHT;
+	y2 = MIN((area->y2 - BLOCK_WALL_PADDING) / BLOCK_HEIGHT,
+			level->height - 1);
+
+	for(y = y1; y <= y2; y++) {
+		for(x = x1; x <= x2 && found < max; x++) {
+			block = level->blocks[x + y * level->width];
+			if(block && block->type != BLOCK_DEAD)
+				blocks[found++] = block;
+		}
+	}
+
+	return found;
+}
+
+/* Returns whether the neighbour of 'block_no' on 'side' exists */
 gboolean block_has_neighbour(Game *game, Block *block, Side side) {
-	gint block_no;
+	gint x, y, width, height;
+	Block *neighbour = NULL;
 	Block **blocks;
-	gboolean ret = FALSE;
-	blocks = game->level->blocks;
 
-	block_no = block->block_no;
+	blocks = game->level->blocks;
+	width = game->level->width;
+	height = game->level->height;
+	x = block->block_no % width;
+	y = block->block_no / width;
 
 	switch(side) {
 		case SIDE_TOP :
-			if(block_no >= BLOCKS_X && blocks[block_no - BLOCKS_X]
-					&& blocks[block_no - BLOCKS_X]->type
-					!= BLOCK_DEAD)
-				ret = TRUE;
+			if(y > 0)
+				neighbour = blocks[block->block_no - width];
 			break;
 		case SIDE_LEFT :
-			if(block_no >= 1 && blocks[block_no - 1]
-					&& blocks[block_no - 1]->type
-					!= BLOCK_DEAD)
-				ret = TRUE;
+			if(x > 0)
+				neighbour = blocks[block->block_no - 1];
 			break;
 		case SIDE_RIGHT :
-			if(block_no < (BLOCKS_X * BLOCKS_Y)
-					&& block_no % BLOCKS_X != BLOCKS_X - 1
-					&& blocks[block_no + 1]
-					&& blocks[block_no + 1]->type
-					!= BLOCK_DEAD)
-				ret = TRUE;
+			if(x < width - 1)
+				neighbour = blocks[block->block_no + 1];
 			break;
 		case SIDE_BOTTOM :
-			if(block_no < (BLOCKS_X * (BLOCKS_Y - 1))
-					&& blocks[block_no + BLOCKS_X]
-					&& blocks[block_no + BLOCKS_X]->type
-					!= BLOCK_DEAD)
-				ret = TRUE;
+			if(y < height - 1)
+				neighbour = blocks[block->block_no + width];
 			break;
 		default :
 			g_assert_not_reached();
 	}
 
-	return ret;
+	return neighbour && neighbour->type != BLOCK_DEAD;
 }
 
 /* Destroys a block. Public function for ball.c:iterate_ball_default */
 void destroy_block(Game *game, Block *block) {
-	if(block->type != BLOCK_DEAD && block->type != BLOCK_INVINCIBLE)
+	if(block->type != BLOCK_DEAD && block->type != BLOCK_INVINCIBLE) {
 		game->level->blocks_left--;
+		game->stats.blocks_cleared++;
+	}
 
-	remove_block(game->level->blocks, block);
+	remove_block(game->level, block);
 }
 
 /* Returns an array of 8 pointers to the blocks surrounding block. If a
  * pointer is null, then there is no block in that direction. The array
  * starts at north and goes clockwise */
 static Block **get_nearby_blocks(Game *game, Block *block) {
+	/* Offsets of each direction, starting at north and going clockwise */
+	static const gint dx[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+	static const gint dy[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
 	Block **blocks;
-	int block_no;
 	Block **ret;
+	gint x, y, nx, ny, width, height, i;
 
 	blocks = game->level->blocks;
+	width = game->level->width;
+	height = game->level->height;
 	ret = g_malloc(sizeof(Block *) * 8);
-	block_no = block->block_no;
+	x = block->block_no % width;
+	y = block->block_no / width;
 
-	memset(ret, 0, sizeof(Block *) * 8);
-
-	/* North */
-	if(block_no >= BLOCKS_X) {
-		ret[0] = blocks[block_no - BLOCKS_X];
-	}
-
-	/* Northeast */
-	if(block_no >= BLOCKS_X && block_no % BLOCKS_X != (BLOCKS_X - 1)) {
-		ret[1] = blocks[block_no - BLOCKS_X + 1];
-	}
-
-	/* East */
-	if(block_no < (BLOCKS_TOTAL - 1) && block_no % BLOCKS_X != (BLOCKS_X -1)) {
-		ret[2] = blocks[block_no + 1];
-	}
-
-	/* Southeast */
-	if(block_no <= (BLOCKS_TOTAL - 1 - BLOCKS_X) && block_no % BLOCKS_X != (BLOCKS_X - 1)) {
-		ret[3] = blocks[block_no + 1 + BLOCKS_X];
-	}
-
-	/* South */
-	if(block_no < (BLOCKS_TOTAL - BLOCKS_X)) {
-		ret[4] = blocks[block_no + BLOCKS_X];
-	}
-
-	/* Southwest */
-	if(block_no < (BLOCKS_TOTAL - BLOCKS_X) && (block_no % BLOCKS_X)) {
-		ret[5] = blocks[block_no - 1 + BLOCKS_X];
-	}
-
-	/* West */
-	if(block_no && (block_no % BLOCKS_X)) {
-		ret[6] = blocks[block_no - 1];
-	}
-
-	/* Northwest */
-	if(block_no >= BLOCKS_X && (block_no % BLOCKS_X)) {
-		ret[7] = blocks[block_no - BLOCKS_X - 1];
+	for(i = 0; i < 8; i++) {
+		nx = x + dx[i];
+		ny = y + dy[i];
+		if(nx >= 0 && nx < width && ny >= 0 && ny < height)
+			ret[i] = blocks[nx + ny * width];
+		else
+			ret[i] = NULL;
 	}
 
 	return ret;
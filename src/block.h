@@ -7,11 +7,18 @@
  * "COPYING" for more details.
  */
 
-Level *generate_level(gint level_num);
+Level *generate_level(RawLevel *rawlevel);
+Level *new_level(RawLevel *rawlevel);
+gboolean restore_block(Level *level, gint block_no, BlockType type, Animation *animation);
+gboolean restore_level(Level *level, Level *saved);
+gboolean realize_level(Level *level, gint count);
+gboolean reap_level(Level *level, gint count);
 void hit_block(Game *game, Block *block);
 void destroy_level(Game *game);
 void destroy_block(Game *game, Block *block);
 gboolean check_level_end(Game *game);
 void iterate_blocks(Game *game);
 Block *find_block_from_position(Game *game, Entity *entity);
+gint find_blocks_in_area(Game *game, Geometry *area, Block **blocks,
+		gint max);
 gboolean block_has_neighbour(Game *game, Block *block, Side side);
@@ -0,0 +1,236 @@
+/*
+ * A computer player, for soak testing, and for watching the game play itself.
+ * Each tick it looks at the game and sets the input, just as the player's
+ * mouse or keyboard would, so a bot's games record and play back like anyone
+ * else's.
+ *
+ * It keeps the bat under the lowest ball that's coming down, working out
+ * where the ball will cross the top of the bat with trajectory.c. Where that
+ * can't say, as when the ball's about to set off an exploding block, the
+ * blocks are ignored and the ball is just bounced off the side walls, which
+ * is nearly always right once it's on its way down. Rather than always
+ * hitting the ball with the middle of the bat, it picks a point along the
+ * bat for each descent, so that the ball doesn't go round the same path
+ * forever. If a powerup will land before the ball does, it goes and gets
+ * that first.
+ *
+ * The bot has its own random numbers, so that it doesn't disturb the game's,
+ * and two bots with the same seed play a game the same way.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include <math.h>
+#include "breakout.h"
+#include "powerup.h"
+#include "rng.h"
+#include "trajectory.h"
+#include "ball.h"
+#include "bot.h"
+
+/* How far ahead to look for where a ball will come down, in ticks */
+#define PREDICT_TICKS 500
+
+/* How long to wait before launching a stuck ball, in ticks */
+#define MIN_LAUNCH_WAIT 5
+#define MAX_LAUNCH_WAIT 50
+
+struct _Bot {
+	Rng rng;
+	gboolean chase_powerups;
+
+	/* Where along the bat, from the middle, to hit the ball coming down,
+	 * and whether one was coming down last tick */
+	gint aim;
+	gboolean descending;
+
+	gint launch_wait;
+};
+
+/* Internal Functions */
+static Ball *lowest_descending_ball(Game *game);
+static Powerup *next_powerup(Game *game, gint before_ticks);
+static void move_to(Game *game, gint x);
+static void launch_balls(Bot *bot, Game *game);
+
+Bot *new_bot(guint32 seed, gboolean chase_powerups) {
+	Bot *bot;
+
+	bot = g_malloc0(sizeof(Bot));
+	rng_seed(&bot->rng, seed);
+	bot->chase_powerups = chase_powerups;
+	bot->launch_wait = -1;
+
+	return bot;
+}
+
+void destroy_bot(Bot *bot) {
+	g_free(bot);
+}
+
+/* Sets game's input for the next tick */
+void bot_tick(Bot *bot, Game *game) {
+	Ball *ball;
+	Powerup *powerup = NULL;
+	gint bat_y, ball_x, ball_ticks = G_MAXINT, half;
+
+	if(!game->bat || !game->level)
+		return;
+
+	bat_y = game->bat->geometry.y1;
+	ball = lowest_descending_ball(game);
+	if(ball && !bot_predict_ball(game, ball, bat_y, &ball_x, &ball_ticks))
+		ball = NULL;
+
+	if(ball && !bot->descending) {
+		half = game->bat->width / 3;
+		bot->aim = rng_range(&bot->rng, half * 2 + 1) - half;
+	}
+	bot->descending = ball != NULL;
+
+	if(bot->chase_powerups)
+		powerup = next_powerup(game, ball_ticks);
+
+	if(powerup)
+		move_to(game, (powerup->geometry.x1 + powerup->geometry.x2) / 2);
+	else if(ball)
+		move_to(game, ball_x + bot->aim);
+	else if(game->balls)
+		move_to(game, ((Ball *) game->balls->data)->geometry.x1
+				+ BALL_WIDTH / 2);
+
+	launch_balls(bot, game);
+
+	/* Lasers never hurt */
+	if(game->bat->type == BAT_LASER
+			&& game->bat->num_lasers < game->bat->num_lasers_allowed)
+		game->fire1_pressed = TRUE;
+}
+
+/* Works out where the middle of ball will be when its bottom reaches line_y,
+ * and in how many ticks. Returns FALSE if it isn't heading down towards
+ * line_y */
+gboolean bot_predict_ball(Game *game, Ball *ball, gint line_y, gint *x,
+		gint *ticks) {
+	BallPath path;
+	gdouble dx, dy, t, pos, range;
+
+	if(ball->type != BALL_DEFAULT)
+		return FALSE;
+
+	if(predict_path(game, ball, line_y, PREDICT_TICKS, &path)
+			&& path.end == PATH_LINE) {
+		*x = (gint) path.points[path.num_points - 1].x1
+			+ BALL_WIDTH / 2;
+		*ticks = path.num_points;
+		return TRUE;
+	}
+
+	ball_step(ball, &dx, &dy);
+	if(dy <= 0 || ball->geometry.y2 > line_y)
+		return FALSE;
+
+	t = (line_y - (ball->pseudo_y1 + BALL_HEIGHT)) / dy;
+	pos = ball->pseudo_x1 + dx * t;
+
+	/* Bouncing between the walls is the same as carrying straight on
+	 * through a row of mirror image playing fields */
+	range = GAME_WIDTH(game->level) - BALL_WIDTH;
+	pos = fmod(pos, range * 2);
+	if(pos < 0)
+		pos += range * 2;
+	if(pos > range)
+		pos = range * 2 - pos;
+
+	*x = (gint) pos + BALL_WIDTH / 2;
+	*ticks = (gint) ceil(t);
+
+	return TRUE;
+}
+
+/* The lowest ball on its way down, or NULL if they're all going up */
+static Ball *lowest_descending_ball(Game *game) {
+	GList *curr;
+	Ball *ball, *lowest = NULL;
+	gdouble dx, dy;
+
+	for(curr = game->balls; curr; curr = g_list_next(curr)) {
+		ball = (Ball *) curr->data;
+		ball_step(ball, &dx, &dy);
+		if(ball->type != BALL_DEFAULT || dy <= 0
+				|| ball->geometry.y2 > game->bat->geometry.y1)
+			continue;
+		if(!lowest || ball->geometry.y2 > lowest->geometry.y2)
+			lowest = ball;
+	}
+
+	return lowest;
+}
+
+/* The lowest powerup that will reach the bat in fewer than before_ticks, or
+ * NULL if there isn't one */
+static Powerup *next_powerup(Game *game, gint before_ticks) {
+	GList *curr;
+	Powerup *powerup, *lowest = NULL;
+	gint ticks;
+
+	for(curr = game->powerups; curr; curr = g_list_next(curr)) {
+		powerup = (Powerup *) curr->data;
+		if(powerup->geometry.y1 > game->bat->geometry.y2)
+			continue;
+		ticks = (game->bat->geometry.y1 - powerup->geometry.y2)
+			/ POWERUP_SPEED;
+		if(ticks >= before_ticks)
+			continue;
+		if(!lowest || powerup->geometry.y2 > lowest->geometry.y2)
+			lowest = powerup;
+	}
+
+	return lowest;
+}
+
+/* Moves the middle of the bat towards x, with whichever control the game is
+ * using */
+static void move_to(Game *game, gint x) {
+	gint diff;
+
+	if(game->flags->keyboard_control) {
+		diff = x - (game->bat->geometry.x1 + game->bat->width / 2);
+		if(ABS(diff) <= game->flags->bat_speed / 2)
+			game->keyboard_move = 0;
+		else if(diff < 0)
+			game->keyboard_move = -game->flags->bat_speed;
+		else
+			game->keyboard_move = game->flags->bat_speed;
+	} else {
+		game->mouse_move = x;
+	}
+}
+
+/* Launches a stuck ball, one way or the other, after a moment */
+static void launch_balls(Bot *bot, Game *game) {
+	GList *curr;
+
+	for(curr = game->balls; curr; curr = g_list_next(curr)) {
+		if(((Ball *) curr->data)->type == BALL_STUCK)
+			break;
+	}
+	if(!curr) {
+		bot->launch_wait = -1;
+		return;
+	}
+
+	if(bot->launch_wait < 0)
+		bot->launch_wait = MIN_LAUNCH_WAIT
+			+ rng_range(&bot->rng, MAX_LAUNCH_WAIT - MIN_LAUNCH_WAIT);
+	if(bot->launch_wait-- > 0)
+		return;
+
+	if(rng_range(&bot->rng, 2))
+		game->fire1_pressed = TRUE;
+	else
+		game->fire2_pressed = TRUE;
+}
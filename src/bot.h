@@ -0,0 +1,16 @@
+/*
+ * A computer player
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+typedef struct _Bot Bot;
+
+Bot *new_bot(guint32 seed, gboolean chase_powerups);
+void destroy_bot(Bot *bot);
+void bot_tick(Bot *bot, Game *game);
+gboolean bot_predict_ball(Game *game, Ball *ball, gint line_y, gint *x,
+		gint *ticks);
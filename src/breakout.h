@@ -14,13 +14,19 @@
 /*
  * Dimensions.
  */
-/* The width of the playing field */
-#define GAME_WIDTH (BLOCKS_X * BLOCK_WIDTH + BLOCK_WALL_PADDING * 2)
-/* The height of the playing field */
-#define GAME_HEIGHT (BLOCKS_Y * BLOCK_HEIGHT + BLOCK_WALL_PADDING * 2 + BAT_SPACE)
-#define BLOCKS_X   10 /* The number of blocks along the X plane */
-#define BLOCKS_Y   15 /* The number of blocks along the Y plane */
-#define BLOCKS_TOTAL (BLOCKS_X * BLOCKS_Y)
+/* The width of the playing field of a Level or RawLevel */
+#define GAME_WIDTH(level) ((level)->width * BLOCK_WIDTH + BLOCK_WALL_PADDING * 2)
+/* The height of the playing field of a Level or RawLevel */
+#define GAME_HEIGHT(level) ((level)->height * BLOCK_HEIGHT + BLOCK_WALL_PADDING * 2 + BAT_SPACE)
+/* The size of the title screen, which is that of a default sized level */
+#define TITLE_WIDTH (BLOCKS_X * BLOCK_WIDTH + BLOCK_WALL_PADDING * 2)
+#define TITLE_HEIGHT (BLOCKS_Y * BLOCK_HEIGHT + BLOCK_WALL_PADDING * 2 + BAT_SPACE)
+#define BLOCKS_X   10 /* The default number of blocks along the X plane */
+#define BLOCKS_Y   15 /* The default number of blocks along the Y plane */
+#define MIN_BLOCKS_X 3 /* Any narrower, and the bat doesn't fit */
+#define MIN_BLOCKS_Y 1
+#define MAX_BLOCKS_X 256 /* The largest level a levelfile may declare */
+#define MAX_BLOCKS_Y 256
 #define BLOCK_WALL_PADDING 20 /* The distance between the wall and the blocks */
 #define BLOCK_WIDTH 40 /* The width of the blocks */
 #define BLOCK_HEIGHT 20 /* The height of the blocks */
@@ -73,6 +79,9 @@ typedef struct {
  * Details about a ball. 
  * direction is in radians. The pseudo values are for handling fine
  * direction control. Airtime is how many frames the ball has been in the air.
+ * A fixed_point ball moves with fixed point arithmetic, and its pseudo
+ * values and speed only ever hold Q16.16 numbers, and its direction a whole
+ * number of angle steps. See fixed.c.
  */
 typedef enum { BALL_DEFAULT, BALL_STUCK } BallType;
 typedef struct {
@@ -84,6 +93,7 @@ typedef struct {
 	gdouble direction;
 	gint airtime;
 	BallType type; 
+	gboolean fixed_point;
 } Ball;
 
 /*
@@ -99,6 +109,7 @@ typedef struct {
 	Animation animation;
 	BlockType type;
 	gint block_no;
+	gboolean active; /* Whether it's in its level's active_blocks list */
 } Block;
 
 /*
@@ -150,6 +161,7 @@ typedef struct {
 	gint right_key;
 	gint fire1_key;
 	gint fire2_key;
+	gint rewind_key;
 	gboolean hide_pointer;
 	gboolean pause_on_focus;
 	gboolean pause_on_pointer;
@@ -165,10 +177,20 @@ typedef struct {
 } Flags;
 
 /*
- * The current level
+ * The current level. blocks is width * height long, row by row. active_blocks
+ * holds the blocks that are animating, so that iterate_blocks doesn't have to
+ * look at the whole grid every frame. block_hash is kept up to date with the
+ * contents of blocks, see statehash.c.
  */
 typedef struct {
-	Block *blocks[BLOCKS_TOTAL];
+	Block **blocks;
+	gint width;
+	gint height;
+	GList *active_blocks;
+	guint32 block_hash;
+	GnomeCanvasItem *layer; /* The canvas group that holds the blocks */
+	gint realized; /* How many of blocks have been put on the layer */
+	gint reaped; /* How many of blocks have been freed */
 	gint difficulty;
 	gint number;
 	gchar *name;
@@ -181,13 +203,34 @@ typedef struct {
  * Raw level data, pre block generation.
  */
 typedef struct {
-	gchar blocks[BLOCKS_TOTAL];
+	gchar *blocks; /* width * height block codes */
+	gint width;
+	gint height;
 	gint difficulty;
 	gchar *name;
 	gchar *author;
 	gchar *levelfile_title;
 } RawLevel;
 
+/*
+ * Random number generator state. See rng.c
+ */
+typedef struct {
+	guint64 state;
+	guint64 inc;
+} Rng;
+
+/*
+ * Running totals for a game, kept for the tools that study how games go.
+ * They aren't saved, or wound back by rewind.c
+ */
+typedef struct {
+	guint blocks_cleared;
+	guint balls_lost;
+	guint lives_lost;
+	guint powerups_caught;
+} GameStats;
+
 /*
  * Information about the current game.
  */
@@ -201,6 +244,11 @@ typedef struct {
 	gint level_no;
 	Flags *flags;
 
+	/* All of the game's randomness comes from rng, which is seeded with
+	 * seed when the game starts */
+	guint32 seed;
+	Rng rng;
+
 	/* Entities */
 	GList *balls;
 	GList *powerups;
@@ -212,16 +260,65 @@ typedef struct {
 	gint mouse_move;
 	gboolean fire1_pressed;
 	gboolean fire2_pressed;
+	gboolean kill_ball_pressed;
 
 	/* Pause Levels bitmask */
 	gint32 pause_state;
 
 	/* Pending Events */
 	gboolean powerup_next_level;
+
+	/* The next level, being prepared in the background. See prefetch.c */
+	struct _LevelPrefetch *prefetch;
+
+	/* Endless games use generated levels rather than the levelfiles */
+	gboolean endless;
+	struct _LevelGen *levelgen;
+
+	/* Balls move with fixed point arithmetic, so that the game plays out
+	 * the same on every machine. See fixed.c */
+	gboolean fixed_point;
+
+	/* The replay of this game being recorded, or being played back. See
+	 * replay.c */
+	struct _Replay *recording;
+	struct _Replay *playback;
+
+	/* Snapshots of this game to go back to, and whether the player has
+	 * asked to go back. See rewind.c */
+	struct _Rewind *rewind;
+	gboolean rewind_pressed;
+
+	/* Ticks stepped since the game started. iterate_game runs time_scale
+	 * ticks for each frame it draws, and skips ahead to fast_forward_to
+	 * without drawing anything */
+	guint ticks;
+	gint time_scale;
+	guint fast_forward_to;
+
+	/* The computer player playing this game, if any. See bot.c */
+	struct _Bot *bot;
+
+	/* The paths worked out for the balls. See trajectory.c */
+	struct _PathCache *path_cache;
+
+	GameStats stats;
 } Game;
 
 typedef enum { SIDE_NONE, SIDE_TOP, SIDE_BOTTOM, SIDE_LEFT, SIDE_RIGHT, SIDE_DIAGONAL } Side;
 
+/*
+ * Where a ball touches something. side is the side of it that was hit, or
+ * SIDE_DIAGONAL for a corner. normal points out of it towards the centre of
+ * the ball, in radians as for Ball.direction, and depth is how far the ball
+ * has gone into it along the normal.
+ */
+typedef struct {
+	Side side;
+	gdouble normal;
+	gdouble depth;
+} Contact;
+
 /*
  * Bitmask for pause states
  */
@@ -230,10 +327,13 @@ typedef enum {
         PAUSE_FOCUS =   0x00000002,
         PAUSE_POINTER = 0x00000004,
         PAUSE_PREF =    0x00000008,
+        PAUSE_DIALOG =  0x00000010,
         PAUSE_FORCE =   0xffffffff
 } PauseType;
 
 /*
- * What triggered the end of the game
+ * What triggered the end of the game. Suspended games aren't over, they've
+ * been saved to carry on with later, so they don't get a score
  */
-typedef enum { ENDGAME_WIN, ENDGAME_LOSE, ENDGAME_MENU } EndGameStatus;
+typedef enum { ENDGAME_WIN, ENDGAME_LOSE, ENDGAME_MENU, ENDGAME_SUSPEND
+} EndGameStatus;
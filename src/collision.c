@@ -14,6 +14,8 @@
 #include "collision.h"
 #include "block.h"
 #include "powerup.h"
+#include "rng.h"
+#include "fixed.h"
 
 /* Use these for brevity in check_collision */
 #define AX1 (one->geometry.x1)
@@ -35,12 +37,35 @@
 #define BAT_LOW_CAP (RAD180 - (RAD90 - RAD30)) 
 #define BAT_HIGH_CAP (RAD180 + (RAD90 - RAD30)) 
 
+/* The same, for fixed point balls */
+#define BAT_LOW_CAP_ANGLE ANGLE_DEGREES(120)
+#define BAT_HIGH_CAP_ANGLE ANGLE_DEGREES(240)
+
+/* The ball is round */
+#define BALL_RADIUS (BALL_WIDTH / 2.0)
+
 /* Internal functions */
 static gboolean check_collision(Entity *one, Entity *two);
-static Side find_hit_side(Ball *ball, Entity *one);
-static Side find_block_hit_side(Game *game, Block *block, Ball *ball);
 static void recalculate_ball_trajectory(Game *game, Ball *ball, Side side);
 static void add_bounce_entropy(Game *game, Ball *ball);
+static void bounce_ball_fixed(Ball *ball, Side side);
+static void bat_bounce_fixed(Ball *ball, Bat *bat);
+static void edge_contact(Contact *contact, Side side, gdouble depth);
+static void corner_contact(Ball *ball, Contact *contact, gdouble dx,
+		gdouble dy);
+static void inside_contact(Game *game, Block *block, Ball *ball,
+		Contact *contact, gdouble cx, gdouble cy);
+static gboolean moving_into(Ball *ball, Contact *contact);
+static void reflect_ball(Ball *ball, gdouble normal);
+static Fixed time_of_impact(Block *block, Fixed x, Fixed y, Fixed sx,
+		Fixed sy);
+static Fixed box_entry(Fixed x, Fixed y, Fixed sx, Fixed sy, Fixed x1,
+		Fixed y1, Fixed x2, Fixed y2);
+static gboolean slab_entry(Fixed x, Fixed sx, Fixed lo, Fixed hi,
+		gint64 *enter, gint64 *leave);
+static Fixed circle_entry(Fixed x, Fixed y, Fixed sx, Fixed sy, Fixed px,
+		Fixed py, Fixed r);
+static Fixed first_time(Fixed a, Fixed b);
 
 /* Checks for a collision between two objects */
 static gboolean check_collision(Entity *one, Entity *two) {
@@ -59,17 +84,26 @@ static gboolean check_collision(Entity *one, Entity *two) {
 	return FALSE;
 }
 
-/* Finds which side of an object has been hit. Assumes that a collision has
- * actually occured */
-static Side find_hit_side(Ball *ball, Entity *one) {
+/* Finds which side of an object has been hit, going by where the ball was a
+ * step ago. Assumes that a collision has actually occured. This is good
+ * enough for the bat, which steers the ball itself; blocks use the exact
+ * ball_block_contact */
+Side find_hit_side(Ball *ball, Entity *one) {
 	gint x1, x2, y1, y2;
+	gdouble dx, dy;
 	Side side = SIDE_NONE;
 	
 	/* First, find out where the ball was -before- it hit */
-	x1 = ball->geometry.x1 - ((gdouble) ball->speed * sin(ball->direction));
-	x2 = ball->geometry.x2 - ((gdouble) ball->speed * sin(ball->direction));
-	y1 = ball->geometry.y1 - ((gdouble) ball->speed * cos(ball->direction));
-	y2 = ball->geometry.y2 - ((gdouble) ball->speed * cos(ball->direction));
+	if(ball->fixed_point) {
+		ball_step(ball, &dx, &dy);
+	} else {
+		dx = ball->speed * sin(ball->direction);
+		dy = ball->speed * cos(ball->direction);
+	}
+	x1 = ball->geometry.x1 - dx;
+	x2 = ball->geometry.x2 - dx;
+	y1 = ball->geometry.y1 - dy;
+	y2 = ball->geometry.y2 - dy;
 
 	/* Now, find out which side was hit based on where the ball was */
 	if((x1 > AX1 && x1 < AX2) || (x2 > AX1 && x2 < AX2) || (x1 < AX1 && x2 > AX2)) {
@@ -95,10 +129,20 @@ static Side find_hit_side(Ball *ball, Entity *one) {
 
 /* Changes a balls trajectory depending on which side of an object it hit. */
 static void recalculate_ball_trajectory(Game *game, Ball *ball, Side side) {
-
 	add_bounce_entropy(game, ball);
+	bounce_ball(ball, side);
+}
+
+/* Changes a ball's direction to bounce it off the given side of something.
+ * Unlike a bounce in the game, no entropy is added, so this is the path the
+ * ball would take with a bounce_entropy of 0. SIDE_DIAGONAL sends it back
+ * the way it came, as off the inside of a corner */
+void bounce_ball(Ball *ball, Side side) {
+	if(ball->fixed_point) {
+		bounce_ball_fixed(ball, side);
+		return;
+	}
 
-	/* Recalculate the trajectory */
 	switch(side) {
 		case SIDE_RIGHT :
 			ball->direction += (RAD90 - ball->direction) * 2.0;
@@ -132,54 +176,449 @@ static void recalculate_ball_trajectory(Game *game, Ball *ball, Side side) {
 
 	while(ball->direction < 0)
 		ball->direction += RAD360;
+}
+
+/* bounce_ball's change of direction, in angle steps */
+static void bounce_ball_fixed(Ball *ball, Side side) {
+	gint angle;
+
+	angle = angle_from_radians(ball->direction);
+	switch(side) {
+		case SIDE_RIGHT :
+			angle += (ANGLE_DEGREES(90) - angle) * 2;
+			break;
+		case SIDE_LEFT :
+			angle += (ANGLE_DEGREES(270) - angle) * 2;
+			break;
+		case SIDE_BOTTOM :
+			angle += (ANGLE_DEGREES(180) - angle) * 2;
+			break;
+		case SIDE_TOP :
+			angle += (ANGLE_STEPS - angle) * 2;
+			break;
+		case SIDE_DIAGONAL :
+			break;
+		default :
+			g_assert_not_reached();
+	}
+	angle += ANGLE_DEGREES(180);
 
-	/* And move it an extra step, so that the ball doesn't appear inside
-	 * the block when we refresh */
-	move_ball(ball);
+	ball->direction = angle_to_radians(angle_normalise(angle));
 }
 
-/* Checks whether the ball hit the block, and then adjusts accordingly. Returns
- * TRUE if a collision occured */
+/* Checks whether the ball hit any blocks, and then adjusts accordingly. The
+ * blocks are bounced off in the order the ball reached them, each being
+ * checked again after the ones before it, which may have moved the ball
+ * away or knocked it out. Returns TRUE if a collision occured */
 gboolean ball_block_collision(Game *game, Ball *ball) {
-	Side side;
+	gint block_nos[MAX_TOUCHED_BLOCKS];
+	Contact contact;
 	Block *block;
 	gboolean rval = FALSE;
-
-	block = find_block_from_position(game, (Entity *) ball);	
-	if(block) {
-		hit_block(game, block);
-		side = find_hit_side(ball, (Entity *) block);
-		if(side == SIDE_DIAGONAL)
-			side = find_block_hit_side(game, block, ball);
-		increase_ball_speed(game, ball);
-		recalculate_ball_trajectory(game, ball, side);
-		rval = TRUE;
+	gint num_blocks, i;
+
+	num_blocks = find_touched_blocks(game, ball, block_nos);
+	for(i = 0; i < num_blocks; i++) {
+		block = game->level->blocks[block_nos[i]];
+		if(block && block->type != BLOCK_DEAD
+				&& ball_block_contact(game, block, ball,
+					&contact)) {
+			hit_block(game, block);
+			increase_ball_speed(game, ball);
+			add_bounce_entropy(game, ball);
+			resolve_contact(ball, &contact);
+			rval = TRUE;
+		}
 	}
 	return rval;
 }
 
+/* Finds the live blocks that the ball is touching, and puts their numbers in
+ * block_nos, which holds MAX_TOUCHED_BLOCKS, in the order that the ball
+ * reached them on its last step. Blocks reached at the same time go in order
+ * of block number, so it doesn't matter which way round they were found.
+ * Returns how many there are */
+gint find_touched_blocks(Game *game, Ball *ball, gint *block_nos) {
+	Block *blocks[MAX_TOUCHED_BLOCKS];
+	Fixed times[MAX_TOUCHED_BLOCKS], time, x, y, sx, sy;
+	gdouble cx, cy, dx, dy, step_x, step_y;
+	Geometry *box;
+	gint num_blocks, found = 0, i, j;
+
+	/* Only the blocks under the ball can be touching it, and not all of
+	 * them are, as it's round */
+	num_blocks = find_blocks_in_area(game, &ball->geometry, blocks,
+			MAX_TOUCHED_BLOCKS);
+	cx = ball->pseudo_x1 + BALL_RADIUS;
+	cy = ball->pseudo_y1 + BALL_RADIUS;
+	for(i = 0; i < num_blocks; i++) {
+		box = &blocks[i]->geometry;
+		dx = cx - CLAMP(cx, box->x1, box->x2);
+		dy = cy - CLAMP(cy, box->y1, box->y2);
+		if(dx * dx + dy * dy < BALL_RADIUS * BALL_RADIUS)
+			blocks[found++] = blocks[i];
+	}
+	num_blocks = found;
+	for(i = 0; i < num_blocks; i++)
+		block_nos[i] = blocks[i]->block_no;
+	if(num_blocks < 2)
+		return num_blocks;
+
+	/* Where the centre of the ball was, and how far it went */
+	ball_step(ball, &step_x, &step_y);
+	sx = fixed_from_double(step_x);
+	sy = fixed_from_double(step_y);
+	x = fixed_from_double(cx) - sx;
+	y = fixed_from_double(cy) - sy;
+
+	/* Sorted as they're found. They're found in order of block number,
+	 * and a block only goes in front of later ones. One that the step
+	 * only just reaches can round to not reaching at all, and goes
+	 * last */
+	for(i = 0; i < num_blocks; i++) {
+		time = time_of_impact(blocks[i], x, y, sx, sy);
+		if(time < 0)
+			time = FIXED_ONE;
+		for(j = i; j > 0 && times[j - 1] > time; j--) {
+			times[j] = times[j - 1];
+			block_nos[j] = block_nos[j - 1];
+		}
+		times[j] = time;
+		block_nos[j] = blocks[i]->block_no;
+	}
+
+	return num_blocks;
+}
+
+/* How far through its step the ball, its centre going from x, y by sx, sy,
+ * first touched block, from 0 at the start to FIXED_ONE at the end, or -1 if
+ * it didn't. Grown by the ball's radius, the block is two boxes, one grown
+ * sideways and one up and down, and a circle round each corner, and this is
+ * when the centre first got into one of them. It's always worked out in
+ * fixed point, so that blocks are hit in the same order on every machine */
+static Fixed time_of_impact(Block *block, Fixed x, Fixed y, Fixed sx,
+		Fixed sy) {
+	Fixed r, x1, y1, x2, y2, time, at_x, at_y;
+
+	r = fixed_from_double(BALL_RADIUS);
+	x1 = block->geometry.x1 * FIXED_ONE;
+	y1 = block->geometry.y1 * FIXED_ONE;
+	x2 = block->geometry.x2 * FIXED_ONE;
+	y2 = block->geometry.y2 * FIXED_ONE;
+
+	/* Into the box round all of it, which is into one of the grown
+	 * boxes unless it's at a corner */
+	time = box_entry(x, y, sx, sy, x1 - r, y1 - r, x2 + r, y2 + r);
+	if(time < 0)
+		return -1;
+	at_x = x + fixed_mul(sx, time);
+	at_y = y + fixed_mul(sy, time);
+	if((at_x >= x1 && at_x <= x2) || (at_y >= y1 && at_y <= y2))
+		return time;
+
+	/* At a corner it either touches that corner, or goes past it into
+	 * one of the grown boxes. It can't get to another corner without
+	 * going through one of them first */
+	time = box_entry(x, y, sx, sy, x1 - r, y1, x2 + r, y2);
+	time = first_time(time, box_entry(x, y, sx, sy, x1, y1 - r, x2,
+				y2 + r));
+	return first_time(time, circle_entry(x, y, sx, sy,
+				at_x < x1 ? x1 : x2, at_y < y1 ? y1 : y2, r));
+}
+
+/* When, from 0 to FIXED_ONE, the point x, y moving by sx, sy first gets
+ * into the box x1, y1, x2, y2, or -1 if it doesn't. The times are kept as
+ * fractions, a distance over a speed, until the end, so there's only the
+ * one division */
+static Fixed box_entry(Fixed x, Fixed y, Fixed sx, Fixed sy, Fixed x1,
+		Fixed y1, Fixed x2, Fixed y2) {
+	gint64 enter[2] = { 0, 1 }, leave[2] = { 1, 1 };
+
+	if(!slab_entry(x, sx, x1, x2, enter, leave)
+			|| !slab_entry(y, sy, y1, y2, enter, leave))
+		return -1;
+
+	return (Fixed) (enter[0] * FIXED_ONE / enter[1]);
+}
+
+/* Narrows enter and leave, each a fraction, down to the time that x, moving
+ * by sx, is between lo and hi. Returns FALSE if it isn't then at all */
+static gboolean slab_entry(Fixed x, Fixed sx, Fixed lo, Fixed hi,
+		gint64 *enter, gint64 *leave) {
+	gint64 near, far, speed;
+
+	if(sx == 0)
+		return x >= lo && x <= hi;
+
+	near = sx > 0 ? lo - x : x - hi;
+	far = sx > 0 ? hi - x : x - lo;
+	speed = ABS(sx);
+	if(near * enter[1] > enter[0] * speed) {
+		enter[0] = near;
+		enter[1] = speed;
+	}
+	if(far * leave[1] < leave[0] * speed) {
+		leave[0] = far;
+		leave[1] = speed;
+	}
+
+	return enter[0] * leave[1] <= leave[0] * enter[1];
+}
+
+/* When, from 0 to FIXED_ONE, the point x, y moving by sx, sy first gets
+ * within r of px, py, or -1 if it doesn't. With d the way from px, py to
+ * x, y, this is the first root of |d + s t|^2 = r^2, which is
+ * a t^2 + 2 b t + c = 0 */
+static Fixed circle_entry(Fixed x, Fixed y, Fixed sx, Fixed sy, Fixed px,
+		Fixed py, Fixed r) {
+	gint64 dx, dy, a, b, c, time;
+
+	dx = x - px;
+	dy = y - py;
+	c = (dx * dx + dy * dy - (gint64) r * r) / FIXED_ONE;
+	if(c <= 0)
+		return 0;
+	b = (sx * dx + sy * dy) / FIXED_ONE;
+	a = ((gint64) sx * sx + (gint64) sy * sy) / FIXED_ONE;
+	if(b >= 0 || a == 0 || b * b < a * c)
+		return -1;
+
+	time = (-b - fixed_sqrt(b * b - a * c)) * FIXED_ONE / a;
+
+	return time <= FIXED_ONE ? (Fixed) time : -1;
+}
+
+/* The earlier of two times from time_of_impact */
+static Fixed first_time(Fixed a, Fixed b) {
+	if(a < 0)
+		return b;
+	if(b < 0)
+		return a;
+
+	return MIN(a, b);
+}
+
+/* Finds where the ball, which has just moved into block, touches it. The
+ * ball is round, and is tested against the block's edges and corners
+ * exactly. An edge that the block shares with a neighbour can't be hit, so
+ * a corner beside one is taken as part of the edge running past it. Returns
+ * FALSE if the ball doesn't touch the block, or is already moving away from
+ * it */
+gboolean ball_block_contact(Game *game, Block *block, Ball *ball,
+		Contact *contact) {
+	Geometry *box = &block->geometry;
+	gdouble cx, cy, dx, dy;
+	Side x_side, y_side;
+	gboolean x_open, y_open;
+
+	/* How far the centre of the ball is from the nearest point of the
+	 * block. Both are zero if it's inside */
+	cx = ball->pseudo_x1 + BALL_RADIUS;
+	cy = ball->pseudo_y1 + BALL_RADIUS;
+	dx = cx - CLAMP(cx, box->x1, box->x2);
+	dy = cy - CLAMP(cy, box->y1, box->y2);
+	x_side = dx < 0 ? SIDE_LEFT : SIDE_RIGHT;
+	y_side = dy < 0 ? SIDE_TOP : SIDE_BOTTOM;
+
+	if(dx != 0 && dy != 0) {
+		x_open = !block_has_neighbour(game, block, x_side);
+		y_open = !block_has_neighbour(game, block, y_side);
+		if(x_open && !y_open)
+			edge_contact(contact, x_side, BALL_RADIUS - fabs(dx));
+		else if(y_open && !x_open)
+			edge_contact(contact, y_side, BALL_RADIUS - fabs(dy));
+		else
+			corner_contact(ball, contact, dx, dy);
+	} else if(dx != 0) {
+		edge_contact(contact, x_side, BALL_RADIUS - fabs(dx));
+	} else if(dy != 0) {
+		edge_contact(contact, y_side, BALL_RADIUS - fabs(dy));
+	} else {
+		inside_contact(game, block, ball, contact, cx, cy);
+	}
+
+	return contact->depth > 0 && moving_into(ball, contact);
+}
+
+/* Fills in contact for the ball touching side of something, depth deep */
+static void edge_contact(Contact *contact, Side side, gdouble depth) {
+	contact->side = side;
+	contact->depth = depth;
+	switch(side) {
+		case SIDE_LEFT :
+			contact->normal = RAD270;
+			break;
+		case SIDE_RIGHT :
+			contact->normal = RAD90;
+			break;
+		case SIDE_TOP :
+			contact->normal = RAD180;
+			break;
+		case SIDE_BOTTOM :
+			contact->normal = 0;
+			break;
+		default :
+			g_assert_not_reached();
+	}
+}
+
+/* Fills in contact for the ball touching a corner, its centre being dx, dy
+ * from it */
+static void corner_contact(Ball *ball, Contact *contact, gdouble dx,
+		gdouble dy) {
+	Fixed x, y;
+
+	contact->side = SIDE_DIAGONAL;
+	if(ball->fixed_point) {
+		x = fixed_from_double(dx);
+		y = fixed_from_double(dy);
+		contact->normal = angle_to_radians(angle_from_vector(x, y));
+		contact->depth = fixed_to_double(fixed_from_double(BALL_RADIUS)
+				- fixed_hypot(x, y));
+	} else {
+		contact->normal = atan2(dx, dy);
+		contact->depth = BALL_RADIUS - sqrt(dx * dx + dy * dy);
+	}
+}
+
+/* Fills in contact for the ball when its centre, at cx, cy, has got inside
+ * block. It came in over the open edge that it crossed last */
+static void inside_contact(Game *game, Block *block, Ball *ball,
+		Contact *contact, gdouble cx, gdouble cy) {
+	Geometry *box = &block->geometry;
+	gdouble step_x, step_y, in_x, in_y;
+	Side x_side, y_side;
+	gboolean use_x;
+
+	/* The edges it could have come in over, and how far past each the
+	 * centre is */
+	ball_step(ball, &step_x, &step_y);
+	x_side = step_x > 0 ? SIDE_LEFT : SIDE_RIGHT;
+	in_x = step_x > 0 ? cx - box->x1 : box->x2 - cx;
+	y_side = step_y > 0 ? SIDE_TOP : SIDE_BOTTOM;
+	in_y = step_y > 0 ? cy - box->y1 : box->y2 - cy;
+
+	/* The one crossed last is the one it's least far past for how fast
+	 * it's moving across it, in_x / step_x against in_y / step_y */
+	use_x = in_x * fabs(step_y) < in_y * fabs(step_x);
+	if(block_has_neighbour(game, block, use_x ? x_side : y_side)
+			&& !block_has_neighbour(game, block,
+				use_x ? y_side : x_side))
+		use_x = !use_x;
+
+	if(use_x)
+		edge_contact(contact, x_side, BALL_RADIUS + in_x);
+	else
+		edge_contact(contact, y_side, BALL_RADIUS + in_y);
+}
+
+/* Whether the ball is heading into what it touches at contact */
+static gboolean moving_into(Ball *ball, Contact *contact) {
+	gdouble step_x, step_y;
+
+	ball_step(ball, &step_x, &step_y);
+	switch(contact->side) {
+		case SIDE_LEFT :
+			return step_x > 0;
+		case SIDE_RIGHT :
+			return step_x < 0;
+		case SIDE_TOP :
+			return step_y > 0;
+		case SIDE_BOTTOM :
+			return step_y < 0;
+		case SIDE_DIAGONAL :
+			if(ball->fixed_point)
+				return fixed_cos(angle_from_radians(
+						ball->direction)
+					- angle_from_radians(contact->normal))
+					< 0;
+			return cos(ball->direction - contact->normal) < 0;
+		default :
+			g_assert_not_reached();
+	}
+
+	return FALSE;
+}
+
+/* Bounces ball off what it touches at contact, if it's heading into it,
+ * and moves it back out along the normal to where it only just touches.
+ * There's no extra step, so the ball is never moved into anything else */
+void resolve_contact(Ball *ball, Contact *contact) {
+	Fixed depth;
+	gint normal;
+
+	if(moving_into(ball, contact)) {
+		if(contact->side == SIDE_DIAGONAL)
+			reflect_ball(ball, contact->normal);
+		else
+			bounce_ball(ball, contact->side);
+	}
+
+	switch(contact->side) {
+		case SIDE_LEFT :
+			ball->pseudo_x1 -= contact->depth;
+			break;
+		case SIDE_RIGHT :
+			ball->pseudo_x1 += contact->depth;
+			break;
+		case SIDE_TOP :
+			ball->pseudo_y1 -= contact->depth;
+			break;
+		case SIDE_BOTTOM :
+			ball->pseudo_y1 += contact->depth;
+			break;
+		case SIDE_DIAGONAL :
+			if(ball->fixed_point) {
+				depth = fixed_from_double(contact->depth);
+				normal = angle_from_radians(contact->normal);
+				ball->pseudo_x1 += fixed_to_double(fixed_mul(
+						depth, fixed_sin(normal)));
+				ball->pseudo_y1 += fixed_to_double(fixed_mul(
+						depth, fixed_cos(normal)));
+			} else {
+				ball->pseudo_x1 += contact->depth
+					* sin(contact->normal);
+				ball->pseudo_y1 += contact->depth
+					* cos(contact->normal);
+			}
+			break;
+		default :
+			g_assert_not_reached();
+	}
+
+	place_ball(ball);
+}
+
+/* Reflects the ball's direction off a surface facing normal */
+static void reflect_ball(Ball *ball, gdouble normal) {
+	gint angle;
+
+	if(ball->fixed_point) {
+		angle = angle_from_radians(normal) * 2 + ANGLE_DEGREES(180)
+			- angle_from_radians(ball->direction);
+		ball->direction = angle_to_radians(angle_normalise(angle));
+		return;
+	}
+
+	ball->direction = normal * 2.0 + RAD180 - ball->direction;
+	while(ball->direction > RAD360)
+		ball->direction -= RAD360;
+	while(ball->direction < 0)
+		ball->direction += RAD360;
+}
+
 /* Checks whether the ball hit the wall, and then adjusts accordingly. Returns
  * TRUE if the ball has died, not if a collision occurs. */
 gboolean ball_wall_collision(Game *game, Ball *ball) {
 	gboolean ball_dead = FALSE;
+	Side side;
 
-	if(ball->geometry.x1 < 0) {
-		if(ball->geometry.y1 < 0) {
-			recalculate_ball_trajectory(game, ball, SIDE_DIAGONAL);
-		} else {
-			recalculate_ball_trajectory(game, ball, SIDE_RIGHT);
-		}
-	} else if(ball->geometry.x2 > GAME_WIDTH) {
-		if(ball->geometry.y1 < 0) {
-			recalculate_ball_trajectory(game, ball, SIDE_DIAGONAL);
-		} else {
-			recalculate_ball_trajectory(game, ball, SIDE_LEFT);
-		}
-	} else if(ball->geometry.y1 < 0) {
-		recalculate_ball_trajectory(game, ball, SIDE_BOTTOM);
-	} else if(ball->geometry.y2 > GAME_HEIGHT) {
+	side = ball_wall_side(game->level, ball);
+	if(side != SIDE_NONE) {
+		recalculate_ball_trajectory(game, ball, side);
+		keep_ball_in(game->level, ball);
+	} else if(ball->geometry.y2 > GAME_HEIGHT(game->level))
 		ball_dead = TRUE;
-	}
 
 	/* Make sure the ball isn't -still- outside the boundaries */
 	/*if(check_ball) {
@@ -187,9 +626,9 @@ gboolean ball_wall_collision(Game *game, Ball *ball) {
 			ball->geometry.x1 = 0;
 			ball->geometry.x2 = BALL_WIDTH;
 		}
-		if(ball->geometry.x2 > GAME_WIDTH) {
-			ball->geometry.x1 = GAME_WIDTH - BALL_WIDTH;
-			ball->geometry.x2 = GAME_WIDTH;
+		if(ball->geometry.x2 > GAME_WIDTH(game->level)) {
+			ball->geometry.x1 = GAME_WIDTH(game->level) - BALL_WIDTH;
+			ball->geometry.x2 = GAME_WIDTH(game->level);
 		}
 		if(ball->geometry.y1 < 0) {
 			ball->geometry.y1 = 0;
@@ -200,6 +639,36 @@ gboolean ball_wall_collision(Game *game, Ball *ball) {
 	return ball_dead;
 }
 
+/* Which side of the ball the walls of level bounce it off, or SIDE_NONE if
+ * it isn't outside them. Falling out of the bottom isn't a bounce */
+Side ball_wall_side(Level *level, Ball *ball) {
+	if(ball->geometry.x1 < 0) {
+		if(ball->geometry.y1 < 0)
+			return SIDE_DIAGONAL;
+		else
+			return SIDE_RIGHT;
+	} else if(ball->geometry.x2 > GAME_WIDTH(level)) {
+		if(ball->geometry.y1 < 0)
+			return SIDE_DIAGONAL;
+		else
+			return SIDE_LEFT;
+	} else if(ball->geometry.y1 < 0) {
+		return SIDE_BOTTOM;
+	}
+
+	return SIDE_NONE;
+}
+
+/* Moves the ball back inside the walls of level, if it has gone through
+ * them */
+void keep_ball_in(Level *level, Ball *ball) {
+	ball->pseudo_x1 = CLAMP(ball->pseudo_x1, 0,
+			GAME_WIDTH(level) - BALL_WIDTH);
+	if(ball->pseudo_y1 < 0)
+		ball->pseudo_y1 = 0;
+	place_ball(ball);
+}
+
 /* Checks whether the bat 'caught' a powerup, and acts accordingly. Returns
  * TRUE if a collision occured */
 gboolean bat_powerup_collision(Game *game, Powerup *powerup) {
@@ -220,7 +689,13 @@ gboolean ball_bat_collision(Ball *ball, Bat *bat) {
 
 	if(check_collision((Entity *) ball, (Entity *) bat)) {
 		side = find_hit_side(ball, (Entity *) bat);
-		if(side != SIDE_BOTTOM) {
+		if(ball->fixed_point) {
+			if(side != SIDE_BOTTOM)
+				bat_bounce_fixed(ball, bat);
+			else
+				bounce_ball_fixed(ball, SIDE_BOTTOM);
+			move_ball(ball);
+		} else if(side != SIDE_BOTTOM) {
 			ballpos = ball->geometry.x1 + BALL_WIDTH / 2;
 			batpos = bat->geometry.x1 + bat->width / 2;
 			ballper = (double) (batpos - ballpos) /
@@ -240,9 +715,17 @@ gboolean ball_bat_collision(Ball *ball, Bat *bat) {
 
 			move_ball(ball);
 		} else {
-			/* The ball should never rebound off of the bottom wall
-			 * , therefore this should never happen */
-			g_assert_not_reached();
+			/* The ball has come up at the bat from underneath,
+			 * which it can if it's sent off in a new direction
+			 * after it's got below the bat. It bounces back
+			 * down */
+			ball->direction += (RAD180 - ball->direction) * 2.0;
+			ball->direction += RAD180;
+			while(ball->direction > RAD360)
+				ball->direction -= RAD360;
+			while(ball->direction < 0)
+				ball->direction += RAD360;
+			move_ball(ball);
 		}
 
 		return TRUE;
@@ -251,85 +734,43 @@ gboolean ball_bat_collision(Ball *ball, Bat *bat) {
 	return FALSE;
 }
 
-/* Attempts to determine what side was hit if a standard find_hit_side
- * returns SIDE_DIAGONAL. The result is based on the neighbours of the block
- */
-static Side find_block_hit_side(Game *game, Block *block, Ball *ball) {
-	gint x1, y1, block_x, block_y, ball_x, ball_y;
-	gboolean ball_is_above, ball_is_left;
-	gboolean above, below, left, right;
-	Side ret = SIDE_DIAGONAL;
+/* ball_bat_collision's bounce off the top of the bat, in angle steps */
+static void bat_bounce_fixed(Ball *ball, Bat *bat) {
+	gint ballpos, batpos, batangle, angle;
 
-	/* First, find out where the ball was -before- it hit */
-	x1 = ball->geometry.x1 - ((gdouble) ball->speed * sin(ball->direction));
-	y1 = ball->geometry.y1 - ((gdouble) ball->speed * cos(ball->direction));
-	
-	/* Now get an approximation of where the ball is coming from. Instead
-	 * of using standard collision detection methods, we'll base it on
-	 * the center of each object */
-	block_x = block->geometry.x1 + BLOCK_WIDTH / 2;
-	block_y = block->geometry.y1 + BLOCK_HEIGHT / 2;
-	ball_x = x1 + BALL_WIDTH / 2;
-	ball_y = y1 + BALL_HEIGHT / 2;
-
-	if(ball_x < block_x)
-		ball_is_left = TRUE;
-	else
-		ball_is_left = FALSE;
+	ballpos = ball->geometry.x1 + BALL_WIDTH / 2;
+	batpos = bat->geometry.x1 + bat->width / 2;
+	batangle = (batpos - ballpos) * ANGLE_DEGREES(30) / (bat->width / 2)
+		+ ANGLE_DEGREES(180);
 
-	if(ball_y < block_y)
-		ball_is_above = TRUE;
-	else
-		ball_is_above = FALSE;
-
-	/* Find out the neighbours of the block */	
-	above = block_has_neighbour(game, block, SIDE_TOP);
-	below = block_has_neighbour(game, block, SIDE_BOTTOM);
-	left = block_has_neighbour(game, block, SIDE_LEFT);
-	right = block_has_neighbour(game, block, SIDE_RIGHT);
-
-	if(ball_is_above && ball_is_left) {
-		if(above && !left)
-			ret = SIDE_LEFT;
-		else if(left && !above)
-			ret = SIDE_TOP;
-		else
-			ret = SIDE_DIAGONAL;
-	} else if(ball_is_above && !ball_is_left) {
-		if(above && !right)
-			ret = SIDE_RIGHT;
-		else if(right && !above)
-			ret = SIDE_TOP;
-		else
-			ret = SIDE_DIAGONAL;
-	} else if(!ball_is_above && ball_is_left) {
-		if(below && !left)
-			ret = SIDE_LEFT;
-		else if(left && !below)
-			ret = SIDE_BOTTOM;
-		else
-			ret = SIDE_DIAGONAL;
-	} else if(!ball_is_above && !ball_is_left) {
-		if(below && !right)
-			ret = SIDE_RIGHT;
-		else if(right && !below)
-			ret = SIDE_BOTTOM;
-		else
-			ret = SIDE_DIAGONAL;
-	} else {
-		g_assert_not_reached();
-	}
+	angle = angle_from_radians(ball->direction);
+	angle += (batangle - angle) * 2;
+	angle += ANGLE_DEGREES(180);
+	while(angle > ANGLE_STEPS)
+		angle -= ANGLE_STEPS;
 
-	return ret;
+	angle = CLAMP(angle, BAT_LOW_CAP_ANGLE, BAT_HIGH_CAP_ANGLE);
+	ball->direction = angle_to_radians(angle);
 }
 
 /* Applies the bounce entropy to a ball's trajectory. */
 static void add_bounce_entropy(Game *game, Ball *ball) {
 	gdouble diff;
+	gint range;
+
+	/* The same spread, half of bounce_entropy percent of a half turn
+	 * either way, in whole angle steps */
+	if(ball->fixed_point) {
+		range = game->flags->bounce_entropy * ANGLE_STEPS / 400;
+		ball->direction = angle_to_radians(angle_normalise(
+				angle_from_radians(ball->direction)
+				+ rng_range(&game->rng, range * 2 + 1) - range));
+		return;
+	}
 
 	diff = (gdouble) game->flags->bounce_entropy / 100;
 	diff *= RAD180;
-	diff *= ((gdouble) rand() / RAND_MAX - 0.5);
+	diff *= rng_double(&game->rng) - 0.5;
 
 	ball->direction += diff;
 }
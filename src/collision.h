@@ -7,7 +7,19 @@
  * "COPYING" for more details.
  */
 
+/* The most blocks a ball can touch at once. It's smaller than a block, so
+ * it can only be over four */
+#define MAX_TOUCHED_BLOCKS 4
+
 gboolean ball_block_collision(Game *game, Ball *ball);
 gboolean ball_wall_collision(Game *game, Ball *ball);
 gboolean bat_powerup_collision(Game *game, Powerup *powerup);
 gboolean ball_bat_collision(Ball *ball, Bat *bat);
+gboolean ball_block_contact(Game *game, Block *block, Ball *ball,
+		Contact *contact);
+void resolve_contact(Ball *ball, Contact *contact);
+gint find_touched_blocks(Game *game, Ball *ball, gint *block_nos);
+Side find_hit_side(Ball *ball, Entity *one);
+Side ball_wall_side(Level *level, Ball *ball);
+void keep_ball_in(Level *level, Ball *ball);
+void bounce_ball(Ball *ball, Side side);
@@ -0,0 +1,202 @@
+/*
+ * Q16.16 fixed point arithmetic and a sine table, for games played with
+ * fixed point physics (see Game.fixed_point). The libm sin and cos, and
+ * floating point arithmetic in general, can come out differently between
+ * compilers, optimisation levels and machines, and a replay of a game only
+ * plays back if every step of the game comes out the same. Integer
+ * arithmetic always does.
+ *
+ * The ball keeps its position and speed in gdoubles either way. In a fixed
+ * point game they only ever hold Q16.16 values, and its direction only ever
+ * holds a whole number of angle steps, all of which a gdouble holds exactly.
+ * So they can be turned into Fixeds and angles, worked on with the
+ * functions here, and turned back, without anything being lost or depending
+ * on how the machine rounds.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "fixed.h"
+#include <math.h>
+
+#define QUARTER_TURN ANGLE_DEGREES(90)
+
+/* An angle step in radians */
+#define ANGLE_RADIANS (2.0 * 3.14159265358979323846 / ANGLE_STEPS)
+
+/* Internal Variables */
+
+/* sin of each angle step from 0 to 90 degrees, as Q16.16. Made with
+ *   floor(sin(i * pi / 720) * 65536 + 0.5)
+ * for i from 0 to 360, and kept here rather than worked out at startup so
+ * that it can't differ from one libm to the next */
+static const Fixed sin_table[QUARTER_TURN + 1] = {
+	0, 286, 572, 858, 1144, 1430, 1716, 2001,
+	2287, 2573, 2859, 3144, 3430, 3715, 4001, 4286,
+	4572, 4857, 5142, 5427, 5712, 5997, 6281, 6566,
+	6850, 7135, 7419, 7703, 7987, 8271, 8554, 8838,
+	9121, 9404, 9687, 9970, 10252, 10534, 10817, 11098,
+	11380, 11662, 11943, 12224, 12505, 12785, 13066, 13346,
+	13626, 13905, 14185, 14464, 14742, 15021, 15299, 15577,
+	15855, 16132, 16409, 16686, 16962, 17238, 17514, 17789,
+	18064, 18339, 18613, 18887, 19161, 19434, 19707, 19980,
+	20252, 20524, 20795, 21066, 21336, 21607, 21876, 22146,
+	22415, 22683, 22951, 23219, 23486, 23753, 24019, 24285,
+	24550, 24815, 25080, 25343, 25607, 25870, 26132, 26394,
+	26656, 26917, 27177, 27437, 27697, 27956, 28214, 28472,
+	28729, 28986, 29242, 29498, 29753, 30007, 30261, 30515,
+	30767, 31019, 31271, 31522, 31772, 32022, 32271, 32520,
+	32768, 33015, 33262, 33508, 33754, 33998, 34242, 34486,
+	34729, 34971, 35212, 35453, 35693, 35933, 36172, 36410,
+	36647, 36884, 37120, 37355, 37590, 37824, 38057, 38289,
+	38521, 38752, 38982, 39212, 39441, 39669, 39896, 40122,
+	40348, 40573, 40797, 41021, 41243, 41465, 41686, 41906,
+	42126, 42344, 42562, 42779, 42995, 43211, 43425, 43639,
+	43852, 44064, 44275, 44486, 44695, 44904, 45112, 45319,
+	45525, 45730, 45935, 46138, 46341, 46543, 46744, 46944,
+	47143, 47341, 47538, 47735, 47930, 48125, 48318, 48511,
+	48703, 48894, 49084, 49273, 49461, 49648, 49834, 50019,
+	50203, 50387, 50569, 50751, 50931, 51111, 51289, 51467,
+	51643, 51819, 51993, 52167, 52339, 52511, 52682, 52851,
+	53020, 53187, 53354, 53519, 53684, 53847, 54010, 54171,
+	54332, 54491, 54650, 54807, 54963, 55118, 55273, 55426,
+	55578, 55729, 55879, 56028, 56175, 56322, 56468, 56612,
+	56756, 56898, 57040, 57180, 57319, 57457, 57594, 57730,
+	57865, 57999, 58131, 58263, 58393, 58522, 58650, 58777,
+	58903, 59028, 59152, 59274, 59396, 59516, 59635, 59753,
+	59870, 59986, 60100, 60214, 60326, 60437, 60547, 60656,
+	60764, 60870, 60976, 61080, 61183, 61285, 61386, 61485,
+	61584, 61681, 61777, 61872, 61966, 62058, 62149, 62239,
+	62328, 62416, 62503, 62588, 62672, 62755, 62837, 62918,
+	62997, 63075, 63152, 63228, 63303, 63376, 63449, 63520,
+	63589, 63658, 63725, 63791, 63856, 63920, 63983, 64044,
+	64104, 64163, 64220, 64277, 64332, 64386, 64439, 64490,
+	64540, 64589, 64637, 64684, 64729, 64773, 64816, 64858,
+	64898, 64937, 64975, 65012, 65048, 65082, 65115, 65146,
+	65177, 65206, 65234, 65261, 65287, 65311, 65334, 65356,
+	65376, 65396, 65414, 65431, 65446, 65461, 65474, 65485,
+	65496, 65505, 65514, 65520, 65526, 65530, 65534, 65535,
+	65536
+};
+
+/* Returns the nearest Fixed to value. This is exact for a value that came
+ * from fixed_to_double */
+Fixed fixed_from_double(gdouble value) {
+	return (Fixed) floor(value * FIXED_ONE + 0.5);
+}
+
+gdouble fixed_to_double(Fixed value) {
+	return (gdouble) value / FIXED_ONE;
+}
+
+/* Returns a * b, rounded down */
+Fixed fixed_mul(Fixed a, Fixed b) {
+	gint64 product;
+
+	product = (gint64) a * b;
+	if(product < 0)
+		return (Fixed) -((-product + FIXED_ONE - 1) >> FIXED_SHIFT);
+
+	return (Fixed) (product >> FIXED_SHIFT);
+}
+
+/* Returns the length of the vector x, y, rounded down */
+Fixed fixed_hypot(Fixed x, Fixed y) {
+	return fixed_sqrt((guint64) ((gint64) x * x)
+			+ (guint64) ((gint64) y * y));
+}
+
+/* Returns the square root of square, a Q32.32 number such as the product of
+ * two Fixeds, rounded down */
+Fixed fixed_sqrt(guint64 square) {
+	guint64 root;
+
+	/* The square root of a Q32.32 number is a Q16.16 one. sqrt gets
+	 * within one or two of it, and it's then put right exactly, so that
+	 * it's the same on every machine */
+	root = (guint64) sqrt((gdouble) square);
+	while(root > G_MAXUINT32 || root * root > square)
+		root--;
+	while(root < G_MAXUINT32 && (root + 1) * (root + 1) <= square)
+		root++;
+
+	return (Fixed) root;
+}
+
+/* Returns the nearest value to value that a Fixed can hold */
+gdouble fixed_quantise(gdouble value) {
+	return fixed_to_double(fixed_from_double(value));
+}
+
+Fixed fixed_sin(gint angle) {
+	angle = angle_normalise(angle);
+
+	if(angle <= QUARTER_TURN)
+		return sin_table[angle];
+	else if(angle <= QUARTER_TURN * 2)
+		return sin_table[QUARTER_TURN * 2 - angle];
+	else if(angle <= QUARTER_TURN * 3)
+		return -sin_table[angle - QUARTER_TURN * 2];
+	else
+		return -sin_table[QUARTER_TURN * 4 - angle];
+}
+
+Fixed fixed_cos(gint angle) {
+	return fixed_sin(angle + QUARTER_TURN);
+}
+
+/* Returns angle turned into the range 0 to ANGLE_STEPS - 1 */
+gint angle_normalise(gint angle) {
+	angle %= ANGLE_STEPS;
+	if(angle < 0)
+		angle += ANGLE_STEPS;
+
+	return angle;
+}
+
+/* Returns the nearest whole angle step to radians. This is exact for
+ * radians that came from angle_to_radians */
+gint angle_from_radians(gdouble radians) {
+	return (gint) floor(radians / ANGLE_RADIANS + 0.5);
+}
+
+/* Returns the angle that a ball moving x across and y down the screen is
+ * heading in, to the nearest angle step. This is atan2(x, y), without the
+ * libm */
+gint angle_from_vector(Fixed x, Fixed y) {
+	gint64 ax, ay;
+	gint low = 0, high = QUARTER_TURN, mid, angle;
+
+	ax = ABS((gint64) x);
+	ay = ABS((gint64) y);
+
+	/* The first angle in the quarter turn that is at least as far round
+	 * as ax, ay, going by sin(angle) * ay against cos(angle) * ax */
+	while(low < high) {
+		mid = (low + high) / 2;
+		if(sin_table[mid] * ay >= sin_table[QUARTER_TURN - mid] * ax)
+			high = mid;
+		else
+			low = mid + 1;
+	}
+	angle = low;
+	if(angle > 0 && sin_table[angle] * ay - sin_table[QUARTER_TURN - angle]
+			* ax > sin_table[QUARTER_TURN - angle + 1] * ax
+			- sin_table[angle - 1] * ay)
+		angle--;
+
+	if(y < 0)
+		angle = QUARTER_TURN * 2 - angle;
+	if(x < 0)
+		angle = ANGLE_STEPS - angle;
+
+	return angle_normalise(angle);
+}
+
+gdouble angle_to_radians(gint angle) {
+	return angle * ANGLE_RADIANS;
+}
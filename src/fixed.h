@@ -0,0 +1,33 @@
+/*
+ * Fixed point numbers and angles, for physics that comes out the same on
+ * every machine
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+/* A Q16.16 number: 16 bits of whole number and 16 of fraction */
+typedef gint32 Fixed;
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE (1 << FIXED_SHIFT)
+
+/* Angles are whole numbers of quarter degrees, going clockwise from straight
+ * down the screen as the radians in a Ball do */
+#define ANGLE_STEPS 1440
+#define ANGLE_DEGREES(degrees) ((degrees) * ANGLE_STEPS / 360)
+
+Fixed fixed_from_double(gdouble value);
+gdouble fixed_to_double(Fixed value);
+Fixed fixed_mul(Fixed a, Fixed b);
+Fixed fixed_hypot(Fixed x, Fixed y);
+Fixed fixed_sqrt(guint64 square);
+gdouble fixed_quantise(gdouble value);
+Fixed fixed_sin(gint angle);
+Fixed fixed_cos(gint angle);
+gint angle_normalise(gint angle);
+gint angle_from_radians(gdouble radians);
+gint angle_from_vector(Fixed x, Fixed y);
+gdouble angle_to_radians(gint angle);
@@ -27,6 +27,7 @@
 #define DEFAULT_RIGHT_KEY GDK_Right
 #define DEFAULT_FIRE1_KEY GDK_z
 #define DEFAULT_FIRE2_KEY GDK_x
+#define DEFAULT_REWIND_KEY GDK_BackSpace
 #define DEFAULT_BOUNCE_ENTROPY 0
 #define DEFAULT_LEVEL_FILES (LEVELDIR "/alcaron.gbl;" LEVELDIR "/mdutour.gbl;" LEVELDIR "/mmack.gbl")
 
@@ -101,6 +102,10 @@ Flags *load_flags(void) {
 	flags->fire2_key = gnome_config_get_int(tmp);
 	g_free(tmp);
 
+	tmp = g_strdup_printf("keys/rewind_key=%d", DEFAULT_REWIND_KEY);
+	flags->rewind_key = gnome_config_get_int(tmp);
+	g_free(tmp);
+
 	tmp = g_strdup_printf("game/level_files=%s", DEFAULT_LEVEL_FILES);
 	flags->level_files = unpack_string_list(gnome_config_get_string(tmp));
 	g_free(tmp);
@@ -111,6 +116,33 @@ Flags *load_flags(void) {
 	return flags;
 }
 
+/* Makes the flags for the tools that play without the GUI, rather than
+ * loading the user's. The bat is moved by the mouse at its slowest, and the
+ * game is played at difficulty, which is "easy", "medium" or "hard". Returns
+ * NULL, having said so, for any other difficulty */
+Flags *load_tool_flags(const gchar *difficulty) {
+	Flags *flags;
+
+	flags = g_malloc0(sizeof(Flags));
+	flags->mouse_control = TRUE;
+	flags->bat_speed = MIN_BATSPEED;
+	if(!strcmp(difficulty, "easy")) {
+		flags->difficulty = DIFFICULTY_EASY;
+	} else if(!strcmp(difficulty, "medium")) {
+		flags->difficulty = DIFFICULTY_MEDIUM;
+	} else if(!strcmp(difficulty, "hard")) {
+		flags->difficulty = DIFFICULTY_HARD;
+	} else {
+		g_printerr("Unknown difficulty %s\n", difficulty);
+		g_free(flags);
+		return NULL;
+	}
+	flags->next_game_difficulty = flags->difficulty;
+	compute_flags(flags);
+
+	return flags;
+}
+
 /* Computes the difficulty modifiers of Flags, and makes various config sanity 
  * checks */
 void compute_flags(Flags *flags) {
@@ -214,6 +246,7 @@ void save_flags(Flags *flags) {
 	gnome_config_set_int("keys/right_key", flags->right_key);
 	gnome_config_set_int("keys/fire1_key", flags->fire1_key);
 	gnome_config_set_int("keys/fire2_key", flags->fire2_key);
+	gnome_config_set_int("keys/rewind_key", flags->rewind_key);
 	tmp = pack_string_list(flags->level_files);
 	gnome_config_set_string("game/level_files", tmp);
 	g_free(tmp);	
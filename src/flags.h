@@ -9,6 +9,7 @@
  */
 
 Flags *load_flags(void);
+Flags *load_tool_flags(const gchar *difficulty);
 void save_flags(Flags *flags);
 void compute_flags(Flags *flags);
 Flags *copy_flags(Flags *flags);
@@ -8,6 +8,7 @@
  */
 
 #include <sys/time.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "breakout.h"
@@ -20,6 +21,17 @@
 #include "powerup.h"
 #include "flags.h"
 #include "leveldata.h"
+#include "prefetch.h"
+#include "levelparse.h"
+#include "levelgen.h"
+#include "rng.h"
+#include "replay.h"
+#include "savegame.h"
+#include "rewind.h"
+#include "bot.h"
+#include "trajectory.h"
+#include "memstats.h"
+#include "trace.h"
 
 #define NUM_LIVES 5
 
@@ -27,63 +39,259 @@
 static gboolean left_ispressed = FALSE;
 static gboolean right_ispressed = FALSE;
 
-#define FRAMES_PER_SECOND 50
 #define USEC_PER_SEC 1000000
 #define USEC_PER_FRAME (USEC_PER_SEC / FRAMES_PER_SECOND)
 
 #define NEWLIFESCORE 20000
 #define NEXTLEVELSCORE 5000
 
+/* How many ticks to run between looking at the clock, when skipping ahead */
+#define SKIP_CHECK_TICKS 64
+
+/* Internal Functions */
+static gboolean play_frame(Game *game);
+static void play_tick(Game *game);
+static void skip_ahead(Game *game, struct timeval *start_tv);
+static Level *load_level(Game *game, gint level_num);
+
+/* Runs the game until it stops or is paused. Each frame runs time_scale ticks
+ * and then draws the result once, so drawing costs the same whatever the
+ * scale. While skipping ahead to fast_forward_to nothing is drawn at all */
 void iterate_game(Game * game)
+{
+	gboolean running;
+
+	while (game->state == STATE_RUNNING) {
+		TRACE_BEGIN("frame");
+		running = play_frame(game);
+		TRACE_END("frame");
+		if (!running)
+			break;
+	}
+}
+
+/* Runs and draws one frame for iterate_game, then sleeps out the rest of it.
+ * Returns FALSE if the game stopped part way through */
+static gboolean play_frame(Game * game)
 {
 	struct timeval start_tv, end_tv;
 	struct timezone tz;
 	gint32 diff_t;
-	int stop;
+	gint i;
 
-	while (game->state == STATE_RUNNING) {
-		gettimeofday(&start_tv, &tz);
-		game->mouse_move = get_mouse_x_position();
+	gettimeofday(&start_tv, &tz);
+	game->mouse_move = get_mouse_x_position();
 
-		iterate_bat(game);
-		iterate_balls(game);
-		iterate_powerups(game);
-		iterate_blocks(game);
-	
-		stop = 0;
+	if (game->rewind_pressed) {
+		game->rewind_pressed = FALSE;
+		TRACE_BEGIN("rewind");
+		rewind_game(game);
+		TRACE_END("rewind");
+	}
 
-		process_events(game);
+	if (game->ticks < game->fast_forward_to) {
+		TRACE_BEGIN("skip_ahead");
+		skip_ahead(game, &start_tv);
+		TRACE_END("skip_ahead");
+		if (game->state == STATE_RUNNING) {
+			TRACE_BEGIN("iterate_prefetch");
+			iterate_prefetch(game);
+			TRACE_END("iterate_prefetch");
+		}
+		TRACE_BEGIN("process_gnome_events");
+		process_gnome_events();
+		TRACE_END("process_gnome_events");
+		return TRUE;
+	}
 
-        	gui_update_game(game);
+	TRACE_BEGIN("ticks");
+	if (game->time_scale > 1) {
+		gui_defer_canvas(TRUE);
+		for (i = 0; i < game->time_scale
+				&& game->state == STATE_RUNNING; i++)
+			play_tick(game);
+		gui_defer_canvas(FALSE);
+		if (game->state == STATE_RUNNING)
+			gui_sync_canvas(game);
+	} else {
+		play_tick(game);
+	}
+	TRACE_END("ticks");
+	if (game->state != STATE_RUNNING)
+		return FALSE;
+
+	/* This puts blocks on the canvas, so it's done once a frame, however
+	 * many ticks the frame ran, and not from step_game */
+	TRACE_BEGIN("iterate_prefetch");
+	iterate_prefetch(game);
+	TRACE_END("iterate_prefetch");
+
+	TRACE_BEGIN("gui_update_game");
+	gui_update_game(game);
+	TRACE_END("gui_update_game");
+
+	TRACE_BEGIN("process_gnome_events");
+	process_gnome_events();
+	TRACE_END("process_gnome_events");
+
+	gettimeofday(&end_tv, &tz);
+	diff_t = ((start_tv.tv_sec - end_tv.tv_sec) * USEC_PER_SEC)
+	    + (start_tv.tv_usec - end_tv.tv_usec)
+	    + USEC_PER_FRAME;
+
+	if (diff_t > 0) {
+		TRACE_BEGIN("sleep");
+		usleep(diff_t);
+		TRACE_END("sleep");
+	}
 
-		game->fire1_pressed = FALSE;
-		game->fire2_pressed = FALSE;
+	return TRUE;
+}
 
-		process_gnome_events();
+/* Runs one tick for iterate_game, with the input from the replay being
+ * watched or the bot if there is one, and takes a snapshot to rewind to if
+ * it's time */
+static void play_tick(Game * game)
+{
+	if (game->playback) {
+		if (!replay_play_tick(game->playback, game)) {
+			end_game(game, ENDGAME_MENU);
+			return;
+		}
+	} else if (game->bot) {
+		bot_tick(game->bot, game);
+	}
 
-		gettimeofday(&end_tv, &tz);
-		diff_t = ((start_tv.tv_sec - end_tv.tv_sec) * USEC_PER_SEC)
-		    + (start_tv.tv_usec - end_tv.tv_usec)
-		    + USEC_PER_FRAME;
+	step_game(game);
+	if (game->rewind)
+		rewind_tick(game->rewind, game);
+}
 
-		if (diff_t > 0)
-			usleep(diff_t);
+/* Runs ticks, without drawing, until fast_forward_to is reached or a frame's
+ * worth of time has gone by, so that the window still gets seen to while a
+ * long way is skipped. The canvas is brought up to date once at the end */
+static void skip_ahead(Game * game, struct timeval *start_tv)
+{
+	struct timeval now_tv;
+	struct timezone tz;
+	gint32 diff_t;
+	gint i;
+
+	gui_defer_canvas(TRUE);
+	do {
+		for (i = 0; i < SKIP_CHECK_TICKS
+				&& game->ticks < game->fast_forward_to
+				&& game->state == STATE_RUNNING; i++)
+			play_tick(game);
+		gettimeofday(&now_tv, &tz);
+		diff_t = ((now_tv.tv_sec - start_tv->tv_sec) * USEC_PER_SEC)
+		    + (now_tv.tv_usec - start_tv->tv_usec);
+	} while (game->ticks < game->fast_forward_to
+			&& game->state == STATE_RUNNING
+			&& diff_t < USEC_PER_FRAME);
+	gui_defer_canvas(FALSE);
+
+	if (game->state == STATE_RUNNING
+			&& game->ticks >= game->fast_forward_to) {
+		gui_sync_canvas(game);
+		gui_update_game(game);
 	}
 }
 
-/* Makes a new game, and starts it up */
-void run_game(Game * game)
+/* Advances the game by one tick, using the input in game. This is
+ * everything that affects play, and nothing that doesn't, so that it can be
+ * driven without the GUI. The input, and the state it leads to, are recorded
+ * if the game is being recorded, or checked if it's being played back */
+void step_game(Game * game)
+{
+	game->ticks++;
+
+	if (game->recording)
+		replay_record_tick(game->recording, game);
+
+	if (game->kill_ball_pressed) {
+		if (game->balls)
+			ball_die(game, (Ball *) game->balls->data);
+		game->kill_ball_pressed = FALSE;
+	}
+
+	TRACE_BEGIN("iterate_bat");
+	iterate_bat(game);
+	TRACE_END("iterate_bat");
+	TRACE_BEGIN("iterate_balls");
+	iterate_balls(game);
+	TRACE_END("iterate_balls");
+	TRACE_BEGIN("iterate_powerups");
+	iterate_powerups(game);
+	TRACE_END("iterate_powerups");
+	TRACE_BEGIN("iterate_blocks");
+	iterate_blocks(game);
+	TRACE_END("iterate_blocks");
+	TRACE_BEGIN("process_events");
+	process_events(game);
+	TRACE_END("process_events");
+
+	game->fire1_pressed = FALSE;
+	game->fire2_pressed = FALSE;
+
+	if (game->recording)
+		replay_record_hash(game->recording, game);
+	else if (game->playback)
+		replay_check_hash(game->playback, game);
+}
+
+/* Makes a new game, and starts it up. Two games with the same seed, levels
+ * and input play out identically */
+void run_game(Game * game, guint32 seed)
+{
+	if (new_game(game, seed))
+		iterate_game(game);
+}
+
+/* Sets up a new game, without running it. Unless game->playback is set, the
+ * game is recorded. Returns FALSE if there are no levels to play */
+gboolean new_game(Game * game, guint32 seed)
+{
+	return new_game_at_level(game, seed, 0);
+}
+
+/* As new_game, but starts on level_no rather than the first level. Replays
+ * always start at the first level, so games started anywhere else aren't
+ * recorded */
+gboolean new_game_at_level(Game * game, guint32 seed, gint level_no)
 {
 	g_assert(game->state == STATE_STOPPED);
 
-	if (!leveldata_num_levels()) {
+	if (!game->endless && !game->playback && !leveldata_num_levels()) {
 		gui_warning("No levels configured!");
-		return;
+		return FALSE;
 	}
-	game->level = generate_level(0);
-
+	if (!game->endless && !game->playback
+			&& level_no >= leveldata_num_levels()) {
+		gui_warning("There is no level %d", level_no + 1);
+		return FALSE;
+	}
+	memstats_begin_game();
+	game->seed = seed;
+	rng_seed(&game->rng, seed);
 	game->flags->difficulty = game->flags->next_game_difficulty;
 	compute_flags(game->flags);
+
+	if (game->recording)
+		destroy_replay(game->recording);
+	game->recording = game->playback || level_no ? NULL : new_replay(game);
+	game->rewind = game->playback ? NULL : new_rewind();
+	game->rewind_pressed = FALSE;
+	game->ticks = 0;
+	game->fast_forward_to = 0;
+
+	if (game->endless)
+		game->levelgen = new_levelgen(seed);
+	game->level = load_level(game, level_no);
+	gui_new_level(game->level);
+	game->prefetch = new_prefetch();
+	prefetch_level(game, level_no + 1);
+
 	game->state = STATE_RUNNING;
 	game->balls = NULL;
 	new_bat(game);
@@ -91,13 +299,18 @@ void run_game(Game * game)
 	game->powerups = NULL;
 	game->score = 0;
 	game->lives = NUM_LIVES;
-	game->level_no = 0;
+	game->level_no = level_no;
 	game->fire1_pressed = FALSE;
 	game->fire2_pressed = FALSE;
+	game->kill_ball_pressed = FALSE;
 	game->mouse_move = 0;
 	game->keyboard_move = 0;
+	game->last_newlife_score = 0;
+	game->powerup_next_level = FALSE;
+	memset(&game->stats, 0, sizeof(GameStats));
 	gui_begin_game();
-	iterate_game(game);
+
+	return TRUE;
 }
 
 /* Mechanism for tracking where a pause came from and whether we should
@@ -105,6 +318,7 @@ void run_game(Game * game)
 void pause_game(Game * game, PauseType type, gboolean unpause)
 {
 	if (game->state != STATE_STOPPED) {
+		TRACE_INSTANT(unpause ? "unpause" : "pause", "type", type);
 		if (unpause && game->state == STATE_PAUSED) {
 			g_assert(game->pause_state);
 			game->pause_state &= (~type);
@@ -139,18 +353,64 @@ void end_game(Game * game, EndGameStatus status)
 		destroy_bat(game);
 		if (game->level)
 			destroy_level(game);
-		game->score = 0;
-		game->lives = 0;
-		game->level_no = 0;
+		destroy_prefetch(game);
+		if (game->levelgen) {
+			destroy_levelgen(game->levelgen);
+			game->levelgen = NULL;
+		}
+		if (game->rewind) {
+			destroy_rewind(game->rewind);
+			game->rewind = NULL;
+		}
+		destroy_path_cache(game);
+		memstats_end_game("end_game");
+		/* score, lives and level_no are left alone so that the
+		 * result of the game can still be read. new_game resets
+		 * them */
 		game->pause_state = 0;
 	}
 }
 
+/* Takes the game back REWIND_TICKS, or as far back as it can go. The game is
+ * put back as it was from a snapshot, see rewind.c, without stopping it, and
+ * stops being recorded, as the replay so far no longer leads to where the
+ * game is */
+void rewind_game(Game * game)
+{
+	GString *snapshot;
+
+	snapshot = rewind_back(game->rewind, REWIND_TICKS);
+	if (!snapshot)
+		return;
+
+	if (!savegame_restore(game, (guchar *) snapshot->str, snapshot->len)) {
+		gui_warning("Couldn't rewind the game!");
+		destroy_rewind(game->rewind);
+		game->rewind = NULL;
+	}
+	g_string_free(snapshot, TRUE);
+}
+
+/* Sets how many ticks iterate_game runs for each frame it draws */
+void set_time_scale(Game * game, gint time_scale)
+{
+	game->time_scale = CLAMP(time_scale, 1, MAX_TIME_SCALE);
+}
+
+/* Makes iterate_game run the next ticks ticks as fast as it can, without
+ * drawing them */
+void skip_ticks(Game * game, guint ticks)
+{
+	game->fast_forward_to = game->ticks + ticks;
+}
+
 /* Destroy the bat/balls */
 void lose_life(Game * game)
 {
 	reset_bat_type(game);
 	game->lives--;
+	game->stats.lives_lost++;
+	TRACE_INSTANT("lose_life", "lives", game->lives);
 	destroy_powerup_list(game->powerups);
 	game->powerups = NULL;
 }
@@ -158,7 +418,8 @@ void lose_life(Game * game)
 /* Set up the player for his next life */
 
 /* Destroys the current level data and loads the next one, then updates the
- * GUI.
+ * GUI. The next level will usually have been built in the background already,
+ * see prefetch.c
  */
 void next_level(Game * game)
 {
@@ -167,11 +428,67 @@ void next_level(Game * game)
 	game->balls = NULL;
 	destroy_powerup_list(game->powerups);
 	game->powerups = NULL;
-	destroy_level(game);
+	destroy_path_cache(game);
+	retire_level(game);
 	game->level_no++;
-	new_ball_stuck(game);
-	game->level = generate_level(game->level_no);
+	TRACE_INSTANT("next_level", "level_no", game->level_no);
+	game->level = prefetch_take(game, game->level_no);
+	if(game->level) {
+		gui_show_layer(game->level->layer);
+	} else {
+		TRACE_BEGIN("load_level");
+		game->level = load_level(game, game->level_no);
+		TRACE_END("load_level");
+	}
+	gui_new_level(game->level);
+	prefetch_level(game, game->level_no + 1);
 	reset_bat_type(game);
+	place_bat(game);
+	new_ball_stuck(game);
+}
+
+/* Returns TRUE if the game has a level numbered level_num. Endless games have
+ * every level */
+gboolean game_has_level(Game *game, gint level_num)
+{
+	if (game->levelgen)
+		return TRUE;
+	else if (game->playback)
+		return replay_has_level(game->playback, level_num);
+	else
+		return level_num < leveldata_num_levels();
+}
+
+/* Returns a copy of level level_num, from the levelfiles, the level
+ * generator or the replay being played as appropriate. Free it with
+ * free_rawlevel */
+RawLevel *game_get_rawlevel(Game *game, gint level_num)
+{
+	RawLevel *rawlevel;
+
+	if (game->levelgen)
+		return levelgen_get(game->levelgen, level_num);
+	else if (game->playback)
+		return replay_get_level(game->playback, level_num);
+
+	rawlevel = leveldata_get_copy(level_num);
+	if (game->recording)
+		replay_record_level(game->recording, level_num, rawlevel);
+
+	return rawlevel;
+}
+
+/* Generates level level_num and puts it on the canvas */
+static Level *load_level(Game *game, gint level_num)
+{
+	RawLevel *rawlevel;
+	Level *level;
+
+	rawlevel = game_get_rawlevel(game, level_num);
+	level = generate_level(rawlevel);
+	free_rawlevel(rawlevel);
+
+	return level;
 }
 
 /* Key handlers. Called from gui.c */
@@ -226,6 +543,14 @@ void key_fire2_released(Game * game)
 	return;
 }
 
+/* Rewinding happens between ticks, in iterate_game. Played back games can't
+ * be rewound */
+void key_rewind_pressed(Game * game)
+{
+	if (game->state == STATE_RUNNING && game->rewind)
+		game->rewind_pressed = TRUE;
+}
+
 void new_life(Game * game)
 {
 	game->lives++;
@@ -239,7 +564,7 @@ int process_events(Game *game) {
 	// Level End
 	if(check_level_end(game) || game->powerup_next_level) {
 		game->powerup_next_level = FALSE;
-		if(game->level_no < leveldata_num_levels() - 1) {
+		if(game_has_level(game, game->level_no + 1)) {
 			next_level(game);
 		} else {
 			end_game(game, ENDGAME_WIN);
@@ -7,12 +7,23 @@
  * "COPYING" for more details.
  */
 
+#define FRAMES_PER_SECOND 50
+#define MAX_TIME_SCALE 64
+
 void iterate_game(Game *game);
 void lose_life(Game *game);
-void run_game(Game *game);
+void run_game(Game *game, guint32 seed);
+gboolean new_game(Game *game, guint32 seed);
+gboolean new_game_at_level(Game *game, guint32 seed, gint level_no);
+void step_game(Game *game);
 void pause_game(Game *game, PauseType type, gboolean unpause);
 void end_game(Game *game, EndGameStatus status);
+void rewind_game(Game *game);
+void set_time_scale(Game *game, gint time_scale);
+void skip_ticks(Game *game, guint ticks);
 void next_level(Game *game);
+gboolean game_has_level(Game *game, gint level_num);
+RawLevel *game_get_rawlevel(Game *game, gint level_num);
 void key_left_pressed(Game *game);
 void key_left_released(Game *game);
 void key_right_pressed(Game *game);
@@ -21,6 +32,7 @@ void key_fire1_pressed(Game *game);
 void key_fire1_released(Game *game);
 void key_fire2_pressed(Game *game);
 void key_fire2_released(Game *game);
+void key_rewind_pressed(Game *game);
 void mouse_moved(Game *game, int position);
 void new_life(Game *game);
 int process_events(Game *game);
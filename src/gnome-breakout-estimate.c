@@ -0,0 +1,313 @@
+/*
+ * gnome-breakout-estimate: has the bot play each level many times over,
+ * without the GUI, and reports how hard each level turned out to be. The
+ * runs are spread over a pool of threads, each with its own game, and run n
+ * of every level is seeded with seed + n, so results can be reproduced.
+ *
+ * Usage: gnome-breakout-estimate [-r runs] [-j threads] [-g ticks] [-s seed]
+ *                                [-d easy|medium|hard] levelfile...
+ *
+ * Each run starts the bot on the level with a fresh set of lives, and ends
+ * when the level is cleared, the lives run out, or -g ticks have gone by.
+ * For each level, in the order the game plays them, prints
+ *   level=N title=T name=N difficulty=N clear_rate=N median_clear_s=N
+ *     lives_lost=N powerups=N seconds_per_clear=N proposed_difficulty=N
+ * on one line. lives_lost and powerups are averaged over every run, and
+ * median_clear_s is over the runs that cleared the level, or - if none did.
+ *
+ * seconds_per_clear is the time played over all the runs for each time the
+ * level was cleared, so it counts what the runs that failed cost as well as
+ * how long the ones that didn't took. The bot seldom loses a ball, so the
+ * levels it finds hard are mostly the ones where it takes a long time to
+ * find the last few blocks. The levels are ranked on seconds_per_clear, and
+ * proposed_difficulty spreads the ranking over the range of DIFFICULTY
+ * values the levels have now, so it can be pasted into the levelfiles and
+ * the levels will be played easiest first.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "anim.h"
+#include "bot.h"
+#include "flags.h"
+#include "game.h"
+#include "leveldata.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Internal Data Structures */
+typedef struct {
+	gint level_no;
+	guint32 seed;
+
+	/* Filled in by play_run */
+	gboolean cleared;
+	guint ticks;
+	guint lives_lost;
+	guint powerups_caught;
+} Run;
+
+typedef struct {
+	gint level_no;
+	RawLevel *rawlevel;
+	gdouble clear_rate;
+	gdouble median_clear_ticks; /* -1 if it was never cleared */
+	gdouble lives_lost;
+	gdouble powerups_caught;
+	gdouble ticks_per_clear; /* G_MAXDOUBLE if it was never cleared */
+	gint proposed_difficulty;
+} LevelEstimate;
+
+/* Internal Functions */
+static void play_run(gpointer data, gpointer user_data);
+static void estimate_level(LevelEstimate *estimate, Run *runs);
+static void propose_difficulties(LevelEstimate *estimates, gint num_levels);
+static gint compare_ticks(const void *a, const void *b);
+static gint compare_hardness(const void *a, const void *b);
+
+/* Internal Variables */
+static gint num_runs = 1000;
+static gint num_threads = 0;
+static gint max_ticks = 5 * 60 * FRAMES_PER_SECOND;
+static gint seed = 1;
+static gchar *difficulty = "medium";
+
+static GOptionEntry options[] = {
+	{ "runs", 'r', 0, G_OPTION_ARG_INT, &num_runs,
+		"Games to play on each level (default: 1000)", "N" },
+	{ "threads", 'j', 0, G_OPTION_ARG_INT, &num_threads,
+		"Threads to play them on (default: one per processor)", "N" },
+	{ "game-ticks", 'g', 0, G_OPTION_ARG_INT, &max_ticks,
+		"The most ticks a run may take (default: 15000)", "N" },
+	{ "seed", 's', 0, G_OPTION_ARG_INT, &seed,
+		"Seed for the first run on each level (default: 1)", "N" },
+	{ "difficulty", 'd', 0, G_OPTION_ARG_STRING, &difficulty,
+		"easy, medium or hard (default: medium)", "D" },
+	{ NULL }
+};
+
+int main(int argc, char **argv) {
+	GOptionContext *context;
+	GError *error = NULL;
+	GThreadPool *pool;
+	Flags *flags;
+	Run *runs;
+	LevelEstimate *estimates, *estimate;
+	gint i, level_no, num_levels;
+
+	context = g_option_context_new("LEVELFILE... - rate how hard levels are");
+	g_option_context_add_main_entries(context, options, NULL);
+	if(!g_option_context_parse(context, &argc, &argv, &error)) {
+		g_printerr("%s\n", error->message);
+		return 2;
+	}
+	g_option_context_free(context);
+
+	if(argc < 2) {
+		g_printerr("No levelfiles given\n");
+		return 2;
+	}
+	if(num_runs < 1) {
+		g_printerr("There must be at least one run\n");
+		return 2;
+	}
+	if(num_threads < 1)
+		num_threads = g_get_num_processors();
+
+	flags = load_tool_flags(difficulty);
+	if(!flags)
+		return 2;
+
+	for(i = 1; i < argc; i++) {
+		if(!leveldata_add(argv[i]))
+			return 1;
+	}
+	num_levels = leveldata_num_levels();
+
+	init_animations(FALSE);
+
+	/* The levels and animations are only read from here on, so the
+	 * threads can share them. Everything else belongs to one game */
+	runs = g_new0(Run, num_levels * num_runs);
+	pool = g_thread_pool_new(play_run, flags, num_threads, TRUE, &error);
+	if(!pool) {
+		g_printerr("%s\n", error->message);
+		return 1;
+	}
+	for(level_no = 0; level_no < num_levels; level_no++) {
+		for(i = 0; i < num_runs; i++) {
+			runs[level_no * num_runs + i].level_no = level_no;
+			runs[level_no * num_runs + i].seed = seed + i;
+			g_thread_pool_push(pool, &runs[level_no * num_runs + i],
+					NULL);
+		}
+	}
+	g_thread_pool_free(pool, FALSE, TRUE);
+
+	estimates = g_new0(LevelEstimate, num_levels);
+	for(level_no = 0; level_no < num_levels; level_no++) {
+		estimates[level_no].level_no = level_no;
+		estimates[level_no].rawlevel = leveldata_get(level_no);
+		estimate_level(&estimates[level_no],
+				&runs[level_no * num_runs]);
+	}
+	propose_difficulties(estimates, num_levels);
+
+	for(level_no = 0; level_no < num_levels; level_no++) {
+		estimate = &estimates[level_no];
+		g_print("level=%d title=\"%s\" name=\"%s\" difficulty=%d"
+				" clear_rate=%.3f", level_no + 1,
+				estimate->rawlevel->levelfile_title,
+				estimate->rawlevel->name,
+				estimate->rawlevel->difficulty,
+				estimate->clear_rate);
+		if(estimate->median_clear_ticks < 0)
+			g_print(" median_clear_s=-");
+		else
+			g_print(" median_clear_s=%.1f",
+					estimate->median_clear_ticks
+					/ FRAMES_PER_SECOND);
+		g_print(" lives_lost=%.2f powerups=%.2f", estimate->lives_lost,
+				estimate->powerups_caught);
+		if(estimate->clear_rate > 0)
+			g_print(" seconds_per_clear=%.1f",
+					estimate->ticks_per_clear
+					/ FRAMES_PER_SECOND);
+		else
+			g_print(" seconds_per_clear=-");
+		g_print(" proposed_difficulty=%d\n",
+				estimate->proposed_difficulty);
+	}
+
+	g_free(estimates);
+	g_free(runs);
+	destroy_flags(flags);
+
+	return 0;
+}
+
+/* Plays one Run, on whichever thread the pool gives it. user_data is the
+ * Flags to play with, which each game takes its own copy of */
+static void play_run(gpointer data, gpointer user_data) {
+	Run *run = (Run *) data;
+	Game game;
+	gint breakable;
+
+	memset(&game, 0, sizeof(Game));
+	game.flags = copy_flags((Flags *) user_data);
+	game.state = STATE_STOPPED;
+	if(!new_game_at_level(&game, run->seed, run->level_no)) {
+		destroy_flags(game.flags);
+		return;
+	}
+	game.bot = new_bot(run->seed, TRUE);
+	breakable = game.level->blocks_left;
+
+	while(game.state == STATE_RUNNING && game.level_no == run->level_no
+			&& game.ticks < max_ticks) {
+		bot_tick(game.bot, &game);
+		step_game(&game);
+	}
+
+	/* Only breaking every block counts. Leaving the level any other way,
+	 * such as by catching a next level powerup, or clearing the last
+	 * level, which ends the game, can't be told apart from this by
+	 * level_no alone */
+	run->cleared = game.stats.blocks_cleared >= breakable;
+	run->ticks = game.ticks;
+	run->lives_lost = game.stats.lives_lost;
+	run->powerups_caught = game.stats.powerups_caught;
+
+	if(game.state != STATE_STOPPED)
+		end_game(&game, ENDGAME_MENU);
+	destroy_bot(game.bot);
+	destroy_flags(game.flags);
+}
+
+/* Sums up one level's num_runs runs */
+static void estimate_level(LevelEstimate *estimate, Run *runs) {
+	guint *clear_ticks;
+	gint i, num_cleared = 0;
+	guint lives_lost = 0, powerups_caught = 0;
+	gdouble ticks = 0;
+
+	clear_ticks = g_new(guint, num_runs);
+	for(i = 0; i < num_runs; i++) {
+		if(runs[i].cleared)
+			clear_ticks[num_cleared++] = runs[i].ticks;
+		ticks += runs[i].ticks;
+		lives_lost += runs[i].lives_lost;
+		powerups_caught += runs[i].powerups_caught;
+	}
+
+	estimate->clear_rate = (gdouble) num_cleared / num_runs;
+	estimate->lives_lost = (gdouble) lives_lost / num_runs;
+	estimate->powerups_caught = (gdouble) powerups_caught / num_runs;
+	estimate->ticks_per_clear = num_cleared
+		? ticks / num_cleared : G_MAXDOUBLE;
+
+	if(num_cleared) {
+		qsort(clear_ticks, num_cleared, sizeof(guint), compare_ticks);
+		if(num_cleared % 2)
+			estimate->median_clear_ticks =
+				clear_ticks[num_cleared / 2];
+		else
+			estimate->median_clear_ticks =
+				(clear_ticks[num_cleared / 2 - 1]
+				 + clear_ticks[num_cleared / 2]) / 2.0;
+	} else {
+		estimate->median_clear_ticks = -1;
+	}
+
+	g_free(clear_ticks);
+}
+
+/* Ranks the levels from easiest to hardest, and spreads the ranks evenly
+ * over the lowest to the highest DIFFICULTY they have now. If they all have
+ * the same DIFFICULTY, the ranks count up from it instead */
+static void propose_difficulties(LevelEstimate *estimates, gint num_levels) {
+	LevelEstimate **ranked;
+	gint i, lowest = G_MAXINT, highest = G_MININT;
+
+	ranked = g_new(LevelEstimate *, num_levels);
+	for(i = 0; i < num_levels; i++) {
+		ranked[i] = &estimates[i];
+		lowest = MIN(lowest, estimates[i].rawlevel->difficulty);
+		highest = MAX(highest, estimates[i].rawlevel->difficulty);
+	}
+	if(lowest == highest)
+		highest = lowest + num_levels - 1;
+
+	qsort(ranked, num_levels, sizeof(LevelEstimate *), compare_hardness);
+	for(i = 0; i < num_levels; i++) {
+		ranked[i]->proposed_difficulty = num_levels > 1
+			? lowest + (i * (highest - lowest) + (num_levels - 1) / 2)
+				/ (num_levels - 1)
+			: lowest;
+	}
+
+	g_free(ranked);
+}
+
+static gint compare_ticks(const void *a, const void *b) {
+	guint ta = *(const guint *) a, tb = *(const guint *) b;
+
+	return ta < tb ? -1 : ta > tb;
+}
+
+/* Orders LevelEstimate pointers easiest first. Levels that were never
+ * cleared come last, and a tie goes to whichever cost fewer lives */
+static gint compare_hardness(const void *a, const void *b) {
+	LevelEstimate *ea = *(LevelEstimate **) a, *eb = *(LevelEstimate **) b;
+
+	if(ea->ticks_per_clear != eb->ticks_per_clear)
+		return ea->ticks_per_clear < eb->ticks_per_clear ? -1 : 1;
+	if(ea->lives_lost != eb->lives_lost)
+		return ea->lives_lost < eb->lives_lost ? -1 : 1;
+
+	return ea->level_no - eb->level_no;
+}
@@ -0,0 +1,208 @@
+/*
+ * gnome-breakout-lint: checks levelfiles, many at a time, and reports what it
+ * finds as JSON on stdout. Uses the same parser as the game, so a file that
+ * passes here will load there.
+ *
+ * Usage: gnome-breakout-lint [-j jobs] levelfile...
+ *
+ * The exit status is 1 if any levelfile failed to parse, 0 otherwise.
+ * Duplicate level names are reported, but aren't considered a failure.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "leveldata.h"
+#include "levelparse.h"
+#include "json.h"
+#include <string.h>
+
+/* Internal Data Structures */
+typedef struct {
+	gchar *filename;
+	gboolean ok;
+	gchar *title;
+	GList *levels; /* Contains RawLevel structures, in file order */
+	GList *warnings;
+} LintFile;
+
+/* Internal Functions */
+static void lint_file(gpointer data, gpointer user_data);
+static void write_file(GString *out, LintFile *file);
+static void write_level(GString *out, RawLevel *level);
+static gint write_duplicates(GString *out, LintFile *files, gint num_files);
+
+/* Internal Variables */
+static gint jobs = 0;
+
+static GOptionEntry options[] = {
+	{ "jobs", 'j', 0, G_OPTION_ARG_INT, &jobs,
+		"Number of files to check at once (default: one per CPU)", "N" },
+	{ NULL }
+};
+
+/* The names the JSON uses for each block code, indexed by code */
+static const gchar *block_names[MAX_BLOCK_CODE + 1] = {
+	"none", "default", "invincible", "strong1", "strong2", "strong3",
+	"explode"
+};
+
+int main(int argc, char **argv) {
+	GOptionContext *context;
+	GError *error = NULL;
+	GThreadPool *pool;
+	LintFile *files;
+	GString *out;
+	gint num_files, num_failed = 0, num_levels = 0, num_duplicates, i;
+
+	context = g_option_context_new("LEVELFILE... - check gnome-breakout levelfiles");
+	g_option_context_add_main_entries(context, options, NULL);
+	if(!g_option_context_parse(context, &argc, &argv, &error)) {
+		g_printerr("%s\n", error->message);
+		return 2;
+	}
+	g_option_context_free(context);
+
+	num_files = argc - 1;
+	if(num_files < 1) {
+		g_printerr("No levelfiles given\n");
+		return 2;
+	}
+	if(jobs < 1)
+		jobs = g_get_num_processors();
+
+	files = g_malloc0(sizeof(LintFile) * num_files);
+	pool = g_thread_pool_new(lint_file, NULL, jobs, TRUE, NULL);
+	for(i = 0; i < num_files; i++) {
+		files[i].filename = argv[i + 1];
+		g_thread_pool_push(pool, &files[i], NULL);
+	}
+	/* Waits for every file to be done */
+	g_thread_pool_free(pool, FALSE, TRUE);
+
+	out = g_string_new("{\"files\":[");
+	for(i = 0; i < num_files; i++) {
+		if(i)
+			g_string_append_c(out, ',');
+		write_file(out, &files[i]);
+		if(!files[i].ok)
+			num_failed++;
+		num_levels += g_list_length(files[i].levels);
+	}
+	g_string_append(out, "],\"duplicates\":[");
+	num_duplicates = write_duplicates(out, files, num_files);
+	g_string_append_printf(out, "],\"summary\":{\"files\":%d,\"failed\":%d,"
+			"\"levels\":%d,\"duplicates\":%d}}\n",
+			num_files, num_failed, num_levels, num_duplicates);
+	fputs(out->str, stdout);
+
+	return num_failed ? 1 : 0;
+}
+
+/* Thread pool worker. Parses one file */
+static void lint_file(gpointer data, gpointer user_data) {
+	LintFile *file = (LintFile *) data;
+
+	file->ok = levelparse_load(file->filename, &file->title,
+			&file->levels, &file->warnings);
+	file->levels = g_list_reverse(file->levels);
+}
+
+static void write_file(GString *out, LintFile *file) {
+	GList *curr;
+
+	g_string_append(out, "{\"file\":");
+	json_append_string(out, file->filename);
+	g_string_append(out, ",\"title\":");
+	json_append_string(out, file->title);
+	g_string_append_printf(out, ",\"ok\":%s,\"errors\":[",
+			file->ok ? "true" : "false");
+	for(curr = file->warnings; curr; curr = g_list_next(curr)) {
+		if(curr != file->warnings)
+			g_string_append_c(out, ',');
+		json_append_string(out, (gchar *) curr->data);
+	}
+	g_string_append(out, "],\"levels\":[");
+	for(curr = file->levels; curr; curr = g_list_next(curr)) {
+		if(curr != file->levels)
+			g_string_append_c(out, ',');
+		write_level(out, (RawLevel *) curr->data);
+	}
+	g_string_append(out, "]}");
+}
+
+/* Writes a level's details, and how many blocks of each type it has */
+static void write_level(GString *out, RawLevel *level) {
+	gint counts[MAX_BLOCK_CODE + 1];
+	gint i;
+
+	memset(counts, 0, sizeof(counts));
+	for(i = 0; i < level->width * level->height; i++)
+		counts[(gint) level->blocks[i]]++;
+
+	g_string_append(out, "{\"name\":");
+	json_append_string(out, level->name);
+	g_string_append(out, ",\"author\":");
+	json_append_string(out, level->author);
+	g_string_append_printf(out, ",\"difficulty\":%d,\"width\":%d,"
+			"\"height\":%d,\"blocks\":{",
+			level->difficulty, level->width, level->height);
+	for(i = 0; i <= MAX_BLOCK_CODE; i++) {
+		g_string_append_printf(out, "%s\"%s\":%d", i ? "," : "",
+				block_names[i], counts[i]);
+	}
+	g_string_append(out, "}}");
+}
+
+/* Writes an entry for each level name that is used more than once, across all
+ * of the files. Returns the number of such names */
+static gint write_duplicates(GString *out, LintFile *files, gint num_files) {
+	GHashTable *names;
+	GList *curr, *uses, *names_list, *currn;
+	RawLevel *level;
+	gchar *use;
+	gint i, index, ret = 0;
+
+	/* name -> list of "file:index" strings, in file order */
+	names = g_hash_table_new(g_str_hash, g_str_equal);
+	names_list = NULL;
+	for(i = 0; i < num_files; i++) {
+		for(curr = files[i].levels, index = 0; curr;
+				curr = g_list_next(curr), index++) {
+			level = (RawLevel *) curr->data;
+			uses = (GList *) g_hash_table_lookup(names, level->name);
+			if(!uses)
+				names_list = g_list_prepend(names_list, level->name);
+			use = g_strdup_printf("%s:%d", files[i].filename, index);
+			uses = g_list_append(uses, use);
+			g_hash_table_insert(names, level->name, uses);
+		}
+	}
+	names_list = g_list_reverse(names_list);
+
+	for(currn = names_list; currn; currn = g_list_next(currn)) {
+		uses = (GList *) g_hash_table_lookup(names, currn->data);
+		if(g_list_length(uses) > 1) {
+			g_string_append(out, ret ? ",{\"name\":" : "{\"name\":");
+			json_append_string(out, (gchar *) currn->data);
+			g_string_append(out, ",\"levels\":[");
+			for(curr = uses; curr; curr = g_list_next(curr)) {
+				if(curr != uses)
+					g_string_append_c(out, ',');
+				json_append_string(out, (gchar *) curr->data);
+			}
+			g_string_append(out, "]}");
+			ret++;
+		}
+		for(curr = uses; curr; curr = g_list_next(curr))
+			g_free(curr->data);
+		g_list_free(uses);
+	}
+	g_list_free(names_list);
+	g_hash_table_destroy(names);
+
+	return ret;
+}
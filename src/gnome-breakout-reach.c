@@ -0,0 +1,506 @@
+/*
+ * gnome-breakout-reach: finds the blocks in levelfiles that the ball can
+ * never get to, such as ones walled in by invincible blocks, which leave a
+ * level that can't be finished. Reports what it finds as JSON on stdout. Each
+ * levelfile is checked on a thread of its own.
+ *
+ * Usage: gnome-breakout-reach [-j jobs] [-s shots] [-t ticks]
+ *                             [-d easy|medium|hard] levelfile...
+ *
+ * Each level is checked two ways. The first is a flood fill over the grid
+ * from its edges, which the ball can always get round, through every square
+ * that isn't an invincible block. Breakable blocks open up once they're
+ * broken, and an exploding block opens up the blocks around it that one hit
+ * will break. A block the fill doesn't get to is boxed in.
+ *
+ * The second fires balls up from the bat, -s of them spread over the angles
+ * the bat can send a ball off at, from every few pixels along the bottom of
+ * the level, and follows each for up to -t ticks or until it comes back
+ * down, with the game's own collision code. Blocks are broken as they're hit,
+ * and the balls are fired again until a round of them breaks nothing new.
+ * This can only show that a block can be got to, and any block it doesn't
+ * break that the fill does get to is reported as unconfirmed. A block it
+ * does break is never reported, even if the fill said it was boxed in.
+ *
+ * For each levelfile, gives
+ *   {"file":F,"title":T,"ok":B,"errors":[...],"levels":[
+ *    {"name":N,"blocks":N,"boxed_in":[[X,Y],...],"unconfirmed":[[X,Y],...],
+ *     "rounds":N,"shots":N},...]}
+ * where X and Y are the column and row of a block, counting from 0, and
+ * blocks is the number of breakable ones. The exit status is 1 if any
+ * levelfile failed to parse, or has a level with boxed in blocks, 2 if the
+ * checks couldn't be run at all, and 0 otherwise.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "anim.h"
+#include "ball.h"
+#include "block.h"
+#include "collision.h"
+#include "flags.h"
+#include "leveldata.h"
+#include "levelparse.h"
+#include "json.h"
+#include <math.h>
+#include <string.h>
+
+#define PI 3.14159265
+
+/* The furthest from straight up the bat sends the ball off at */
+#define MAX_LAUNCH_ANGLE (PI / 3.0)
+
+/* How far apart along the bottom of the level the balls are fired from */
+#define LAUNCH_STEP (BALL_WIDTH * 2)
+
+/* Internal Data Structures */
+typedef struct {
+	RawLevel *rawlevel;
+	gint blocks;
+	GArray *boxed_in; /* Contains block numbers */
+	GArray *unconfirmed; /* Contains block numbers */
+	gint rounds;
+	gint shots;
+} LevelReach;
+
+typedef struct {
+	gchar *filename;
+	gboolean ok;
+	gchar *title;
+	GList *levels; /* Contains RawLevel structures, in file order */
+	GList *warnings;
+	LevelReach *reaches; /* One for each of levels */
+} ReachFile;
+
+/* Internal Functions */
+static void reach_file(gpointer data, gpointer user_data);
+static void reach_level(LevelReach *reach, Flags *flags);
+static void flood_level(RawLevel *rawlevel, gboolean *flooded);
+static void flood_block(RawLevel *rawlevel, gboolean *flooded, GArray *queue,
+		gint x, gint y);
+static gint search_level(RawLevel *rawlevel, Flags *flags, gint *hits_left,
+		gint *shots);
+static gboolean fire_ball(Game *game, gint *hits_left, gint x,
+		gdouble direction);
+static gboolean strike_block(Level *level, gint *hits_left, gint block_no);
+static gint block_hits(gchar code);
+static void write_file(GString *out, ReachFile *file);
+static void write_blocks(GString *out, GArray *blocks, gint width);
+
+/* Internal Variables */
+static gint jobs = 0;
+static gint num_shots = 15;
+static gint max_ticks = MAX_AIRTIME;
+static gchar *difficulty = "medium";
+
+static GOptionEntry options[] = {
+	{ "jobs", 'j', 0, G_OPTION_ARG_INT, &jobs,
+		"Number of files to check at once (default: one per CPU)", "N" },
+	{ "shots", 's', 0, G_OPTION_ARG_INT, &num_shots,
+		"Angles to fire balls at from each place (default: 15)", "N" },
+	{ "ticks", 't', 0, G_OPTION_ARG_INT, &max_ticks,
+		"The most ticks to follow each ball for (default: 1000)", "N" },
+	{ "difficulty", 'd', 0, G_OPTION_ARG_STRING, &difficulty,
+		"easy, medium or hard, for the speed of the balls "
+		"(default: medium)", "D" },
+	{ NULL }
+};
+
+int main(int argc, char **argv) {
+	GOptionContext *context;
+	GError *error = NULL;
+	GThreadPool *pool;
+	Flags *flags;
+	ReachFile *files;
+	GString *out;
+	LevelReach *reach;
+	gint num_files, num_failed = 0, num_levels = 0, num_unwinnable = 0;
+	gint num_unconfirmed = 0, i, j, file_levels;
+
+	context = g_option_context_new("LEVELFILE... - find blocks the ball can't get to");
+	g_option_context_add_main_entries(context, options, NULL);
+	if(!g_option_context_parse(context, &argc, &argv, &error)) {
+		g_printerr("%s\n", error->message);
+		return 2;
+	}
+	g_option_context_free(context);
+
+	num_files = argc - 1;
+	if(num_files < 1) {
+		g_printerr("No levelfiles given\n");
+		return 2;
+	}
+	if(num_shots < 1) {
+		g_printerr("There must be at least one shot\n");
+		return 2;
+	}
+	if(jobs < 1)
+		jobs = g_get_num_processors();
+
+	flags = load_tool_flags(difficulty);
+	if(!flags)
+		return 2;
+
+	init_animations(FALSE);
+
+	/* The flags and animations are only read from here on, so the
+	 * threads can share them */
+	files = g_malloc0(sizeof(ReachFile) * num_files);
+	pool = g_thread_pool_new(reach_file, flags, jobs, TRUE, &error);
+	if(!pool) {
+		g_printerr("%s\n", error->message);
+		return 2;
+	}
+	for(i = 0; i < num_files; i++) {
+		files[i].filename = argv[i + 1];
+		g_thread_pool_push(pool, &files[i], NULL);
+	}
+	/* Waits for every file to be done */
+	g_thread_pool_free(pool, FALSE, TRUE);
+
+	out = g_string_new("{\"files\":[");
+	for(i = 0; i < num_files; i++) {
+		if(i)
+			g_string_append_c(out, ',');
+		write_file(out, &files[i]);
+		if(!files[i].ok)
+			num_failed++;
+		file_levels = g_list_length(files[i].levels);
+		for(j = 0; j < file_levels; j++) {
+			reach = &files[i].reaches[j];
+			num_levels++;
+			if(reach->boxed_in->len)
+				num_unwinnable++;
+			if(reach->unconfirmed->len)
+				num_unconfirmed++;
+		}
+	}
+	g_string_append_printf(out, "],\"summary\":{\"files\":%d,\"failed\":%d,"
+			"\"levels\":%d,\"unwinnable\":%d,\"unconfirmed\":%d}}\n",
+			num_files, num_failed, num_levels, num_unwinnable,
+			num_unconfirmed);
+	fputs(out->str, stdout);
+
+	return num_failed || num_unwinnable ? 1 : 0;
+}
+
+/* Thread pool worker. Parses one file and checks each of its levels */
+static void reach_file(gpointer data, gpointer user_data) {
+	ReachFile *file = (ReachFile *) data;
+	GList *curr;
+	gint i;
+
+	file->ok = levelparse_load(file->filename, &file->title,
+			&file->levels, &file->warnings);
+	file->levels = g_list_reverse(file->levels);
+
+	file->reaches = g_new0(LevelReach, g_list_length(file->levels));
+	for(curr = file->levels, i = 0; curr; curr = g_list_next(curr), i++) {
+		file->reaches[i].rawlevel = (RawLevel *) curr->data;
+		reach_level(&file->reaches[i], (Flags *) user_data);
+	}
+}
+
+/* Works out which of a level's blocks are boxed in and which are
+ * unconfirmed */
+static void reach_level(LevelReach *reach, Flags *flags) {
+	RawLevel *rawlevel = reach->rawlevel;
+	gboolean *flooded;
+	gint *hits_left;
+	gint i, total;
+
+	total = rawlevel->width * rawlevel->height;
+	flooded = g_new0(gboolean, total);
+	hits_left = g_new(gint, total);
+	for(i = 0; i < total; i++)
+		hits_left[i] = block_hits(rawlevel->blocks[i]);
+
+	flood_level(rawlevel, flooded);
+	reach->rounds = search_level(rawlevel, flags, hits_left,
+			&reach->shots);
+
+	reach->boxed_in = g_array_new(FALSE, FALSE, sizeof(gint));
+	reach->unconfirmed = g_array_new(FALSE, FALSE, sizeof(gint));
+	for(i = 0; i < total; i++) {
+		if(block_hits(rawlevel->blocks[i]))
+			reach->blocks++;
+		if(!hits_left[i])
+			continue;
+		if(flooded[i])
+			g_array_append_val(reach->unconfirmed, i);
+		else
+			g_array_append_val(reach->boxed_in, i);
+	}
+
+	g_free(flooded);
+	g_free(hits_left);
+}
+
+/* Marks every square of the level the ball can get to, and so every block it
+ * can break, in flooded */
+static void flood_level(RawLevel *rawlevel, gboolean *flooded) {
+	GArray *queue;
+	gint width, height, block_no, x, y, dx, dy;
+	guint next;
+
+	width = rawlevel->width;
+	height = rawlevel->height;
+
+	/* Contains block numbers of squares that have been flooded, but
+	 * whose neighbours haven't been looked at yet */
+	queue = g_array_new(FALSE, FALSE, sizeof(gint));
+
+	/* There's room for the ball all the way round the outside of the
+	 * grid */
+	for(x = 0; x < width; x++) {
+		flood_block(rawlevel, flooded, queue, x, 0);
+		flood_block(rawlevel, flooded, queue, x, height - 1);
+	}
+	for(y = 0; y < height; y++) {
+		flood_block(rawlevel, flooded, queue, 0, y);
+		flood_block(rawlevel, flooded, queue, width - 1, y);
+	}
+
+	for(next = 0; next < queue->len; next++) {
+		block_no = g_array_index(queue, gint, next);
+		x = block_no % width;
+		y = block_no / width;
+
+		flood_block(rawlevel, flooded, queue, x - 1, y);
+		flood_block(rawlevel, flooded, queue, x + 1, y);
+		flood_block(rawlevel, flooded, queue, x, y - 1);
+		flood_block(rawlevel, flooded, queue, x, y + 1);
+
+		/* An exploding block hits each block around it once, which
+		 * only breaks the ones that take one hit */
+		if(rawlevel->blocks[block_no] != BLOCK_EXPLODE_CODE)
+			continue;
+		for(dy = -1; dy <= 1; dy++) {
+			for(dx = -1; dx <= 1; dx++) {
+				if(x + dx < 0 || x + dx >= width
+						|| y + dy < 0 || y + dy >= height)
+					continue;
+				if(block_hits(rawlevel->blocks[x + dx
+						+ (y + dy) * width]) == 1)
+					flood_block(rawlevel, flooded, queue,
+							x + dx, y + dy);
+			}
+		}
+	}
+
+	g_array_free(queue, TRUE);
+}
+
+/* Floods the square at x, y, if it's in the level and the ball can get
+ * through it */
+static void flood_block(RawLevel *rawlevel, gboolean *flooded, GArray *queue,
+		gint x, gint y) {
+	gint block_no;
+
+	if(x < 0 || x >= rawlevel->width || y < 0 || y >= rawlevel->height)
+		return;
+
+	block_no = x + y * rawlevel->width;
+	if(flooded[block_no]
+			|| rawlevel->blocks[block_no] == BLOCK_INVINCIBLE_CODE)
+		return;
+
+	flooded[block_no] = TRUE;
+	g_array_append_val(queue, block_no);
+}
+
+/* Fires balls into the level until a round of them breaks nothing new,
+ * counting off the hits in hits_left. Returns the number of rounds, and
+ * adds the number of balls fired to shots */
+static gint search_level(RawLevel *rawlevel, Flags *flags, gint *hits_left,
+		gint *shots) {
+	Game game;
+	gint rounds = 0, x, i;
+	gboolean progress;
+
+	memset(&game, 0, sizeof(Game));
+	game.flags = flags;
+	game.level = new_level(rawlevel);
+
+	do {
+		progress = FALSE;
+		for(x = 0; x + BALL_WIDTH <= GAME_WIDTH(game.level);
+				x += LAUNCH_STEP) {
+			for(i = 0; i < num_shots; i++) {
+				if(fire_ball(&game, hits_left, x, PI
+						+ MAX_LAUNCH_ANGLE * (2.0 * i
+						/ MAX(num_shots - 1, 1) - 1.0)))
+					progress = TRUE;
+				(*shots)++;
+			}
+		}
+		rounds++;
+	} while(progress && game.level->blocks_left);
+
+	reap_level(game.level, game.level->width * game.level->height);
+
+	return rounds;
+}
+
+/* Fires a ball up from the top of the bat at x, and follows it as
+ * iterate_ball_default would until it gets back down there. Returns TRUE if
+ * it hit a block that wasn't already broken */
+static gboolean fire_ball(Game *game, gint *hits_left, gint x,
+		gdouble direction) {
+	gint block_nos[MAX_TOUCHED_BLOCKS];
+	Ball ball;
+	Block *block;
+	Contact contact;
+	Side side;
+	gint line_y, num_blocks, i, j;
+	gboolean hit, progress = FALSE;
+
+	line_y = GAME_HEIGHT(game->level) - BLOCK_WALL_PADDING - BAT_HEIGHT;
+
+	memset(&ball, 0, sizeof(Ball));
+	ball.type = BALL_DEFAULT;
+	ball.geometry.x1 = x;
+	ball.geometry.y1 = line_y - BALL_HEIGHT - 1;
+	ball.geometry.x2 = ball.geometry.x1 + BALL_WIDTH;
+	ball.geometry.y2 = ball.geometry.y1 + BALL_HEIGHT;
+	ball.pseudo_x1 = ball.geometry.x1;
+	ball.pseudo_y1 = ball.geometry.y1;
+	ball.speed = game->flags->ball_initial_speed;
+	ball.direction = direction;
+
+	for(i = 0; i < max_ticks; i++) {
+		move_ball(&ball);
+
+		num_blocks = find_touched_blocks(game, &ball, block_nos);
+		hit = FALSE;
+		for(j = 0; j < num_blocks; j++) {
+			block = game->level->blocks[block_nos[j]];
+			if(block->type != BLOCK_DEAD
+					&& ball_block_contact(game, block,
+						&ball, &contact)) {
+				if(strike_block(game->level, hits_left,
+							block->block_no))
+					progress = TRUE;
+				increase_ball_speed(game, &ball);
+				resolve_contact(&ball, &contact);
+				hit = TRUE;
+			}
+		}
+
+		if(hit)
+			continue;
+		if(ball.geometry.y2 >= line_y)
+			break;
+
+		side = ball_wall_side(game->level, &ball);
+		if(side != SIDE_NONE) {
+			bounce_ball(&ball, side);
+			keep_ball_in(game->level, &ball);
+		}
+	}
+
+	return progress;
+}
+
+/* Hits the block at block_no once, as hit_block would. A block that runs out
+ * of hits is made BLOCK_DEAD, so that find_touched_blocks doesn't see it any
+ * more. Returns FALSE if the block couldn't be hit */
+static gboolean strike_block(Level *level, gint *hits_left, gint block_no) {
+	Block *block;
+	gint x, y, dx, dy;
+
+	if(!hits_left[block_no])
+		return FALSE;
+	if(--hits_left[block_no])
+		return TRUE;
+
+	block = level->blocks[block_no];
+	if(block->type == BLOCK_EXPLODE) {
+		x = block_no % level->width;
+		y = block_no / level->width;
+		for(dy = -1; dy <= 1; dy++) {
+			for(dx = -1; dx <= 1; dx++) {
+				if(x + dx >= 0 && x + dx < level->width
+						&& y + dy >= 0
+						&& y + dy < level->height)
+					strike_block(level, hits_left, x + dx
+							+ (y + dy)
+							* level->width);
+			}
+		}
+	}
+	block->type = BLOCK_DEAD;
+	level->blocks_left--;
+
+	return TRUE;
+}
+
+/* How many hits a block made from code takes to break, or 0 for one that
+ * can't be broken */
+static gint block_hits(gchar code) {
+	switch(code) {
+		case BLOCK_DEFAULT_CODE :
+		case BLOCK_EXPLODE_CODE :
+			return 1;
+		case BLOCK_STRONG_1_CODE :
+			return 2;
+		case BLOCK_STRONG_2_CODE :
+			return 3;
+		case BLOCK_STRONG_3_CODE :
+			return 4;
+		default :
+			return 0;
+	}
+}
+
+static void write_file(GString *out, ReachFile *file) {
+	GList *curr;
+	LevelReach *reach;
+	gint i;
+
+	g_string_append(out, "{\"file\":");
+	json_append_string(out, file->filename);
+	g_string_append(out, ",\"title\":");
+	json_append_string(out, file->title);
+	g_string_append_printf(out, ",\"ok\":%s,\"errors\":[",
+			file->ok ? "true" : "false");
+	for(curr = file->warnings; curr; curr = g_list_next(curr)) {
+		if(curr != file->warnings)
+			g_string_append_c(out, ',');
+		json_append_string(out, (gchar *) curr->data);
+	}
+	g_string_append(out, "],\"levels\":[");
+	for(curr = file->levels, i = 0; curr; curr = g_list_next(curr), i++) {
+		reach = &file->reaches[i];
+		if(i)
+			g_string_append_c(out, ',');
+		g_string_append(out, "{\"name\":");
+		json_append_string(out, reach->rawlevel->name);
+		g_string_append_printf(out, ",\"blocks\":%d,\"boxed_in\":",
+				reach->blocks);
+		write_blocks(out, reach->boxed_in, reach->rawlevel->width);
+		g_string_append(out, ",\"unconfirmed\":");
+		write_blocks(out, reach->unconfirmed, reach->rawlevel->width);
+		g_string_append_printf(out, ",\"rounds\":%d,\"shots\":%d}",
+				reach->rounds, reach->shots);
+	}
+	g_string_append(out, "]}");
+}
+
+/* Writes a list of block numbers as [column,row] pairs */
+static void write_blocks(GString *out, GArray *blocks, gint width) {
+	gint block_no;
+	guint i;
+
+	g_string_append_c(out, '[');
+	for(i = 0; i < blocks->len; i++) {
+		block_no = g_array_index(blocks, gint, i);
+		g_string_append_printf(out, "%s[%d,%d]", i ? "," : "",
+				block_no % width, block_no / width);
+	}
+	g_string_append_c(out, ']');
+}
@@ -0,0 +1,304 @@
+/*
+ * gnome-breakout-replay: plays back recorded games without the GUI, as fast
+ * as they'll go, and reports how each one ended. Replays carry their own
+ * levels, so no levelfiles are needed.
+ *
+ * Usage: gnome-breakout-replay [-r] replayfile...
+ *
+ * For each replay, prints one line of the form
+ *   filename: ticks=N level=N score=N lives=N result=win|lose|unfinished
+ *
+ * If the game played back doesn't match the recording, which happens when
+ * the game's behaviour has changed since it was recorded, the first tick
+ * where it went wrong is reported as
+ *   filename: desync at tick N in balls,blocks,...
+ * followed by what that tick did to those parts of the state, as - and +
+ * lines. The state before the tick is the last one that matched the
+ * recording.
+ *
+ * With -r, each replay that plays back correctly is played again with
+ * rewind snapshots being taken, as the game does, and what they cost is
+ * reported as
+ *   filename: rewind ticks=N us_per_tick=N worst_us=N snapshots=N bytes=N
+ *     budget=N seconds=N full_bytes=N rewind_us=N
+ * on one line. us_per_tick is the time spent on snapshots averaged over
+ * every tick, and worst_us the longest any one tick spent. bytes is what
+ * the snapshots held at the end take up, and seconds how far back they go.
+ * full_bytes is the size of one snapshot stored whole, for comparison, and
+ * rewind_us is how long it took to go back REWIND_TICKS at the end.
+ *
+ * The exit status is 1 if any replay couldn't be loaded or went out of sync,
+ * 0 otherwise.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "anim.h"
+#include "flags.h"
+#include "game.h"
+#include "replay.h"
+#include "rewind.h"
+#include "savegame.h"
+#include "statehash.h"
+#include <string.h>
+
+/* Internal Functions */
+static gboolean play_replay(gchar *filename, Flags *flags);
+static guint play_ticks(struct _Replay *replay, Game *game, guint max_ticks);
+static void report_desync(gchar *filename, struct _Replay *replay,
+		Flags *flags, gint tick, guint parts);
+static void print_diff(gchar *before, gchar *after);
+static void bench_rewind(gchar *filename, struct _Replay *replay,
+		Flags *flags);
+
+/* Internal Variables */
+static gboolean rewind_bench = FALSE;
+
+static GOptionEntry options[] = {
+	{ "rewind", 'r', 0, G_OPTION_ARG_NONE, &rewind_bench,
+		"Measure what rewind snapshots cost", NULL },
+	{ NULL }
+};
+
+int main(int argc, char **argv) {
+	GOptionContext *context;
+	GError *error = NULL;
+	Flags *flags;
+	gint i, num_failed = 0;
+
+	context = g_option_context_new("REPLAYFILE... - play back gnome-breakout replays");
+	g_option_context_add_main_entries(context, options, NULL);
+	if(!g_option_context_parse(context, &argc, &argv, &error)) {
+		g_printerr("%s\n", error->message);
+		return 2;
+	}
+	g_option_context_free(context);
+
+	if(argc < 2) {
+		g_printerr("No replayfiles given\n");
+		return 2;
+	}
+
+	/* Only the parts of the flags that replay_start and compute_flags
+	 * don't fill in need to be sane */
+	flags = g_malloc0(sizeof(Flags));
+	flags->bat_speed = MIN_BATSPEED;
+
+	init_animations(FALSE);
+
+	for(i = 1; i < argc; i++) {
+		if(!play_replay(argv[i], flags))
+			num_failed++;
+	}
+
+	g_free(flags);
+
+	return num_failed ? 1 : 0;
+}
+
+/* Plays one replay through to the end, and prints the result. Returns FALSE
+ * if it couldn't be played, or didn't match the recording */
+static gboolean play_replay(gchar *filename, Flags *flags) {
+	struct _Replay *replay;
+	Game game;
+	const gchar *result;
+	guint ticks, parts;
+	gint desync;
+
+	replay = replay_load(filename);
+	if(!replay)
+		return FALSE;
+
+	memset(&game, 0, sizeof(Game));
+	game.flags = flags;
+	game.state = STATE_STOPPED;
+	if(!replay_start(replay, &game)) {
+		destroy_replay(replay);
+		return FALSE;
+	}
+
+	ticks = play_ticks(replay, &game, G_MAXUINT);
+	desync = replay_desync_tick(replay, &parts);
+
+	if(game.state == STATE_RUNNING) {
+		result = "unfinished";
+		end_game(&game, ENDGAME_MENU);
+	} else if(game.lives < 0) {
+		result = "lose";
+	} else {
+		result = "win";
+	}
+
+	g_print("%s: ticks=%u level=%d score=%d lives=%d result=%s\n",
+			filename, ticks, game.level_no + 1, game.score,
+			game.lives, result);
+	game.playback = NULL;
+
+	if(desync >= 0)
+		report_desync(filename, replay, flags, desync, parts);
+	else if(rewind_bench)
+		bench_rewind(filename, replay, flags);
+
+	destroy_replay(replay);
+
+	return desync < 0;
+}
+
+/* Plays up to max_ticks of a started replay, stopping early if the game or
+ * the replay ends. Returns the number of ticks played */
+static guint play_ticks(struct _Replay *replay, Game *game, guint max_ticks) {
+	guint ticks = 0;
+
+	while(ticks < max_ticks && game->state == STATE_RUNNING
+			&& replay_play_tick(replay, game)) {
+		step_game(game);
+		ticks++;
+	}
+
+	return ticks;
+}
+
+/* The replay only holds hashes, so the state on either side of the tick that
+ * went wrong is found by playing the replay again up to that tick. It comes
+ * out the same every time */
+static void report_desync(gchar *filename, struct _Replay *replay,
+		Flags *flags, gint tick, guint parts) {
+	Game game;
+	gchar *before[NUM_HASH_PARTS], *after[NUM_HASH_PARTS];
+	gint i;
+
+	g_print("%s: desync at tick %d in ", filename, tick);
+	for(i = 0; i < NUM_HASH_PARTS; i++) {
+		if(parts & (1 << i))
+			g_print("%s%s", statehash_part_name(i),
+					(parts >> (i + 1)) ? "," : "\n");
+	}
+
+	memset(&game, 0, sizeof(Game));
+	game.flags = flags;
+	game.state = STATE_STOPPED;
+	if(!replay_start(replay, &game))
+		return;
+	play_ticks(replay, &game, tick);
+	for(i = 0; i < NUM_HASH_PARTS; i++)
+		before[i] = statehash_describe(&game, i);
+	play_ticks(replay, &game, 1);
+	for(i = 0; i < NUM_HASH_PARTS; i++)
+		after[i] = statehash_describe(&game, i);
+
+	for(i = 0; i < NUM_HASH_PARTS; i++) {
+		if(parts & (1 << i)) {
+			g_print("%s:\n", statehash_part_name(i));
+			print_diff(before[i], after[i]);
+		}
+		g_free(before[i]);
+		g_free(after[i]);
+	}
+
+	if(game.state == STATE_RUNNING)
+		end_game(&game, ENDGAME_MENU);
+	game.playback = NULL;
+}
+
+/* Plays the replay again, taking snapshots for rewinding as iterate_game
+ * does, and reports what they cost */
+static void bench_rewind(gchar *filename, struct _Replay *replay,
+		Flags *flags) {
+	Game game;
+	Rewind *rewind;
+	GTimer *timer;
+	GString *snapshot;
+	gdouble elapsed, total = 0, worst = 0;
+	guint ticks = 0, num_snapshots, ticks_held;
+	gsize bytes_used, full_bytes = 0;
+
+	memset(&game, 0, sizeof(Game));
+	game.flags = flags;
+	game.state = STATE_STOPPED;
+	if(!replay_start(replay, &game))
+		return;
+
+	rewind = new_rewind();
+	timer = g_timer_new();
+	while(game.state == STATE_RUNNING && replay_play_tick(replay, &game)) {
+		step_game(&game);
+		if(game.state != STATE_RUNNING)
+			break;
+		ticks++;
+
+		g_timer_start(timer);
+		rewind_tick(rewind, &game);
+		elapsed = g_timer_elapsed(timer, NULL);
+		total += elapsed;
+		worst = MAX(worst, elapsed);
+
+		if(!full_bytes) {
+			snapshot = savegame_write(&game);
+			full_bytes = snapshot->len;
+			g_string_free(snapshot, TRUE);
+		}
+	}
+	rewind_stats(rewind, &num_snapshots, &bytes_used, &ticks_held);
+
+	g_timer_start(timer);
+	snapshot = rewind_back(rewind, REWIND_TICKS);
+	elapsed = g_timer_elapsed(timer, NULL);
+	if(snapshot)
+		g_string_free(snapshot, TRUE);
+
+	g_print("%s: rewind ticks=%u us_per_tick=%.2f worst_us=%.1f "
+			"snapshots=%u bytes=%lu budget=%d seconds=%.1f "
+			"full_bytes=%lu rewind_us=%.1f\n", filename, ticks,
+			ticks ? total * 1e6 / ticks : 0.0, worst * 1e6,
+			num_snapshots, (gulong) bytes_used, REWIND_BUDGET,
+			(gdouble) ticks_held / FRAMES_PER_SECOND,
+			(gulong) full_bytes, elapsed * 1e6);
+
+	g_timer_destroy(timer);
+	destroy_rewind(rewind);
+	if(game.state == STATE_RUNNING)
+		end_game(&game, ENDGAME_MENU);
+	game.playback = NULL;
+}
+
+/* Prints the lines that differ between two descriptions of the state. If the
+ * tick didn't change them at all, the recording expected it to, so the whole
+ * of the state is printed instead */
+static void print_diff(gchar *before, gchar *after) {
+	gchar **old_lines, **new_lines;
+	gchar *old_line, *new_line;
+	gint num_old, num_new, i;
+	gboolean changed = FALSE;
+
+	old_lines = g_strsplit(before, "\n", -1);
+	new_lines = g_strsplit(after, "\n", -1);
+	num_old = g_strv_length(old_lines);
+	num_new = g_strv_length(new_lines);
+
+	for(i = 0; i < MAX(num_old, num_new); i++) {
+		old_line = i < num_old ? old_lines[i] : "";
+		new_line = i < num_new ? new_lines[i] : "";
+		if(strcmp(old_line, new_line)) {
+			if(*old_line)
+				g_print("- %s\n", old_line);
+			if(*new_line)
+				g_print("+ %s\n", new_line);
+			changed = TRUE;
+		}
+	}
+
+	if(!changed) {
+		g_print("  (unchanged by this tick)\n");
+		for(i = 0; i < num_new; i++) {
+			if(*new_lines[i])
+				g_print("  %s\n", new_lines[i]);
+		}
+	}
+
+	g_strfreev(old_lines);
+	g_strfreev(new_lines);
+}
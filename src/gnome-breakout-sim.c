@@ -0,0 +1,213 @@
+/*
+ * gnome-breakout-sim: plays whole games with the bot, without the GUI, one
+ * per seed, and writes what happened in each as a line of JSON. Games are
+ * played on a pool of threads, but the results come out in seed order, and
+ * everything but the timing is the same whatever the number of threads.
+ * This is the thing to run before and after a change to the physics, to see
+ * what it did to the speed and to how games play out.
+ *
+ * Usage: gnome-breakout-sim [-s seed] [-n games] [-g ticks] [-j jobs]
+ *                           [-d easy|medium|hard] [-x] [levelfile...]
+ *
+ * The games use seeds seed to seed + games - 1, and the bot playing each
+ * one uses the game's seed too. With no levelfiles, endless games are
+ * played. With -x, the balls move with fixed point arithmetic (see fixed.c),
+ * so that each game comes out the same on any machine. Each line is of the
+ * form
+ *   {"seed":N,"result":"win|lose|limit","score":N,"ticks":N,"level":N,
+ *    "blocks_cleared":N,"balls_lost":N,"ns_per_tick":N}
+ * where result is limit for a game stopped after -g ticks, and ns_per_tick
+ * is the time taken by the game and the bot together, averaged over the
+ * game's ticks. The time is the CPU time of the thread that played the game,
+ * so it isn't thrown out by having more jobs than CPUs.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "anim.h"
+#include "bot.h"
+#include "flags.h"
+#include "game.h"
+#include "leveldata.h"
+#include <string.h>
+#include <time.h>
+
+/* Internal Data Structures */
+typedef enum { SIM_WIN, SIM_LOSE, SIM_LIMIT } SimResult;
+
+typedef struct {
+	guint32 seed;
+
+	/* Filled in by play_sim */
+	gboolean ok;
+	SimResult result;
+	gint32 score;
+	guint ticks;
+	gint level_no;
+	GameStats stats;
+	gint64 elapsed_ns;
+} Sim;
+
+/* Internal Functions */
+static void play_sim(gpointer data, gpointer user_data);
+static void write_sim(GString *out, Sim *sim);
+static gint64 thread_time_ns(void);
+
+/* Internal Variables */
+static gint seed = 1;
+static gint num_games = 1;
+static gint max_ticks = 50000;
+static gint jobs = 0;
+static gchar *difficulty = "medium";
+static gboolean endless;
+static gboolean fixed_point = FALSE;
+
+/* The names the JSON uses for each SimResult */
+static const gchar *result_names[] = { "win", "lose", "limit" };
+
+static GOptionEntry options[] = {
+	{ "seed", 's', 0, G_OPTION_ARG_INT, &seed,
+		"Seed for the first game (default: 1)", "N" },
+	{ "games", 'n', 0, G_OPTION_ARG_INT, &num_games,
+		"Number of games, each with the next seed (default: 1)", "N" },
+	{ "game-ticks", 'g', 0, G_OPTION_ARG_INT, &max_ticks,
+		"The most ticks a game may run for (default: 50000)", "N" },
+	{ "jobs", 'j', 0, G_OPTION_ARG_INT, &jobs,
+		"Number of games to play at once (default: one per CPU)", "N" },
+	{ "difficulty", 'd', 0, G_OPTION_ARG_STRING, &difficulty,
+		"easy, medium or hard (default: medium)", "D" },
+	{ "fixed-point", 'x', 0, G_OPTION_ARG_NONE, &fixed_point,
+		"Move the balls with fixed point arithmetic", NULL },
+	{ NULL }
+};
+
+int main(int argc, char **argv) {
+	GOptionContext *context;
+	GError *error = NULL;
+	GThreadPool *pool;
+	Flags *flags;
+	Sim *sims;
+	GString *out;
+	gint i, num_failed = 0;
+
+	context = g_option_context_new("[LEVELFILE...] - play games with the bot");
+	g_option_context_add_main_entries(context, options, NULL);
+	if(!g_option_context_parse(context, &argc, &argv, &error)) {
+		g_printerr("%s\n", error->message);
+		return 2;
+	}
+	g_option_context_free(context);
+
+	if(num_games < 1) {
+		g_printerr("There must be at least one game\n");
+		return 2;
+	}
+	if(jobs < 1)
+		jobs = g_get_num_processors();
+
+	flags = load_tool_flags(difficulty);
+	if(!flags)
+		return 2;
+
+	for(i = 1; i < argc; i++) {
+		if(!leveldata_add(argv[i]))
+			return 1;
+	}
+	endless = argc < 2;
+
+	init_animations(FALSE);
+
+	sims = g_new0(Sim, num_games);
+	pool = g_thread_pool_new(play_sim, flags, jobs, TRUE, &error);
+	if(!pool) {
+		g_printerr("%s\n", error->message);
+		return 1;
+	}
+	for(i = 0; i < num_games; i++) {
+		sims[i].seed = seed + i;
+		g_thread_pool_push(pool, &sims[i], NULL);
+	}
+	g_thread_pool_free(pool, FALSE, TRUE);
+
+	out = g_string_new(NULL);
+	for(i = 0; i < num_games; i++) {
+		if(!sims[i].ok) {
+			num_failed++;
+			continue;
+		}
+		write_sim(out, &sims[i]);
+		g_string_append_c(out, '\n');
+	}
+	fputs(out->str, stdout);
+
+	g_string_free(out, TRUE);
+	g_free(sims);
+	destroy_flags(flags);
+
+	return num_failed ? 1 : 0;
+}
+
+/* Thread pool worker. Plays one game, with its own copy of the Flags in
+ * user_data */
+static void play_sim(gpointer data, gpointer user_data) {
+	Sim *sim = (Sim *) data;
+	Game game;
+	gint64 start;
+
+	memset(&game, 0, sizeof(Game));
+	game.flags = copy_flags((Flags *) user_data);
+	game.state = STATE_STOPPED;
+	game.endless = endless;
+	game.fixed_point = fixed_point;
+	if(!new_game(&game, sim->seed)) {
+		destroy_flags(game.flags);
+		return;
+	}
+	game.bot = new_bot(sim->seed, TRUE);
+
+	start = thread_time_ns();
+	while(game.state == STATE_RUNNING && game.ticks < max_ticks) {
+		bot_tick(game.bot, &game);
+		step_game(&game);
+	}
+	sim->elapsed_ns = thread_time_ns() - start;
+
+	if(game.state == STATE_RUNNING)
+		sim->result = SIM_LIMIT;
+	else
+		sim->result = game.lives < 0 ? SIM_LOSE : SIM_WIN;
+	sim->score = game.score;
+	sim->ticks = game.ticks;
+	sim->level_no = game.level_no;
+	sim->stats = game.stats;
+	sim->ok = TRUE;
+
+	if(game.state != STATE_STOPPED)
+		end_game(&game, ENDGAME_MENU);
+	destroy_bot(game.bot);
+	destroy_flags(game.flags);
+}
+
+static void write_sim(GString *out, Sim *sim) {
+	g_string_append_printf(out, "{\"seed\":%u,\"result\":\"%s\","
+			"\"score\":%d,\"ticks\":%u,\"level\":%d,"
+			"\"blocks_cleared\":%u,\"balls_lost\":%u,"
+			"\"ns_per_tick\":%.1f}", sim->seed,
+			result_names[sim->result], sim->score, sim->ticks,
+			sim->level_no + 1, sim->stats.blocks_cleared,
+			sim->stats.balls_lost,
+			sim->ticks ? (gdouble) sim->elapsed_ns / sim->ticks : 0.0);
+}
+
+/* The CPU time used by the calling thread, in nanoseconds */
+static gint64 thread_time_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	return (gint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
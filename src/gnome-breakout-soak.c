@@ -0,0 +1,201 @@
+/*
+ * gnome-breakout-soak: has the bot play game after game, without the GUI, for
+ * as long as it's asked to, and reports how long the ticks are taking and how
+ * much memory the process is using as it goes. Run it for hours to shake out
+ * crashes and leaks.
+ *
+ * Usage: gnome-breakout-soak [-t seconds] [-i seconds] [-g ticks] [-s seed]
+ *                            [-d easy|medium|hard] [levelfile...]
+ *
+ * With no levelfiles, endless games are played. Games that go on for more
+ * than the -g limit are ended, so that games keep starting and ending.
+ *
+ * Every -i seconds, prints
+ *   time=N games=N ticks=N us_per_tick=N worst_us=N rss_kb=N
+ * where ticks, us_per_tick and worst_us cover the ticks since the last line,
+ * and rss_kb is the memory in use, or -1 if that can't be found out. At the
+ * end, prints
+ *   total: games=N won=N lost=N ticks=N us_per_tick=N worst_us=N
+ *     peak_rss_kb=N
+ * on one line.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "anim.h"
+#include "bot.h"
+#include "flags.h"
+#include "game.h"
+#include "leveldata.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Internal Data Structures */
+typedef struct {
+	guint64 ticks;
+	gdouble seconds;
+	gdouble worst;
+} TickStats;
+
+/* Internal Functions */
+static void report(gint time, gint games, TickStats *interval,
+		TickStats *total);
+static void add_tick(TickStats *stats, gdouble seconds);
+static void merge_stats(TickStats *into, TickStats *stats);
+static glong resident_kb(void);
+
+/* Internal Variables */
+static gint run_seconds = 60;
+static gint report_seconds = 10;
+static gint game_ticks = 50000;
+static gint seed = 1;
+static gchar *difficulty = "medium";
+
+static GOptionEntry options[] = {
+	{ "time", 't', 0, G_OPTION_ARG_INT, &run_seconds,
+		"How long to run for, in seconds (default: 60)", "N" },
+	{ "interval", 'i', 0, G_OPTION_ARG_INT, &report_seconds,
+		"How often to report, in seconds (default: 10)", "N" },
+	{ "game-ticks", 'g', 0, G_OPTION_ARG_INT, &game_ticks,
+		"The most ticks a game may run for (default: 50000)", "N" },
+	{ "seed", 's', 0, G_OPTION_ARG_INT, &seed,
+		"Seed for the first game, and its bot (default: 1)", "N" },
+	{ "difficulty", 'd', 0, G_OPTION_ARG_STRING, &difficulty,
+		"easy, medium or hard (default: medium)", "D" },
+	{ NULL }
+};
+
+int main(int argc, char **argv) {
+	GOptionContext *context;
+	GError *error = NULL;
+	GTimer *run_timer, *tick_timer;
+	Flags *flags;
+	Game game;
+	TickStats interval, total;
+	gint i, games = 0, won = 0, lost = 0, next_report;
+	guint game_tick;
+	gdouble now;
+	gboolean cut_short;
+	glong peak_rss = -1;
+
+	context = g_option_context_new("[LEVELFILE...] - soak test gnome-breakout");
+	g_option_context_add_main_entries(context, options, NULL);
+	if(!g_option_context_parse(context, &argc, &argv, &error)) {
+		g_printerr("%s\n", error->message);
+		return 2;
+	}
+	g_option_context_free(context);
+
+	flags = load_tool_flags(difficulty);
+	if(!flags)
+		return 2;
+
+	for(i = 1; i < argc; i++) {
+		if(!leveldata_add(argv[i]))
+			return 1;
+	}
+
+	init_animations(FALSE);
+
+	memset(&game, 0, sizeof(Game));
+	game.flags = flags;
+	game.state = STATE_STOPPED;
+	game.endless = argc < 2;
+
+	memset(&interval, 0, sizeof(TickStats));
+	memset(&total, 0, sizeof(TickStats));
+	run_timer = g_timer_new();
+	tick_timer = g_timer_new();
+	next_report = report_seconds;
+
+	while(g_timer_elapsed(run_timer, NULL) < run_seconds) {
+		if(!new_game(&game, seed + games))
+			return 1;
+		game.bot = new_bot(seed + games, TRUE);
+		games++;
+
+		cut_short = FALSE;
+		for(game_tick = 0; game.state == STATE_RUNNING; game_tick++) {
+			now = g_timer_elapsed(run_timer, NULL);
+			if(now >= next_report) {
+				report(next_report, games, &interval, &total);
+				peak_rss = MAX(peak_rss, resident_kb());
+				next_report += report_seconds;
+			}
+			if(game_tick == game_ticks || now >= run_seconds) {
+				end_game(&game, ENDGAME_MENU);
+				cut_short = TRUE;
+				break;
+			}
+
+			bot_tick(game.bot, &game);
+			g_timer_start(tick_timer);
+			step_game(&game);
+			add_tick(&interval, g_timer_elapsed(tick_timer, NULL));
+		}
+
+		if(game.lives < 0)
+			lost++;
+		else if(!cut_short)
+			won++;
+		destroy_bot(game.bot);
+		game.bot = NULL;
+	}
+
+	merge_stats(&total, &interval);
+	peak_rss = MAX(peak_rss, resident_kb());
+	g_print("total: games=%d won=%d lost=%d ticks=%" G_GUINT64_FORMAT
+			" us_per_tick=%.2f worst_us=%.1f peak_rss_kb=%ld\n",
+			games, won, lost, total.ticks,
+			total.ticks ? total.seconds * 1e6 / total.ticks : 0.0,
+			total.worst * 1e6, peak_rss);
+
+	g_timer_destroy(run_timer);
+	g_timer_destroy(tick_timer);
+
+	return 0;
+}
+
+/* Prints the stats for the last interval, and starts a new one */
+static void report(gint time, gint games, TickStats *interval,
+		TickStats *total) {
+	g_print("time=%d games=%d ticks=%" G_GUINT64_FORMAT " us_per_tick=%.2f"
+			" worst_us=%.1f rss_kb=%ld\n", time, games,
+			interval->ticks, interval->ticks ? interval->seconds
+			* 1e6 / interval->ticks : 0.0, interval->worst * 1e6,
+			resident_kb());
+	merge_stats(total, interval);
+	memset(interval, 0, sizeof(TickStats));
+}
+
+static void add_tick(TickStats *stats, gdouble seconds) {
+	stats->ticks++;
+	stats->seconds += seconds;
+	stats->worst = MAX(stats->worst, seconds);
+}
+
+static void merge_stats(TickStats *into, TickStats *stats) {
+	into->ticks += stats->ticks;
+	into->seconds += stats->seconds;
+	into->worst = MAX(into->worst, stats->worst);
+}
+
+/* How much of the process is in memory, from /proc. Returns -1 where there's
+ * no /proc */
+static glong resident_kb(void) {
+	gchar *contents;
+	glong size, resident;
+
+	if(!g_file_get_contents("/proc/self/statm", &contents, NULL, NULL))
+		return -1;
+	if(sscanf(contents, "%ld %ld", &size, &resident) != 2)
+		resident = -1;
+	g_free(contents);
+
+	return resident < 0 ? -1 : resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
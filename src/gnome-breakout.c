@@ -1,39 +1,82 @@
 #include <unistd.h>
-#include <time.h>
 #include "breakout.h"
 #include "flags.h"
 #include "anim.h"
 #include "gui.h"
 #include "leveldata.h"
+#include "levelwatch.h"
+#include "startup.h"
+#include "memstats.h"
+#include "trace.h"
 
 /* Internal Functions */
 static void init_leveldata(Game *game);
 
+/* Internal Variables */
+static gboolean trace_startup = FALSE;
+static gboolean exit_after_paint = FALSE;
+static gchar *trace_file = NULL;
+static gboolean fixed_point = FALSE;
+
+static GOptionEntry options[] = {
+	{ "trace-startup", 0, 0, G_OPTION_ARG_NONE, &trace_startup,
+		N_("Print how long each part of starting up took"), NULL },
+	{ "exit-after-paint", 0, 0, G_OPTION_ARG_NONE, &exit_after_paint,
+		N_("Quit as soon as the title is up, after printing how long "
+		   "starting up took"), NULL },
+	{ "trace", 0, 0, G_OPTION_ARG_FILENAME, &trace_file,
+		N_("Write a trace of each frame, for chrome://tracing, to FILE"),
+		N_("FILE") },
+	{ "fixed-point", 0, 0, G_OPTION_ARG_NONE, &fixed_point,
+		N_("Move the balls with fixed point arithmetic, so that replays "
+		   "play back the same on any machine"), NULL },
+	{ NULL }
+};
+
 /* Initialises the game struct, sets up gnome and i18n, sets up the animation
  * files, and starts the gui */
 int main(int argc, char **argv) {
 	Game game;
+	GOptionContext *context;
 	gboolean show_score_warning = FALSE;
 
+	startup_begin();
 	show_score_warning = (gnome_score_init(PACKAGE) == -1);
+	startup_phase("gnome_score_init");
 	memset(&game, 0, sizeof(Game));
-
-	srand((unsigned int) clock());
+	game.time_scale = 1;
 
 	bindtextdomain(PACKAGE, GNOMELOCALEDIR);
 	textdomain(PACKAGE);
+	context = g_option_context_new(NULL);
+	g_option_context_add_main_entries(context, options, PACKAGE);
 	gnome_program_init(PACKAGE, VERSION, LIBGNOMEUI_MODULE, argc, argv,
+			GNOME_PARAM_GOPTION_CONTEXT, context,
 			GNOME_PARAM_NONE);
+	startup_set_report(trace_startup, exit_after_paint);
+	if(trace_file)
+		trace_start(trace_file);
+	game.fixed_point = fixed_point;
+	startup_phase("gnome_program_init");
 	gui_init(&game, argc, argv);
+	startup_phase("gui_init");
 	game.flags = load_flags();
+	startup_phase("load_flags");
+	levelwatch_init();
 	init_leveldata(&game);
+	startup_phase("init_leveldata");
 
-	init_animations();
+	init_animations(TRUE);
+	startup_phase("init_animations");
 
 	if(show_score_warning)
 		gb_warning("Failed to initialise gnome_score. Is " PACKAGE " installed setgid to the games group?");
 
 	gtk_main();
+	trace_stop();
+
+	if(!memstats_check_game("exit"))
+		memstats_print();
 
 	return 0;
 }
@@ -17,14 +17,35 @@
 #include "gui-callbacks.h"
 #include "gui-preferences.h"
 #include "game.h"
+#include "flags.h"
 #include "ball.h"
+#include "replay.h"
+#include "savegame.h"
+#include "rewind.h"
+#include "bot.h"
+#include "startup.h"
 
+#include <stdio.h>
 #include <X11/X.h>
 #include <X11/Xlib.h>
 #include <gdk/gdkx.h>
 
 //#define NEXTLEVEL_KEY 1
 
+/* How far Skip ahead goes */
+#define SKIP_SECONDS 60
+
+/* Internal Functions */
+static gchar *suspend_filename(void);
+static void stop_watching(GuiInfo *gui);
+
+/* Internal Variables */
+
+/* The replay being watched, if any. It brings its own settings with it, so
+ * the player's are put aside until it's done */
+static struct _Replay *watched_replay = NULL;
+static Flags *player_flags = NULL;
+
 /* We need this here because gnome-breakout tends to output alot of nasty
  * warning messages if we quit without killing off alot of canvas objects */
 void cb_exit_game(GtkWidget *widget, gpointer data) {
@@ -119,6 +140,10 @@ gint cb_keydown(GtkWidget *widget, GdkEventKey *event, gpointer data) {
 		}
 	}
 
+	/* Whichever way the bat is controlled */
+	if(event->keyval == game->flags->rewind_key)
+		key_rewind_pressed(game);
+
         return FALSE;
 }
 
@@ -154,6 +179,8 @@ void cb_new_game(GtkWidget *widget, gpointer data) {
 	GuiInfo *gui;
 	gui = (GuiInfo *) data;
 
+	stop_watching(gui);
+
 	/* Hide the title */
         /*gnome_canvas_item_hide(gui->title_image);
         gnome_canvas_item_show(gui->background);
@@ -163,7 +190,23 @@ void cb_new_game(GtkWidget *widget, gpointer data) {
 		end_game(gui->game, ENDGAME_MENU);
 	}
 
-	run_game(gui->game);
+	gui->game->endless = FALSE;
+	run_game(gui->game, g_random_int());
+}
+
+/* Starts a game of generated levels */
+void cb_new_endless_game(GtkWidget *widget, gpointer data) {
+	GuiInfo *gui;
+	gui = (GuiInfo *) data;
+
+	stop_watching(gui);
+
+	if(gui->game->state != STATE_STOPPED) {
+		end_game(gui->game, ENDGAME_MENU);
+	}
+
+	gui->game->endless = TRUE;
+	run_game(gui->game, g_random_int());
 }
 
 /* Ends the game and shows the title */
@@ -176,6 +219,137 @@ void cb_end_game(GtkWidget *widget, gpointer data) {
 	}
 }
 
+/* Saves the game and puts it aside, for cb_resume_game to carry on with. This
+ * is for machines that are shared, so that one player can stop for a while
+ * and let someone else have a go */
+void cb_suspend_game(GtkWidget *widget, gpointer data) {
+	GuiInfo *gui;
+	gchar *filename;
+	gui = (GuiInfo *) data;
+
+	if(gui->game->state == STATE_STOPPED) {
+		gui_warning(_("There is no game to suspend"));
+		return;
+	}
+
+	filename = suspend_filename();
+	if(savegame_save(gui->game, filename))
+		end_game(gui->game, ENDGAME_SUSPEND);
+	g_free(filename);
+}
+
+/* Carries on with the game put aside by cb_suspend_game */
+void cb_resume_game(GtkWidget *widget, gpointer data) {
+	GuiInfo *gui;
+	gchar *filename;
+	gboolean resumed;
+	gui = (GuiInfo *) data;
+
+	filename = suspend_filename();
+	if(!g_file_test(filename, G_FILE_TEST_EXISTS)) {
+		gui_warning(_("There is no suspended game"));
+		g_free(filename);
+		return;
+	}
+
+	stop_watching(gui);
+	if(gui->game->state != STATE_STOPPED) {
+		end_game(gui->game, ENDGAME_MENU);
+	}
+
+	resumed = savegame_load(gui->game, filename);
+	/* Only one player gets to resume it */
+	if(resumed)
+		remove(filename);
+	g_free(filename);
+
+	if(resumed) {
+		gui->game->rewind = new_rewind();
+		iterate_game(gui->game);
+	}
+}
+
+/* Plays a saved replay back, in place of the current game */
+void cb_watch_replay(GtkWidget *widget, gpointer data) {
+	GuiInfo *gui;
+	GtkWidget *chooser;
+	gchar *filename = NULL;
+	struct _Replay *replay = NULL;
+
+	gui = (GuiInfo *) data;
+
+	pause_game(gui->game, PAUSE_DIALOG, FALSE);
+
+	chooser = gtk_file_chooser_dialog_new(_("Watch Replay"),
+			GTK_WINDOW(gui->app), GTK_FILE_CHOOSER_ACTION_OPEN,
+			GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+			GTK_STOCK_OPEN, GTK_RESPONSE_ACCEPT,
+			NULL);
+	if(gtk_dialog_run(GTK_DIALOG(chooser)) == GTK_RESPONSE_ACCEPT) {
+		filename = gtk_file_chooser_get_filename(
+				GTK_FILE_CHOOSER(chooser));
+		replay = replay_load(filename);
+		g_free(filename);
+	}
+	gtk_widget_destroy(chooser);
+
+	if(!replay) {
+		pause_game(gui->game, PAUSE_DIALOG, TRUE);
+		return;
+	}
+
+	stop_watching(gui);
+	if(gui->game->state != STATE_STOPPED)
+		end_game(gui->game, ENDGAME_MENU);
+
+	watched_replay = replay;
+	player_flags = gui->game->flags;
+	gui->game->flags = copy_flags(player_flags);
+	if(replay_start(replay, gui->game))
+		iterate_game(gui->game);
+	else
+		stop_watching(gui);
+}
+
+/* Runs the game twice or half as fast. See iterate_game */
+void cb_speed_up(GtkWidget *widget, gpointer data) {
+	GuiInfo *gui;
+	gui = (GuiInfo *) data;
+
+	set_time_scale(gui->game, gui->game->time_scale * 2);
+}
+
+void cb_slow_down(GtkWidget *widget, gpointer data) {
+	GuiInfo *gui;
+	gui = (GuiInfo *) data;
+
+	set_time_scale(gui->game, gui->game->time_scale / 2);
+}
+
+/* Runs through the next SKIP_SECONDS of the game without showing them. Mostly
+ * useful when watching replays */
+void cb_skip_ahead(GtkWidget *widget, gpointer data) {
+	GuiInfo *gui;
+	gui = (GuiInfo *) data;
+
+	if(gui->game->state != STATE_STOPPED)
+		skip_ticks(gui->game, SKIP_SECONDS * FRAMES_PER_SECOND);
+}
+
+/* Hands the bat over to the computer, or takes it back */
+void cb_autoplay(GtkWidget *widget, gpointer data) {
+	GuiInfo *gui;
+	gui = (GuiInfo *) data;
+
+	if(gui->game->bot) {
+		destroy_bot(gui->game->bot);
+		gui->game->bot = NULL;
+		gui->game->keyboard_move = 0;
+	} else {
+		gui->game->bot = new_bot(g_random_int(), TRUE);
+	}
+}
+
 /* Just calls pause_game. Included for consistency */
 void cb_pause_game(GtkWidget *widget, gpointer data) {
 	GuiInfo *gui;
@@ -193,6 +367,9 @@ void cb_preferences(GtkWidget *widget, gpointer data) {
 	GuiInfo *gui;
 	gui = (GuiInfo *) data;
 
+	/* The preferences are the player's, not the replay's */
+	stop_watching(gui);
+
 	make_preferences_box(gui);
 }
 
@@ -243,13 +420,57 @@ gboolean cb_canvas_button_press(GtkWidget *widget, GdkEventButton *event,
 	return FALSE;
 }
 
+/* Runs once, after the canvas has been drawn for the first time */
+gboolean cb_canvas_first_expose(GtkWidget *widget, GdkEventExpose *event,
+		gpointer data) {
+	g_signal_handlers_disconnect_by_func(G_OBJECT(widget),
+			G_CALLBACK(cb_canvas_first_expose), data);
+	startup_first_paint();
+
+	return FALSE;
+}
+
 /* Kills the current ball, if it gets stuck inside a block */
 void cb_kill_ball(GtkWidget *widget, gpointer data) {
 	GuiInfo *gui;
 	gui = (GuiInfo *) data;
 
-	if(gui->game->balls)
-		ball_die(gui->game, (Ball *) gui->game->balls->data);
+	/* Done on the next tick, so that it can be recorded */
+	if(gui->game->state == STATE_RUNNING)
+		gui->game->kill_ball_pressed = TRUE;
+}
+
+/* Saves a replay of the current, or last, game */
+void cb_save_replay(GtkWidget *widget, gpointer data) {
+	GuiInfo *gui;
+	GtkWidget *chooser;
+	gchar *filename;
+
+	gui = (GuiInfo *) data;
+
+	if(!gui->game->recording) {
+		gui_warning(_("There is no game to save a replay of"));
+		return;
+	}
+
+	pause_game(gui->game, PAUSE_DIALOG, FALSE);
+
+	chooser = gtk_file_chooser_dialog_new(_("Save Replay"),
+			GTK_WINDOW(gui->app), GTK_FILE_CHOOSER_ACTION_SAVE,
+			GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+			GTK_STOCK_SAVE, GTK_RESPONSE_ACCEPT,
+			NULL);
+	gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(chooser),
+			"game.gbr");
+	if(gtk_dialog_run(GTK_DIALOG(chooser)) == GTK_RESPONSE_ACCEPT) {
+		filename = gtk_file_chooser_get_filename(
+				GTK_FILE_CHOOSER(chooser));
+		replay_save(gui->game->recording, filename);
+		g_free(filename);
+	}
+	gtk_widget_destroy(chooser);
+
+	pause_game(gui->game, PAUSE_DIALOG, TRUE);
 }
 
 /* Displays the scores */
@@ -340,3 +561,26 @@ gboolean cb_null(GtkWidget *w, void **data) {
 
 	return TRUE;
 }
+
+/* Stops watching a replay, if one is being watched, and gives the player
+ * their settings back */
+static void stop_watching(GuiInfo *gui) {
+	if(!watched_replay)
+		return;
+
+	if(gui->game->state != STATE_STOPPED)
+		end_game(gui->game, ENDGAME_MENU);
+	gui->game->playback = NULL;
+	destroy_replay(watched_replay);
+	watched_replay = NULL;
+
+	destroy_flags(gui->game->flags);
+	gui->game->flags = player_flags;
+	player_flags = NULL;
+}
+
+/* Where cb_suspend_game keeps the suspended game. Free it with g_free */
+static gchar *suspend_filename(void) {
+	return g_build_filename(gnome_user_dir_get(), PACKAGE ".suspended",
+			NULL);
+}
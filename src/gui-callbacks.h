@@ -19,15 +19,26 @@ gint cb_sig_exit_game(GtkWidget *widget, GdkEvent *event, gpointer data);
 gint cb_keydown(GtkWidget *widget, GdkEventKey *event, gpointer data);
 gint cb_keyup(GtkWidget *widget, GdkEventKey *event, gpointer data);
 void cb_new_game(GtkWidget *widget, gpointer data);
+void cb_new_endless_game(GtkWidget *widget, gpointer data);
 void cb_pause_game(GtkWidget *widget, gpointer data);
 void cb_end_game(GtkWidget *widget, gpointer data);
+void cb_suspend_game(GtkWidget *widget, gpointer data);
+void cb_resume_game(GtkWidget *widget, gpointer data);
 void cb_kill_ball(GtkWidget *widget, gpointer data);
+void cb_save_replay(GtkWidget *widget, gpointer data);
+void cb_watch_replay(GtkWidget *widget, gpointer data);
+void cb_speed_up(GtkWidget *widget, gpointer data);
+void cb_slow_down(GtkWidget *widget, gpointer data);
+void cb_skip_ahead(GtkWidget *widget, gpointer data);
+void cb_autoplay(GtkWidget *widget, gpointer data);
 void cb_scores(GtkWidget *widget, gpointer data);
 void cb_preferences(GtkWidget *widget, gpointer data);
 void cb_help(GtkWidget *widget, gpointer data);
 gboolean cb_main_focus_change(GtkWidget *widget, GdkEvent *event, gpointer data);
 gboolean cb_canvas_button_press(GtkWidget *widget, GdkEventButton *event,
 		gpointer data);
+gboolean cb_canvas_first_expose(GtkWidget *widget, GdkEventExpose *event,
+		gpointer data);
 gboolean cb_grab_focus(GtkWidget *widget, GdkEvent *event, gpointer data);
 gboolean cb_ungrab_focus(GtkWidget *widget, GdkEvent *event, gpointer data);
 gboolean cb_hide_pointer(GtkWidget *widget, GdkEvent *event, gpointer data);
@@ -0,0 +1,93 @@
+/*
+ * A stand-in for gui.c, for the tools that run games without a display. Every
+ * function of gui.h is here, and none of them draw anything. Warnings and
+ * errors go to stderr.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "gui.h"
+
+void gui_init(Game *game, int argc, char **argv) {
+}
+
+void add_to_canvas(Entity *entity) {
+}
+
+void remove_from_canvas(Entity *entity) {
+	entity->animation.canvas_item = NULL;
+}
+
+void add_to_canvas_layer(Entity *entity, GnomeCanvasItem *layer) {
+}
+
+GnomeCanvasItem *gui_new_layer(void) {
+	return NULL;
+}
+
+void gui_show_layer(GnomeCanvasItem *layer) {
+}
+
+void gui_hide_layer(GnomeCanvasItem *layer) {
+}
+
+void gui_destroy_layer(GnomeCanvasItem *layer) {
+}
+
+void gui_update_game(Game *game) {
+}
+
+void process_gnome_events(void) {
+}
+
+void update_canvas_position(Entity *entity) {
+}
+
+void update_canvas_animation(Entity *entity) {
+}
+
+void gui_defer_canvas(gboolean defer) {
+}
+
+void gui_sync_canvas(Game *game) {
+}
+
+void gui_begin_game(void) {
+}
+
+void gui_new_level(Level *level) {
+}
+
+void gui_end_game(EndGameStatus status) {
+}
+
+void gui_levelfiles_changed(void) {
+}
+
+gint get_mouse_x_position(void) {
+	return 0;
+}
+
+void gui_warning(gchar *format, ...) {
+	va_list ap;
+
+	va_start(ap, format);
+	fputs("WARNING: ", stderr);
+	vfprintf(stderr, format, ap);
+	fputc('\n', stderr);
+	va_end(ap);
+}
+
+void gui_error(gchar *format, ...) {
+	va_list ap;
+
+	va_start(ap, format);
+	fputs("ERROR: ", stderr);
+	vfprintf(stderr, format, ap);
+	fputc('\n', stderr);
+	va_end(ap);
+}
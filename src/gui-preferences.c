@@ -36,6 +36,8 @@ typedef struct {
 	GtkTreeIter level_list_iter;
 } LevelFrame;
 
+static LevelFrame *level_frame = NULL; /* While the dialog is open */
+
 /* Internal functions */
 static void init_preferences_box(GuiInfo *gui, GtkNotebook **window_notebook);
 static void init_game_page(GuiInfo *gui, GtkNotebook *window_notebook);
@@ -132,6 +134,7 @@ static void cb_pref_destroy(GtkWidget *widget, gpointer data) {
 	gui = (GuiInfo *) data;
 
 	dialog = NULL;
+	level_frame = NULL;
 
 	destroy_flags(newflags);
 
@@ -244,6 +247,7 @@ void init_game_page(GuiInfo *gui, GtkNotebook *window_notebook) {
 	levelfiles = leveldata_titlelist();
 	populate_level_list(&lf, levelfiles);
 	g_list_free(levelfiles);
+	level_frame = &lf;
 	gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (lf.level_list_scrollpane), GTK_POLICY_NEVER, GTK_POLICY_ALWAYS);
 	gtk_tree_view_set_headers_visible(lf.level_list_view, FALSE);
 	
@@ -696,6 +700,27 @@ static void populate_level_list(LevelFrame *lf, GList *filenames) {
 	}
 }
 
+/* Rebuilds the level list of an open dialog, since a levelfile that was
+ * reloaded may have changed its title. The selection is dropped, so that
+ * Remove can't be given a title that is no longer there */
+void preferences_levelfiles_changed(void) {
+	GList *levelfiles;
+
+	if(!level_frame)
+		return;
+
+	if(level_frame->level_list_selection) {
+		g_free(level_frame->level_list_selection);
+		level_frame->level_list_selection = NULL;
+	}
+	gtk_list_store_clear(level_frame->level_list_store);
+	gtk_widget_set_sensitive(GTK_WIDGET(level_frame->remove_button), FALSE);
+
+	levelfiles = leveldata_titlelist();
+	populate_level_list(level_frame, levelfiles);
+	g_list_free(levelfiles);
+}
+
 static void cb_level_list_changed(GtkTreeSelection *selection,
 		gpointer data) {
 	LevelFrame *lf = (LevelFrame *) data;
@@ -8,3 +8,4 @@
  */
 
 void make_preferences_box(GuiInfo *gui);
+void preferences_levelfiles_changed(void);
@@ -11,17 +11,32 @@
 #include "breakout.h"
 #include "gui.h"
 #include "gui-callbacks.h"
+#include "gui-preferences.h"
 #include "game.h"
+#include "leveldata.h"
 #include "anim.h"
+#include "memstats.h"
+
+/* The largest the canvas is allowed to grow to. Levels bigger than this are
+ * scrolled around the bat and the balls */
+#define MAX_VIEW_WIDTH 1000
+#define MAX_VIEW_HEIGHT 720
 
 /* See gui.h for more info */
 static GuiInfo *gui = NULL;
 
+/* While this is set, entities moving and animating don't touch the canvas.
+ * gui_sync_canvas catches it up afterwards */
+static gboolean canvas_deferred = FALSE;
+
 /* Internal functions */
 static void init_canvas(void);
 static void init_labels(void);
 static void init_menus(void);
 static void init_statusbar(void);
+static void set_canvas_size(gint width, gint height);
+static void scroll_to_action(Game *game);
+static void sync_entity(Entity *entity);
 
 /* Initialise the interface. */
 void gui_init(Game *game, int argc, char **argv) {
@@ -81,15 +96,12 @@ static void init_canvas(void) {
 
 	/* Set the canvas attributes */
 	gnome_canvas_set_pixels_per_unit(gui->canvas, 1);
-	gtk_widget_set_usize(GTK_WIDGET(gui->canvas), GAME_WIDTH, GAME_HEIGHT);
-	gnome_canvas_set_scroll_region(gui->canvas, 0, 0, GAME_WIDTH,
-			GAME_HEIGHT);
 
 	/* Make the canvas background black */
 	gui->background = gnome_canvas_item_new(gnome_canvas_root(gui->canvas),
 			GNOME_TYPE_CANVAS_RECT, "x1", 0.0, "x2",
-			(double) GAME_WIDTH, "y1", 0.0, "y2",
-			(double) GAME_HEIGHT, "fill_color", "black", NULL);
+			(double) TITLE_WIDTH, "y1", 0.0, "y2",
+			(double) TITLE_HEIGHT, "fill_color", "black", NULL);
 	gnome_canvas_item_hide(gui->background);
 
 	/* Add the title image */
@@ -103,11 +115,12 @@ static void init_canvas(void) {
 			gnome_canvas_root(gui->canvas),
 			GNOME_TYPE_CANVAS_PIXBUF, "pixbuf", image, 
 			"x", 0.0, "y", 0.0,
-			"width", (double) GAME_WIDTH, 
-			"height", (double) GAME_HEIGHT,
+			"width", (double) TITLE_WIDTH, 
+			"height", (double) TITLE_HEIGHT,
 			"anchor", GTK_ANCHOR_NORTH_WEST,
 			NULL);
 
+	set_canvas_size(TITLE_WIDTH, TITLE_HEIGHT);
 	gnome_canvas_update_now(gui->canvas);
 
 	/* Hide pointer and automatic pause */
@@ -120,6 +133,10 @@ static void init_canvas(void) {
 	g_signal_connect(GTK_OBJECT(gui->canvas), "button_press_event",
 			GTK_SIGNAL_FUNC(cb_canvas_button_press), gui);
 
+	/* Lets startup.c know when the title has been drawn */
+	g_signal_connect_after(GTK_OBJECT(gui->canvas), "expose_event",
+			GTK_SIGNAL_FUNC(cb_canvas_first_expose), gui);
+
 	gtk_box_pack_start(GTK_BOX(gui->vbox), GTK_WIDGET(gui->canvas),
 			FALSE, FALSE, 0);
 }
@@ -156,6 +173,56 @@ void add_to_canvas(Entity *entity) {
 			"height", (double) entity->geometry.y2 - entity->geometry.y1,
 			"anchor", GTK_ANCHOR_NORTH_WEST,
 			NULL);
+	memstats_add(MEM_CANVAS_ITEM, sizeof(GnomeCanvasPixbuf));
+}
+
+/* Adds an entity to a layer made with gui_new_layer */
+void add_to_canvas_layer(Entity *entity, GnomeCanvasItem *layer) {
+	entity->animation.canvas_item = gnome_canvas_item_new(
+			GNOME_CANVAS_GROUP(layer),
+			GNOME_TYPE_CANVAS_PIXBUF,
+			"pixbuf", entity->animation.pixmaps[entity->animation.frame_no],
+			"x", (double) entity->geometry.x1,
+			"y", (double) entity->geometry.y1,
+			"width", (double) entity->geometry.x2 - entity->geometry.x1,
+			"height", (double) entity->geometry.y2 - entity->geometry.y1,
+			"anchor", GTK_ANCHOR_NORTH_WEST,
+			NULL);
+	memstats_add(MEM_CANVAS_ITEM, sizeof(GnomeCanvasPixbuf));
+}
+
+/* Creates a hidden group on the canvas, above the background but below
+ * everything else, so that a level's blocks can be put on the canvas before
+ * it is played */
+GnomeCanvasItem *gui_new_layer(void) {
+	GnomeCanvasItem *layer;
+
+	layer = gnome_canvas_item_new(gnome_canvas_root(gui->canvas),
+			GNOME_TYPE_CANVAS_GROUP,
+			"x", 0.0,
+			"y", 0.0,
+			NULL);
+	memstats_add(MEM_CANVAS_ITEM, sizeof(GnomeCanvasGroup));
+	gnome_canvas_item_hide(layer);
+	gnome_canvas_item_lower_to_bottom(layer);
+	gnome_canvas_item_lower_to_bottom(gui->background);
+
+	return layer;
+}
+
+void gui_show_layer(GnomeCanvasItem *layer) {
+	gnome_canvas_item_show(layer);
+}
+
+void gui_hide_layer(GnomeCanvasItem *layer) {
+	gnome_canvas_item_hide(layer);
+}
+
+/* Destroys a layer. Any entities still on it should have been removed with
+ * remove_from_canvas first */
+void gui_destroy_layer(GnomeCanvasItem *layer) {
+	gtk_object_destroy(GTK_OBJECT(layer));
+	memstats_remove(MEM_CANVAS_ITEM, sizeof(GnomeCanvasGroup));
 }
 
 /* Remove an entity from the gnome canvas. Does not assume that the entity
@@ -164,6 +231,7 @@ void remove_from_canvas(Entity *entity) {
 	if(entity->animation.canvas_item) {
 		gtk_object_destroy(GTK_OBJECT(entity->animation.canvas_item));
 		entity->animation.canvas_item = NULL;
+		memstats_remove(MEM_CANVAS_ITEM, sizeof(GnomeCanvasPixbuf));
 	}
 }
 
@@ -177,8 +245,9 @@ void process_gnome_events(void) {
  * every iteration */
 void gui_update_game(Game *game) {
 	char *score, *lives, *level_no, *level_name, *level_levelfile, *level_author;
+	char *speed;
 	static gint32 oldscore = -1;
-	static gint oldlives = -1, oldlevel = -1;
+	static gint oldlives = -1, oldlevel = -1, oldscale = 1;
 
 	if(oldlevel != game->level_no) {
 		oldlevel = game->level_no;
@@ -220,22 +289,121 @@ void gui_update_game(Game *game) {
 		g_free(lives);
 	}
 
+	if(oldscale != game->time_scale) {
+		oldscale = game->time_scale;
+		if(oldscale > 1) {
+			speed = g_strdup_printf(_("Speed: %dx"), oldscale);
+			gnome_appbar_set_status(GNOME_APPBAR(gui->appbar),
+					speed);
+			g_free(speed);
+		} else {
+			gnome_appbar_set_status(GNOME_APPBAR(gui->appbar), "");
+		}
+	}
+
+	scroll_to_action(game);
 	gnome_canvas_update_now(gui->canvas);
 	return;
 }
 
+/* Resizes the playing field for a newly generated level */
+void gui_new_level(Level *level) {
+	set_canvas_size(GAME_WIDTH(level), GAME_HEIGHT(level));
+	gnome_canvas_item_set(gui->background,
+			"x2", (double) GAME_WIDTH(level),
+			"y2", (double) GAME_HEIGHT(level),
+			NULL);
+}
+
+/* Tells the gui that the titles of the levelfiles may have changed */
+void gui_levelfiles_changed(void) {
+	preferences_levelfiles_changed();
+}
+
+/* Sets the scroll region of the canvas to width x height, and sizes the
+ * widget to match, up to MAX_VIEW_WIDTH x MAX_VIEW_HEIGHT */
+static void set_canvas_size(gint width, gint height) {
+	gui->field_width = width;
+	gui->field_height = height;
+	gui->view_width = MIN(width, MAX_VIEW_WIDTH);
+	gui->view_height = MIN(height, MAX_VIEW_HEIGHT);
+
+	gtk_widget_set_usize(GTK_WIDGET(gui->canvas), gui->view_width,
+			gui->view_height);
+	gnome_canvas_set_scroll_region(gui->canvas, 0, 0, width, height);
+	gnome_canvas_scroll_to(gui->canvas, 0, 0);
+}
+
+/* When the level is bigger than the view, keeps the bat centered
+ * horizontally. Vertically, the view never leaves the bat's row, and
+ * within that follows the lowest ball, so a ball high up on a tall level
+ * is only kept in view as far as the bat can stay in view too */
+static void scroll_to_action(Game *game) {
+	GList *curr;
+	Ball *ball;
+	gint x, y, cx, cy, top, lowest = -1;
+
+	if(!game->bat || (gui->field_width == gui->view_width
+			&& gui->field_height == gui->view_height))
+		return;
+
+	x = (game->bat->geometry.x1 + game->bat->geometry.x2) / 2;
+	for(curr = game->balls; curr; curr = g_list_next(curr)) {
+		ball = (Ball *) curr->data;
+		if(ball->geometry.y2 > lowest)
+			lowest = ball->geometry.y2;
+	}
+	if(lowest < 0)
+		lowest = game->bat->geometry.y1;
+
+	x = CLAMP(x - gui->view_width / 2, 0, gui->field_width - gui->view_width);
+	top = MAX(game->bat->geometry.y2 - gui->view_height, 0);
+	y = CLAMP(lowest - gui->view_height / 2, top, gui->field_height - gui->view_height);
+
+	gnome_canvas_get_scroll_offsets(gui->canvas, &cx, &cy);
+	if(cx != x || cy != y)
+		gnome_canvas_scroll_to(gui->canvas, x, y);
+}
+
 /* Assumes that we already have an appbar */
 static void init_menus() {
 	GnomeUIInfo game_menu[] = {
 		GNOMEUIINFO_MENU_NEW_GAME_ITEM(cb_new_game, gui),
+		GNOMEUIINFO_ITEM_DATA(_("New _endless game"),
+				_("Start a game of never ending generated levels"),
+				cb_new_endless_game, gui, NULL),
 		GNOMEUIINFO_MENU_PAUSE_GAME_ITEM(cb_pause_game, gui),
 		GNOMEUIINFO_MENU_END_GAME_ITEM(cb_end_game, gui),
+		GNOMEUIINFO_ITEM_DATA(_("_Suspend game"),
+				_("Put the game aside, to be resumed later"),
+				cb_suspend_game, gui, NULL),
+		GNOMEUIINFO_ITEM_DATA(_("_Resume game"),
+				_("Carry on with the suspended game"),
+				cb_resume_game, gui, NULL),
 		GNOMEUIINFO_SEPARATOR,
 		GNOMEUIINFO_MENU_PREFERENCES_ITEM(cb_preferences, gui),
 		/* FIXME: Remove this when appropriate */
 		GNOMEUIINFO_ITEM_DATA(_("_Kill ball"), 
 				_("Kill the current ball if it gets stuck"),
 				cb_kill_ball, gui, NULL),
+		GNOMEUIINFO_ITEM_DATA(_("Save _replay..."),
+				_("Save a replay of the current or last game"),
+				cb_save_replay, gui, NULL),
+		GNOMEUIINFO_ITEM_DATA(_("_Watch replay..."),
+				_("Watch a saved replay"),
+				cb_watch_replay, gui, NULL),
+		GNOMEUIINFO_ITEM_DATA(_("Speed _up"),
+				_("Run the game twice as fast"),
+				cb_speed_up, gui, NULL),
+		GNOMEUIINFO_ITEM_DATA(_("Slow _down"),
+				_("Run the game half as fast"),
+				cb_slow_down, gui, NULL),
+		GNOMEUIINFO_ITEM_DATA(_("Skip _ahead"),
+				_("Skip a minute of the game without showing it"),
+				cb_skip_ahead, gui, NULL),
+		GNOMEUIINFO_ITEM_DATA(_("A_utoplay"),
+				_("Let the computer play, or stop it playing"),
+				cb_autoplay, gui, NULL),
 		GNOMEUIINFO_MENU_SCORES_ITEM(cb_scores, gui),
 		GNOMEUIINFO_SEPARATOR,
 		GNOMEUIINFO_MENU_EXIT_ITEM(cb_exit_game, gui),
@@ -258,8 +426,8 @@ static void init_menus() {
 	gnome_app_create_menus(gui->app, menubar);
 	gnome_app_install_menu_hints(gui->app, menubar);
 	gui->menu_new_game = game_menu[0].widget;
-	gui->menu_pause = game_menu[1].widget;
-	gui->menu_end_game = game_menu[2].widget;
+	gui->menu_pause = game_menu[2].widget;
+	gui->menu_end_game = game_menu[3].widget;
 	gtk_widget_set_sensitive(gui->menu_pause, FALSE);
 	gtk_widget_set_sensitive(gui->menu_end_game, FALSE);
 }
@@ -267,7 +435,7 @@ static void init_menus() {
 /* Updates the position of an item on the canvas. Assumes that the width or
  * height of the object hasn't changed */
 void update_canvas_position(Entity *entity) {
-	if(entity->animation.canvas_item) {
+	if(entity->animation.canvas_item && !canvas_deferred) {
 		gnome_canvas_item_set(GNOME_CANVAS_ITEM(entity->animation.canvas_item),
 			"x", (double) entity->geometry.x1,
 			"y", (double) entity->geometry.y1,
@@ -278,13 +446,49 @@ void update_canvas_position(Entity *entity) {
 /* Updates the current pixmap of an item on the canvas */
 void update_canvas_animation(Entity *entity) {
 	g_assert(entity->animation.pixmaps[entity->animation.frame_no]);
-	if(entity->animation.canvas_item) {
+	if(entity->animation.canvas_item && !canvas_deferred) {
 		gnome_canvas_item_set(GNOME_CANVAS_ITEM(entity->animation.canvas_item),
 				"pixbuf", entity->animation.pixmaps[entity->animation.frame_no],
 				NULL);
 	}
 }
 
+/* Stops, or starts again, moving things on the canvas as entities move. This
+ * is for running many ticks for one frame: only where things end up matters,
+ * and gui_sync_canvas puts them there */
+void gui_defer_canvas(gboolean defer) {
+	canvas_deferred = defer;
+}
+
+/* Puts everything that moves or animates where it is now. Blocks only change
+ * while they're active, and anything added or removed while the canvas was
+ * deferred has been added or removed already */
+void gui_sync_canvas(Game *game) {
+	GList *curr;
+
+	g_assert(!canvas_deferred);
+
+	if(game->bat) {
+		sync_entity((Entity *) game->bat);
+		for(curr = game->bat->children; curr; curr = g_list_next(curr))
+			sync_entity((Entity *) curr->data);
+	}
+	for(curr = game->balls; curr; curr = g_list_next(curr))
+		sync_entity((Entity *) curr->data);
+	for(curr = game->powerups; curr; curr = g_list_next(curr))
+		sync_entity((Entity *) curr->data);
+	if(game->level) {
+		for(curr = game->level->active_blocks; curr;
+				curr = g_list_next(curr))
+			update_canvas_animation((Entity *) curr->data);
+	}
+}
+
+static void sync_entity(Entity *entity) {
+	update_canvas_position(entity);
+	update_canvas_animation(entity);
+}
+
 /* Tell the gui that the game has ended, and that we should display the title
  * This must be called by everything that calls game.c:end_game, and it must
  * be called before calling game.c:end_game */
@@ -292,8 +496,12 @@ void gui_end_game(EndGameStatus status) {
 	int pos;
 	char *title = NULL;
 
+	/* Levelfiles that were reloaded during the game can go in now */
+	leveldata_hold(FALSE);
+
 	gnome_canvas_item_hide(gui->background);
         gnome_canvas_item_show(gui->title_image);
+	set_canvas_size(TITLE_WIDTH, TITLE_HEIGHT);
         gnome_canvas_update_now(gui->canvas);
 
         gtk_widget_set_sensitive(gui->score_label, FALSE);
@@ -305,6 +513,11 @@ void gui_end_game(EndGameStatus status) {
 	gtk_widget_set_sensitive(gui->menu_pause, FALSE);
 	gtk_widget_set_sensitive(gui->menu_end_game, FALSE);
 
+	/* Neither a suspended game nor somebody else's replay has a score
+	 * to log */
+	if(status == ENDGAME_SUSPEND || gui->game->playback)
+		return;
+
 	pos = gnome_score_log((gfloat) gui->game->score, NULL, TRUE);
 	switch(status) {
 		case ENDGAME_WIN :
@@ -325,6 +538,8 @@ void gui_end_game(EndGameStatus status) {
 
 /* Tell the gui that the game has begun, and that we should hide the title */
 void gui_begin_game(void) {
+	leveldata_hold(TRUE);
+
         gnome_canvas_item_hide(gui->title_image);
         gnome_canvas_item_show(gui->background);
         gnome_canvas_update_now(gui->canvas);
@@ -339,10 +554,16 @@ void gui_begin_game(void) {
 	gtk_widget_set_sensitive(gui->menu_end_game, TRUE);
 }
 
+/* Returns the pointer's position across the playing field. If the level is
+ * wider than the view, the width of the view is stretched over the whole
+ * field, so that the bat can reach both walls without the view scrolling
+ * away from under the pointer */
 gint get_mouse_x_position(void) {
 	gint x;
 	gint y;
 	gtk_widget_get_pointer(GTK_WIDGET(gui->app), &x, &y);
+	if(gui->field_width > gui->view_width)
+		x = x * gui->field_width / gui->view_width;
 	return x;
 }
 
@@ -10,12 +10,21 @@
 void gui_init(Game *game, int argc, char **argv);
 void add_to_canvas(Entity *entity);
 void remove_from_canvas(Entity *entity);
+void add_to_canvas_layer(Entity *entity, GnomeCanvasItem *layer);
+GnomeCanvasItem *gui_new_layer(void);
+void gui_show_layer(GnomeCanvasItem *layer);
+void gui_hide_layer(GnomeCanvasItem *layer);
+void gui_destroy_layer(GnomeCanvasItem *layer);
 void gui_update_game(Game *game);
 void process_gnome_events(void);
 void update_canvas_position(Entity *entity);
 void update_canvas_animation(Entity *entity);
+void gui_defer_canvas(gboolean defer);
+void gui_sync_canvas(Game *game);
 void gui_begin_game(void);
+void gui_new_level(Level *level);
 void gui_end_game(EndGameStatus status);
+void gui_levelfiles_changed(void);
 gint get_mouse_x_position(void);
 void gui_warning(gchar *format, ...);
 void gui_error(gchar *format, ...);
@@ -40,5 +49,9 @@ typedef struct {
 	GtkWidget *menu_pause;
 	GtkWidget *menu_new_game;
 	GtkWidget *menu_end_game;
+	gint field_width; /* Size of the playing field */
+	gint field_height;
+	gint view_width; /* Size of the visible part of the field */
+	gint view_height;
 	Game *game;
 } GuiInfo;
@@ -0,0 +1,47 @@
+/*
+ * Helpers for writing JSON from the command line tools. There's no need for a
+ * full JSON library, as we only ever write it.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include <glib.h>
+#include "json.h"
+
+/* Appends string to out as a quoted, escaped JSON string. NULL is written as
+ * null */
+void json_append_string(GString *out, const gchar *string) {
+	const gchar *p;
+
+	if(!string) {
+		g_string_append(out, "null");
+		return;
+	}
+
+	g_string_append_c(out, '"');
+	for(p = string; *p; p++) {
+		switch(*p) {
+			case '"' :
+				g_string_append(out, "\\\"");
+				break;
+			case '\\' :
+				g_string_append(out, "\\\\");
+				break;
+			case '\n' :
+				g_string_append(out, "\\n");
+				break;
+			case '\t' :
+				g_string_append(out, "\\t");
+				break;
+			default :
+				if((guchar) *p < 0x20)
+					g_string_append_printf(out, "\\u%04x", *p);
+				else
+					g_string_append_c(out, *p);
+		}
+	}
+	g_string_append_c(out, '"');
+}
@@ -0,0 +1,10 @@
+/*
+ * Helpers for writing JSON from the command line tools
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+void json_append_string(GString *out, const gchar *string);
@@ -1,7 +1,11 @@
 /*
- * Functions for loading and parsing custom level files. leveldata.c keeps an
- * internal repository of levels, and which levels belong to which files.
- * Levels should not be added or removed while the game is running.
+ * Functions for loading custom level files. leveldata.c keeps an internal
+ * repository of levels, and which levels belong to which files. The parsing
+ * itself is done by levelparse.c.
+ * Levels should not be added or removed while the game is running. The
+ * exception is leveldata_reload, which re-parses a single levelfile on a
+ * worker thread and splices the changed levels back in from the main loop,
+ * holding them back until the game stops if one is running.
  *
  * Copyright (c) 2000 Michael Pearson <alcaron@senet.com.au>
  *
@@ -12,47 +16,49 @@
 #include "breakout.h"
 #include "gui.h"
 #include "leveldata.h"
-#include <errno.h>
+#include "levelparse.h"
+#include "levelwatch.h"
 #include <string.h>
 
-/* Internal Contants */
-#define DEFAULT_NAME "No Name"
-#define DEFAULT_AUTHOR "No Author"
-#define DEFAULT_DIFFICULTY 0
-#define VALID_STRING "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz[];',./!@#$^&*()-=_+`~1234567890 "
-#define VALID_INT "1234567890"
-#define VALID_WHITESPACE " \n\t"
-
 /* Internal Data Structures */
-typedef struct {
+typedef struct _LevelFile {
 	gchar *filename;
 	gchar *title;
 	GList *levels; /* Contains RawLevel structures */
+	gboolean reloading; /* A reload thread is parsing this file */
+	gboolean reload_pending; /* The file changed again during the reload */
+	struct _LevelFile *deferred; /* A finished reload, waiting for the game
+					to stop */
 } LevelFile;
 
+/* A reload of one levelfile. Filled in by reload_thread, consumed by
+ * reload_finish in the main loop */
+typedef struct {
+	gchar *filename;
+	LevelFile *levelfile; /* NULL if the parse failed */
+	GList *warnings; /* Messages the parser raised, in order */
+} ReloadJob;
+
 /* Internal Functions */
 static void regenerate_level_list(void);
 static void add_level_to_levels_list(RawLevel *level);
 static void free_levelfile(LevelFile *levelfile);
-static void free_rawlevel(RawLevel *level);
-static RawLevel *read_level(FILE *fp, gchar *default_name, gchar *default_author, gint default_difficulty, gchar *filename, gint *lineno);
-static RawLevel *new_rawlevel(gchar **blocks, gint difficulty, gchar *name, gchar *author, gchar *levelfile_title);
 static LevelFile *new_levelfile(gchar *filename, gchar *title);
-static LevelFile *load_levelfile(gchar *filename);
-static LevelFile *read_levelfile(FILE *fp, gchar *filename);
-static gchar *read_levelblocks(FILE *fp, gchar *filename, gint *lineno);
-static gchar *sep_string(gchar *line, gchar *tag, gchar *filename, gint lineno);
-static gint sep_uint(gchar *line, gchar *tag, gchar *filename, gint lineno);
-static void crop_by_whitespace(gchar *string);
+static LevelFile *load_levelfile(gchar *filename, GList **warnings);
+static void show_warnings(GList *warnings);
 static LevelFile *find_levelfile(gchar *filename, gchar *title);
-static gchar *sep_by_tag(gchar *line, gchar *tag, gchar *filename, gint lineno);
-static gboolean check_valid_chars(gchar *string, gchar *valid, gchar *filename, gint lineno);
-static gint verify_raw_data(gint *data, size_t n, gint max);
+static gpointer reload_thread(gpointer data);
+static gboolean reload_finish(gpointer data);
+static void start_reload(LevelFile *levelfile);
+static void splice_levelfile(LevelFile *old, LevelFile *new);
+static gboolean rawlevel_equal(RawLevel *a, RawLevel *b);
 
 /* Internal Variables */
 static GList *levelfiles = NULL; /* Contains LevelFile structures */
 static GList *levels = NULL; /* Contains RawLevel structures */
 static gint num_levels = 0;
+static gint generation = 0; /* Bumped whenever the levels list changes */
+static gboolean held = FALSE; /* A game is running, see leveldata_hold */
 
 /* Functions */
 
@@ -61,6 +67,7 @@ static gint num_levels = 0;
  * This function, and functions that it calls will issue GUI warnings */
 gchar *leveldata_add(char *filename) {
 	LevelFile *levelfile;
+	GList *warnings = NULL;
 
 	/* See if we already have this file */
 	if(find_levelfile(filename, NULL)) {
@@ -68,13 +75,15 @@ gchar *leveldata_add(char *filename) {
 		return FALSE;
 	}
 		
-	levelfile = load_levelfile(filename);
+	levelfile = load_levelfile(filename, &warnings);
+	show_warnings(warnings);
 
 	/* If the load succeded, add it to the levelfile list and regenerate
 	 * the levels list */
 	if(levelfile) {
 		levelfiles = g_list_prepend(levelfiles, levelfile);
 		regenerate_level_list();
+		levelwatch_add(levelfile->filename);
 		return levelfile->title;
 	} else {
 		return NULL;
@@ -91,6 +100,7 @@ gchar * leveldata_remove(gchar *title) {
 	levelfile = find_levelfile(NULL, title);
 	if(levelfile) {
 		filename = g_strdup(levelfile->filename);
+		levelwatch_remove(levelfile->filename);
 		free_levelfile(levelfile);
 		levelfiles = g_list_remove(levelfiles, levelfile);
 		regenerate_level_list();
@@ -101,6 +111,52 @@ gchar * leveldata_remove(gchar *title) {
 	return filename;
 }
 
+/* Re-reads a levelfile that has changed on disk. The file is parsed on a
+ * worker thread; only the levels that actually changed are swapped into the
+ * sorted levels list, once the parse has finished. Unknown files are
+ * ignored, so that a late notification for a removed file is harmless */
+void leveldata_reload(gchar *filename) {
+	LevelFile *levelfile;
+
+	levelfile = find_levelfile(filename, NULL);
+	if(!levelfile)
+		return;
+
+	if(levelfile->reloading) {
+		/* Pick the new contents up once the current parse is done */
+		levelfile->reload_pending = TRUE;
+	} else {
+		start_reload(levelfile);
+	}
+}
+
+/* Called with TRUE when a game starts and FALSE when it ends. While held,
+ * finished reloads are kept aside rather than spliced in, so that the levels
+ * don't change under the running game; releasing the hold splices them in */
+void leveldata_hold(gboolean hold) {
+	GList *curr;
+	LevelFile *levelfile;
+
+	held = hold;
+	if(held)
+		return;
+
+	for(curr = levelfiles; curr; curr = g_list_next(curr)) {
+		levelfile = (LevelFile *) curr->data;
+		if(levelfile->deferred) {
+			splice_levelfile(levelfile, levelfile->deferred);
+			levelfile->deferred = NULL;
+		}
+	}
+}
+
+/* Returns a number that changes whenever the level numbering or the contents
+ * of any level might have changed, so that anything derived from a level
+ * number can tell when it is stale */
+gint leveldata_generation(void) {
+	return generation;
+}
+
 /* Returns the number of levels that we have in our repository */
 gint leveldata_num_levels(void) {
 	return num_levels;
@@ -117,6 +173,7 @@ static void regenerate_level_list(void) {
 		levels = NULL;
 	} 
 	num_levels = 0;
+	generation++;
 		
 	for(currlf = levelfiles; currlf; currlf = g_list_next(currlf)) {
 		levelfile = (LevelFile *) currlf->data;
@@ -159,6 +216,8 @@ static void free_levelfile(LevelFile *levelfile) {
 		g_free(levelfile->filename);
 	if(levelfile->title)
 		g_free(levelfile->title);
+	if(levelfile->deferred)
+		free_levelfile(levelfile->deferred);
 
 	if(levelfile->levels) {
 		for(curr = levelfile->levels; curr; curr = g_list_next(curr)) {
@@ -171,18 +230,6 @@ static void free_levelfile(LevelFile *levelfile) {
 	g_free(levelfile);
 }
 
-/* Deallocates a rawlevel structure */
-static void free_rawlevel(RawLevel *level) {
-	if(level->name)
-		g_free(level->name);
-	if(level->author)
-		g_free(level->author);
-	if(level->levelfile_title)
-		g_free(level->levelfile_title);
-
-	g_free(level);
-}
-
 /* Generates a new levelfile structure. Duplicates and assigns filename/title
  * if provided */
 static LevelFile *new_levelfile(gchar *filename, gchar *title) {
@@ -191,464 +238,226 @@ static LevelFile *new_levelfile(gchar *filename, gchar *title) {
 	new = g_malloc(sizeof(LevelFile));
 
 	new->levels = NULL;
+	new->reloading = FALSE;
+	new->reload_pending = FALSE;
+	new->deferred = NULL;
 	if(filename)
 		new->filename = g_strdup(filename);
 	else
 		new->filename = NULL;
 
 	if(title)
-		new->filename = g_strdup(title);
+		new->title = g_strdup(title);
 	else
 		new->title = NULL;
 	
 	return new;
 }
 
-/* Generates a new rawlevel structure. Duplicates and assigns fields if they
- * are provided */
-static RawLevel *new_rawlevel(gchar **blocks, gint difficulty, gchar *name, gchar *author, gchar *levelfile_title) {
-	RawLevel *new;
-
-	new = g_malloc(sizeof(RawLevel));
-	memset(new, 0, sizeof(RawLevel));
-
-	if(blocks)
-		memcpy(new->blocks, blocks, sizeof(gchar) * BLOCKS_TOTAL);
-	if(difficulty)
-		new->difficulty = difficulty;
-	if(name)
-		new->name = g_strdup(name);
-	if(author)
-		new->author = g_strdup(author);
-	if(levelfile_title)
-		new->levelfile_title = g_strdup(levelfile_title);
-
-	return new;
-}
-
-/* Attempts to load a levelfile. Returns 0 on failure */
-static LevelFile *load_levelfile(gchar *filename) {
-	FILE *fp;
+/* Attempts to load a levelfile. Returns NULL on failure, in which case
+ * warnings says why */
+static LevelFile *load_levelfile(gchar *filename, GList **warnings) {
 	LevelFile *ret;
+	gchar *title;
+	GList *levels;
 
-	fp = fopen(filename, "r");
-
-	if(!fp) {
-		gui_warning(_("Cannot open levelfile %s, discarding: %s"), filename, strerror(errno));
-		return 0;
-	}
+	if(!levelparse_load(filename, &title, &levels, warnings))
+		return NULL;
 
-	ret = read_levelfile(fp, filename);
+	ret = new_levelfile(filename, NULL);
+	ret->title = title;
+	ret->levels = levels;
 
-	fclose(fp);
 	return ret;
 }
 
-/* Reads an already opened levelfile. Returns 0 on an error */
-static LevelFile *read_levelfile(FILE *fp, gchar *filename) {
-	LevelFile *ret;
+/* Shows, and frees, the messages from levelparse_load */
+static void show_warnings(GList *warnings) {
 	GList *curr;
-	gint lineno = 0 , ret_zero = FALSE;
-	RawLevel *level;
-	gchar buffer[1024];
-	gchar *default_author = NULL;
-	gchar *default_name = NULL;
-	gint default_difficulty = -1;
 
-	ret = new_levelfile(filename, NULL);
-	while(!ret_zero && fgets(buffer, 1024, fp)) {
-		lineno++;
-		crop_by_whitespace(buffer);
-		if(!*buffer || *buffer == '#') {
-			continue;
-		}
-		ret_zero = FALSE;
-
-		if(!strncmp(buffer, "GLOBAL_AUTHOR", strlen("GLOBAL_AUTHOR"))) {
-			default_author = sep_string(buffer, "GLOBAL_AUTHOR", filename, lineno);
-			if(!default_author) {
-				ret_zero = TRUE;
-			}
-		} else if (!strncmp(buffer, "GLOBAL_NAME", strlen("GLOBAL_NAME"))) {
-			default_name = sep_string(buffer, "GLOBAL_NAME", filename, lineno);
-			if(!default_name) {
-				ret_zero = TRUE;
-			}
-		} else if (!strncmp(buffer, "GLOBAL_DIFFICULTY", strlen("GLOBAL_DIFFICULTY"))) {
-			default_difficulty = sep_uint(buffer, "GLOBAL_DIFFICULTY", filename, lineno);
-			if(default_difficulty == -1) {
-				ret_zero = TRUE;
-			}
-		} else if (!strcmp(buffer, "BEGIN_LEVEL")) {
-			level = read_level(fp, default_name, default_author, default_difficulty, filename, &lineno);
-			if(level) {
-				ret->levels = g_list_prepend(ret->levels, level);
-			} else {
-				ret_zero = TRUE;
-			}
-		} else if (!strncmp(buffer, "TITLE ", strlen("TITLE "))) {
-			if(ret->title) {
-				g_free(ret->title);
-			}
-
-			ret->title = sep_string(buffer, "TITLE", filename, lineno);
-			if(!ret->title) {
-				ret_zero = TRUE;
-			}
-		} else {
-			gui_warning(_("Unrecognized or incorrectly positioned directive '%s' on line %d of %s"), buffer, lineno, filename);
-			ret_zero = TRUE;
-		}
-	}
-
-	/* Check any weird IO errors */
-	if(!ret_zero && !feof(fp)) {
-		gui_warning(_("Error while parsing %s: %s"), filename, strerror(errno));
-		ret_zero = TRUE;
+	for(curr = warnings; curr; curr = g_list_next(curr)) {
+		gui_warning("%s", (gchar *) curr->data);
 	}
+	levelparse_free_warnings(warnings);
+}
 
-	if(!ret_zero) {
-		/* Syntax tests passed */
-
-		/* Check that we have a title */
-		if(!ret_zero && !ret->title)
-			ret->title = g_strdup(filename);
+/* Attempts to find a levelfile matching filename and/or title in the 
+ * internal levelfile list. Returns the levelfile on success, NULL otherwise */
+static LevelFile *find_levelfile(gchar *filename, gchar *title) {
+	GList *curr;
+	LevelFile *currlf = NULL;
+	LevelFile *ret = NULL;
 
-		/* Set the "title" entry in each rawlevel */
-		for(curr = ret->levels; curr; curr = g_list_next(curr)) {
-			level = (RawLevel *) curr->data;
-			level->levelfile_title = g_strdup(ret->title);
+	for(curr = levelfiles; curr && !ret; curr = g_list_next(curr)) {
+		currlf = (LevelFile *) curr->data;
+		if((!filename || !strcmp(currlf->filename, filename)) && (!title || !strcmp(currlf->title, title))) {
+			ret = currlf;
 		}
-	} else {
-		/* Syntax tests failed */
-
-		/* Free the junk */
-		free_levelfile(ret);
-		ret = 0;
-	}
-
-		
-	/* Cleanup our defaults*/
-	if(default_name) {
-		g_free(default_name);
-	}
-	if(default_author) {
-		g_free(default_author);
 	}
 
 	return ret;
 }
 
-/* Reads a level section of a levelfile, until it hits an "END_LEVEL". Returns
- * the RawLevel on success, NULL otherwise */
-static RawLevel *read_level(FILE *fp, gchar *default_name, gchar *default_author, gint default_difficulty, gchar *filename, gint *lineno) {
-	RawLevel *ret;
-	char buffer[1024];
-	gchar *blocks;
-	gint ret_zero = FALSE, end_level = 0;
-
-	ret = new_rawlevel(NULL, -1, NULL, NULL, NULL);
-	while(!ret_zero && !end_level && fgets(buffer, 1024, fp)) {
-		ret_zero = FALSE;
-		crop_by_whitespace(buffer);
-		(*lineno)++;
-		if(!*buffer || *buffer == '#') {
-			continue;
-		}
+/* Returns a rawlevel */
+RawLevel *leveldata_get(gint level_num) {
+	GList *curr;
+	gint i;
+	g_assert(level_num < num_levels);
 
-		if(!strcmp(buffer, "END_LEVEL")) {
-			end_level = 1;
-		} else if (!strcmp(buffer, "BEGIN_DATA")) {
-			blocks = read_levelblocks(fp, filename, lineno);
-			if(blocks) {
-				memcpy(ret->blocks, blocks, sizeof(gchar) * BLOCKS_TOTAL);
-			} else {
-				ret_zero = TRUE;
-			}
-		} else if(!strncmp(buffer, "AUTHOR", strlen("AUTHOR"))) {
-			ret->author = sep_string(buffer, "AUTHOR", filename, *lineno);
-			if(!ret->author) {
-				ret_zero = TRUE;
-			}
-		} else if(!strncmp(buffer, "NAME", strlen("NAME"))) {
-			ret->name = sep_string(buffer, "NAME", filename, *lineno);
-			if(!ret->name) {
-				ret_zero = TRUE;
-			}
-		} else if(!strncmp(buffer, "DIFFICULTY", strlen("DIFFICULTY"))) {
-			ret->difficulty = sep_uint(buffer, "DIFFICULTY", filename, *lineno);
-			if(ret->difficulty == -1) {
-				ret_zero = TRUE;
-			}
-		} else {
-			gui_warning(_("Unrecognized or incorrectly positioned directive '%s' on line %d of %s"), buffer, *lineno, filename);
-			ret_zero = TRUE;
-		}
-	}
+	for(i = 0, curr = levels; i < level_num && curr; i++, curr = g_list_next(curr));
+	g_assert(curr);
 
-	if(!ret_zero && !end_level) {
-		if(feof(fp)) {
-			gui_warning(_("Unexpected EOF while parsing level in %s"), filename);
-		} else {
-			gui_warning(_("Error while parsing %s: %s"), filename, strerror(errno));
-		}
-		ret_zero = TRUE;
-	}
+	return (RawLevel *) curr->data;
+}
 
-	/* Assign defaults if necessary */
-	if(ret_zero) {
-		free_rawlevel(ret);
-		ret = 0;
-	} else {
-		if(ret->difficulty == -1) {
-			if(default_difficulty == -1) {
-				ret->difficulty = DEFAULT_DIFFICULTY;
-			} else {
-				ret->difficulty = default_difficulty;
-			}
-		}
-		if(!ret->name) {
-			if(!default_name) {
-				ret->name = g_strdup(DEFAULT_NAME);
-			} else {
-				ret->name = g_strdup(default_name);
-			}
-		}
-		if(!ret->author) {
-			if(!default_author) {
-				ret->author = g_strdup(DEFAULT_AUTHOR);
-			} else {
-				ret->author = g_strdup(default_author);
-			}
-		}
-	}		
+/* Returns a copy of a rawlevel that stays valid however the levelfiles
+ * change, for use outside the main thread. Free it with free_rawlevel */
+RawLevel *leveldata_get_copy(gint level_num) {
+	return copy_rawlevel(leveldata_get(level_num));
+}
+
+/* Builds a GList of the titles that we have, and returns it. The list is
+ * freeable, but the strings are not */
+GList *leveldata_titlelist(void) {
+	GList *ret = NULL;
+	GList *curr;
+	
+	for(curr = levelfiles; curr; curr = g_list_next(curr)) {
+		ret = g_list_prepend(ret, ((LevelFile *) curr->data)->title);
+	}
 
 	return ret;
 }
 
-/* Reads the leveldata section of a level in a levelfile until it hits the
- * END_DATA tag. Returns blocks on success, NULL otherwise */
-static gchar *read_levelblocks(FILE *fp, gchar *filename, gint *lineno) {
-	static gchar ret[BLOCKS_TOTAL];
-	gint r[BLOCKS_X];
-	gchar buffer[1024];
-	gint i, ret_zero = FALSE, end_data = 0, got_records, ii, bad_block;
+/* Spawns a thread to re-parse levelfile */
+static void start_reload(LevelFile *levelfile) {
+	ReloadJob *job;
+	GThread *thread;
 
+	job = g_malloc(sizeof(ReloadJob));
+	job->filename = g_strdup(levelfile->filename);
+	job->levelfile = NULL;
+	job->warnings = NULL;
 
-	for(i = 0; !ret_zero && !end_data && fgets(buffer, 1024, fp); i += BLOCKS_X) {
-		(*lineno)++;
-		crop_by_whitespace(buffer);
-		if(!*buffer || *buffer == '#') {
-			continue;
-		}
+	levelfile->reloading = TRUE;
+	levelfile->reload_pending = FALSE;
 
-		if(!strcmp(buffer, "END_DATA")) {
-			end_data = 1;
-		} else if(i >= BLOCKS_TOTAL) {
-			gui_warning(_("Too many blocks in line %d of %s"), *lineno, filename);
-			ret_zero = TRUE;
-		} else {
-			/* FIXME: Hardcoded to BLOCKS_X == 10 */
-			got_records = sscanf(buffer, "%d,%d,%d,%d,%d,%d,%d,%d,%d,%d", &r[0], &r[1], &r[2], &r[3], &r[4], &r[5], &r[6], &r[7], &r[8], &r[9]);
-
-			if(!got_records) {
-				gui_warning(_("Syntax error reading level data in line %d of %s"), *lineno, filename);
-				ret_zero = TRUE;
-			} else if(got_records != BLOCKS_X) {
-				gui_warning(_("Expected %d values, got %s at line %d of %s"), got_records, BLOCKS_X, *lineno, filename);
-				ret_zero = TRUE;
-			} else if((bad_block = verify_raw_data(r, 10, MAX_BLOCK_CODE))) {
-				gui_warning(_("Block %d (%d) of line %d of %s is higher than %d"), bad_block, (int) r[bad_block - 1], *lineno, filename, MAX_BLOCK_CODE);
-				ret_zero = TRUE;
-			} else {
-				for(ii = 0; ii < BLOCKS_X; ii++) {
-					ret[i + ii] = (gchar) r[ii];
-				}
-			}
-		}
-	}
+	thread = g_thread_new("levelfile-reload", reload_thread, job);
+	g_thread_unref(thread);
+}
 
-	if(!ret_zero && !end_data && (feof(fp) || ferror(fp))) {
-		if(feof(fp)) {
-			gui_warning(_("Unexpected EOF while reading level data in file %s"), filename);
-		} else {
-			gui_warning(_("Error while reading %s: %s"), filename, strerror(errno));
-		}
+/* Body of the reload thread. Only touches the job, so it doesn't need to lock
+ * anything; the result is handed back to the main loop with an idle
+ * callback */
+static gpointer reload_thread(gpointer data) {
+	ReloadJob *job = (ReloadJob *) data;
 
-		ret_zero = TRUE;
-	}
+	job->levelfile = load_levelfile(job->filename, &(job->warnings));
 
-	if(!ret_zero) {
-		g_assert(end_data);
-	}
+	g_idle_add(reload_finish, job);
 
-	if(i < BLOCKS_TOTAL) {
-		gui_warning(_("Not enough blocks in level data at line %d of %s"), *lineno, filename);
-		ret_zero = TRUE;
-	}
-
-	if(ret_zero) {
-		return 0;
-	} else {
-		return ret;
-	}
+	return NULL;
 }
 
-/* Takes an input line and seperates the supplied tag from the value following
- * it. Does checking for valid characters. On success, returns the string,
- * else NULL */
-static gchar *sep_string(gchar *line, gchar *tag, gchar *filename, gint lineno) {
-	gchar *buffer, *value;
+/* Runs in the main loop once a reload thread has finished. Splices the new
+ * levels in, or keeps them for leveldata_hold to splice in once the game
+ * stops. On a parse error, shows the errors and keeps the old levels */
+static gboolean reload_finish(gpointer data) {
+	ReloadJob *job = (ReloadJob *) data;
+	LevelFile *levelfile;
 
-	/* So we can mess with the line without damaging the original contents
-	 */
-	buffer = g_strdup(line);
+	levelfile = find_levelfile(job->filename, NULL);
 
-	value = sep_by_tag(buffer, tag, filename, lineno);
-	if(value) {
-		if(check_valid_chars(value, VALID_STRING, filename, lineno)) {
-			value = g_strdup(value);
+	if(levelfile) {
+		if(job->levelfile && held) {
+			/* Only the latest reload is worth keeping */
+			if(levelfile->deferred)
+				free_levelfile(levelfile->deferred);
+			levelfile->deferred = job->levelfile;
+		} else if(job->levelfile) {
+			splice_levelfile(levelfile, job->levelfile);
 		} else {
-			value = FALSE;
+			show_warnings(job->warnings);
+			job->warnings = NULL;
+			gui_warning(_("Keeping the previously loaded levels of %s"), job->filename);
 		}
-	} else {
-		value = FALSE;
-	}
 
-	g_free(buffer);
+		levelfile->reloading = FALSE;
+		if(levelfile->reload_pending)
+			start_reload(levelfile);
+	} else if(job->levelfile) {
+		/* The levelfile was removed while we were parsing it */
+		free_levelfile(job->levelfile);
+	}
 
-	return value;
+	levelparse_free_warnings(job->warnings);
+	g_free(job->filename);
+	g_free(job);
 
+	return FALSE;
 }
 
-/* Seperates a value from the supplied tag, showing an error if no value is
- * given. Returns the value on success, NULL on failure. Also crops 
- * surrounding whitespace from the value*/
-static gchar *sep_by_tag(gchar *line, gchar *tag, gchar *filename, gint lineno) {
-	gint tag_len;
-	gchar *ret;
-
-	tag_len = strlen(tag);
+/* Replaces the levels of old with those of new, which is a freshly parsed
+ * copy of the same file. Levels that haven't changed keep their RawLevel and
+ * their place in the levels list; the rest are removed from or inserted into
+ * the sorted list individually. If the title changed, the GUI is told so
+ * that it can update the titles it shows. new is freed. */
+static void splice_levelfile(LevelFile *old, LevelFile *new) {
+	GList *currn, *curro, *kept = NULL;
+	RawLevel *newlevel, *oldlevel;
 
-	ret = line + tag_len;
+	generation++;
 
-	crop_by_whitespace(ret);
+	for(currn = new->levels; currn; currn = g_list_next(currn)) {
+		newlevel = (RawLevel *) currn->data;
 
-	if(!*ret) {
-		gui_warning(_("Line %d of %s contains the tag '%s' without a value"), lineno, filename, tag);
-		return FALSE;
-	} else {
-		return ret;
-	}
-}
-
-/* Checks the validity of a string against a set of allowed characters,
- * showing an error if the check fails. Returns non-NULL if the test passes. */
-static gboolean check_valid_chars(gchar *string, gchar *valid, gchar *filename, gint lineno) {
-	if(strspn(string, valid) != strlen(string)) {
-		gui_warning(_("Line %d of %s contains the value '%s', which contains illegal characters. Legal characters are: '%s'"), lineno, filename, string, valid);
-		return FALSE;
-	} else {
-		return TRUE;
-	}
-}
+		for(curro = old->levels; curro; curro = g_list_next(curro)) {
+			if(rawlevel_equal((RawLevel *) curro->data, newlevel))
+				break;
+		}
 
-/* Takes an input line and seperates the supplied tag from the value following
- * it. Does checking for valid characters. Unlike sep_string, the value in
- * this case must be an unsigned integer. Returns the integer on success, -1
- * otherwise */
-static gint sep_uint(gchar *line, gchar *tag, gchar *filename, gint lineno) {
-	gchar *buffer, *value;
-	gint ret;
-
-	/* So we can mess with the line without damaging the original contents
-	 */
-	buffer = g_strdup(line);
-
-	value = sep_by_tag(buffer, tag, filename, lineno);
-	if(value) {
-		if(check_valid_chars(value, VALID_INT, filename, lineno)) {
-			ret = atoi(value);
+		if(curro) {
+			/* Unchanged: keep the level we already have */
+			oldlevel = (RawLevel *) curro->data;
+			old->levels = g_list_delete_link(old->levels, curro);
+			kept = g_list_prepend(kept, oldlevel);
+			free_rawlevel(newlevel);
 		} else {
-			ret = -1;
+			add_level_to_levels_list(newlevel);
+			num_levels++;
+			kept = g_list_prepend(kept, newlevel);
 		}
-	} else {
-		ret = -1;
 	}
 
-	g_free(buffer);
-
-	return ret;
-}
-
-/* Crops the leading and ending whitespace of a string. Modifies the original
- * string rather than allocating a new one.
- *
- * This isn't obfuscated, just efficient ;) */
-static void crop_by_whitespace(gchar *string) {
-	gchar *a, *b;
-
-	for(b = string; *b; b++);
-	for(; b > string && strchr(VALID_WHITESPACE, *(b - 1)); b--);
-	*b = '\0';	
-
-	/* Move the beginning */
-	for(b = string; *b && strchr(VALID_WHITESPACE, *b); b++);
-	for(a = string; *b; *a++ = *b++);
-	*a = '\0';
-}
-
-/* Attempts to find a levelfile matching filename and/or title in the 
- * internal levelfile list. Returns the levelfile on success, NULL otherwise */
-static LevelFile *find_levelfile(gchar *filename, gchar *title) {
-	GList *curr;
-	LevelFile *currlf = NULL;
-	LevelFile *ret = NULL;
-
-	for(curr = levelfiles; curr && !ret; curr = g_list_next(curr)) {
-		currlf = (LevelFile *) curr->data;
-		if((!filename || !strcmp(currlf->filename, filename)) && (!title || !strcmp(currlf->title, title))) {
-			ret = currlf;
-		}
+	/* Whatever is left in old has been changed or deleted */
+	for(curro = old->levels; curro; curro = g_list_next(curro)) {
+		oldlevel = (RawLevel *) curro->data;
+		levels = g_list_remove(levels, oldlevel);
+		num_levels--;
+		free_rawlevel(oldlevel);
 	}
+	g_list_free(old->levels);
+	old->levels = g_list_reverse(kept);
 
-	return ret;
-}
-
-/* Checks that numbers starting from data to n are below or equal to max, 
- * returning n+1 if the test fails, zero otherwise */
-static gint verify_raw_data(gint *data, size_t n, gint max) {
-	int i;
-
-	for(i = 0; i < n; i++) {
-		if(data[i] > max) 
-			return i + 1;
+	if(strcmp(old->title, new->title)) {
+		g_free(old->title);
+		old->title = new->title;
+		new->title = NULL;
+		gui_levelfiles_changed();
 	}
 
-	return 0;
-}
-
-/* Returns a rawlevel */
-RawLevel *leveldata_get(gint level_num) {
-	GList *curr;
-	gint i;
-	g_assert(level_num < num_levels);
-
-	for(i = 0, curr = levels; i < level_num && curr; i++, curr = g_list_next(curr));
-	g_assert(curr);
-
-	return (RawLevel *) curr->data;
+	g_list_free(new->levels);
+	new->levels = NULL;
+	free_levelfile(new);
 }
 
-/* Builds a GList of the titles that we have, and returns it. The list is
- * freeable, but the strings are not */
-GList *leveldata_titlelist(void) {
-	GList *ret = NULL;
-	GList *curr;
-	
-	for(curr = levelfiles; curr; curr = g_list_next(curr)) {
-		ret = g_list_prepend(ret, ((LevelFile *) curr->data)->title);
-	}
-
-	return ret;
+/* Compares the contents of two rawlevels */
+static gboolean rawlevel_equal(RawLevel *a, RawLevel *b) {
+	return a->difficulty == b->difficulty
+		&& a->width == b->width
+		&& a->height == b->height
+		&& !strcmp(a->name, b->name)
+		&& !strcmp(a->author, b->author)
+		&& !strcmp(a->levelfile_title, b->levelfile_title)
+		&& !memcmp(a->blocks, b->blocks, sizeof(gchar) * a->width * a->height);
 }
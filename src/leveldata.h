@@ -18,6 +18,10 @@
 
 gchar *leveldata_add(char *filename);
 gchar *leveldata_remove(char *title);
+void leveldata_reload(gchar *filename);
+void leveldata_hold(gboolean hold);
 RawLevel *leveldata_get(gint level_num);
+RawLevel *leveldata_get_copy(gint level_num);
 GList *leveldata_titlelist(void);
 gint leveldata_num_levels(void);
+gint leveldata_generation(void);
@@ -0,0 +1,289 @@
+/*
+ * Generates levels for endless play. A level depends only on the seed and its
+ * index, so any level of an endless game can be regenerated later, on any
+ * machine.
+ *
+ * levelgen_generate makes a single level. A LevelGen keeps a worker thread
+ * running a few levels ahead of the highest one asked for, so that levelgen_get
+ * normally returns straight away.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "leveldata.h"
+#include "levelparse.h"
+#include "levelgen.h"
+#include "rng.h"
+#include "trace.h"
+#include <math.h>
+#include <string.h>
+
+/* How many levels the worker generates ahead of the last one asked for */
+#define LEVELS_AHEAD 4
+
+/* How quickly the levels get harder. The difficulty curve approaches its
+ * maximum as the level index grows past a few multiples of this */
+#define DIFFICULTY_SCALE 12.0
+
+/* Internal Data Structures */
+struct _LevelGen {
+	guint32 seed;
+	GThread *thread;
+	GMutex lock;
+	GCond cond; /* Signalled when either of the following change */
+	gint wanted; /* The highest level index that has been asked for */
+	gint next; /* The index that the worker will generate next */
+	GHashTable *ready; /* index -> RawLevel, waiting for levelgen_get */
+	gboolean quit;
+};
+
+typedef struct _LevelGen LevelGen;
+
+/* Internal Functions */
+static gpointer levelgen_thread(gpointer data);
+static gchar pick_block(Rng *rng, gdouble curve);
+static void remove_unreachable(RawLevel *level);
+
+/* Makes level number index of the endless game with the given seed. Safe to
+ * call from any thread */
+RawLevel *levelgen_generate(guint32 seed, gint index) {
+	RawLevel *level;
+	Rng rng;
+	gdouble curve, gap;
+	gint rows, top, x, y, breakable;
+	gchar *name, *title, code;
+
+	/* Each level gets its own stream, so that the levels don't depend on
+	 * each other */
+	rng_seed(&rng, ((guint64) seed << 32) ^ ((guint64) index * 0x9E3779B97F4A7C15ULL));
+
+	/* 0 for the first level, approaching 1 as the levels go on */
+	curve = 1.0 - exp(-index / DIFFICULTY_SCALE);
+
+	name = g_strdup_printf(_("Endless %d"), index + 1);
+	title = g_strdup_printf(_("Endless game %u"), seed);
+	level = new_rawlevel(BLOCKS_X, BLOCKS_Y, 1 + (gint) (curve * 9), name,
+			_("Generated"), title);
+	g_free(name);
+	g_free(title);
+	level->blocks = g_malloc0(sizeof(gchar) * level->width * level->height);
+
+	/* More rows, and fewer gaps, as the levels go on. There are always a
+	 * few empty rows at the bottom for the ball to get going in */
+	rows = 4 + (gint) (curve * (level->height - 8)) + rng_range(&rng, 2);
+	top = rng_range(&rng, 2);
+	gap = 0.35 - curve * 0.2;
+
+	/* Levels are mirrored left to right, which looks more like something a
+	 * person would make */
+	breakable = 0;
+	for(y = top; y < top + rows; y++) {
+		for(x = 0; x < (level->width + 1) / 2; x++) {
+			if(rng_double(&rng) < gap)
+				code = BLOCK_NONE_CODE;
+			else
+				code = pick_block(&rng, curve);
+			level->blocks[y * level->width + x] = code;
+			level->blocks[y * level->width + level->width - 1 - x] = code;
+		}
+	}
+
+	remove_unreachable(level);
+
+	for(x = 0; x < level->width * level->height; x++) {
+		if(level->blocks[x] != BLOCK_NONE_CODE
+				&& level->blocks[x] != BLOCK_INVINCIBLE_CODE)
+			breakable++;
+	}
+	/* A level with nothing to break would end as soon as it started */
+	if(!breakable) {
+		y = top * level->width;
+		level->blocks[y + level->width / 2] = BLOCK_DEFAULT_CODE;
+		level->blocks[y + (level->width - 1) / 2] = BLOCK_DEFAULT_CODE;
+	}
+
+	return level;
+}
+
+/* Starts a worker generating the levels for seed */
+LevelGen *new_levelgen(guint32 seed) {
+	LevelGen *gen;
+
+	gen = g_malloc(sizeof(LevelGen));
+	gen->seed = seed;
+	g_mutex_init(&gen->lock);
+	g_cond_init(&gen->cond);
+	gen->wanted = 0;
+	gen->next = 0;
+	gen->ready = g_hash_table_new(g_direct_hash, g_direct_equal);
+	gen->quit = FALSE;
+	gen->thread = g_thread_new("levelgen", levelgen_thread, gen);
+
+	return gen;
+}
+
+/* Returns level number index, which should be freed with free_rawlevel. Waits
+ * for the worker if it hasn't got there yet. Levels are normally asked for in
+ * order; asking for one that has already been handed out, or that the worker
+ * dropped because a later one was asked for, regenerates it */
+RawLevel *levelgen_get(LevelGen *gen, gint index) {
+	RawLevel *level;
+
+	g_mutex_lock(&gen->lock);
+	if(index > gen->wanted) {
+		gen->wanted = index;
+		g_cond_broadcast(&gen->cond);
+	}
+
+	/* The worker can get to index while this waits, and then drop it if
+	 * another thread has asked for a later level, so this is checked
+	 * again after every wait */
+	while(!(level = g_hash_table_lookup(gen->ready,
+					GINT_TO_POINTER(index)))) {
+		if(index < gen->next) {
+			g_mutex_unlock(&gen->lock);
+			return levelgen_generate(gen->seed, index);
+		}
+		g_cond_wait(&gen->cond, &gen->lock);
+	}
+	g_hash_table_remove(gen->ready, GINT_TO_POINTER(index));
+	g_mutex_unlock(&gen->lock);
+
+	return level;
+}
+
+/* Stops the worker, and frees everything it generated */
+void destroy_levelgen(LevelGen *gen) {
+	GHashTableIter iter;
+	gpointer level;
+
+	g_mutex_lock(&gen->lock);
+	gen->quit = TRUE;
+	g_cond_broadcast(&gen->cond);
+	g_mutex_unlock(&gen->lock);
+	g_thread_join(gen->thread);
+
+	g_hash_table_iter_init(&iter, gen->ready);
+	while(g_hash_table_iter_next(&iter, NULL, &level))
+		free_rawlevel((RawLevel *) level);
+	g_hash_table_destroy(gen->ready);
+	g_mutex_clear(&gen->lock);
+	g_cond_clear(&gen->cond);
+	g_free(gen);
+}
+
+/* Body of the worker. Generates levels up to LEVELS_AHEAD past the highest one
+ * asked for, then sleeps until more are asked for. Levels that are skipped
+ * over are dropped, so that the ready table doesn't grow forever */
+static gpointer levelgen_thread(gpointer data) {
+	LevelGen *gen = (LevelGen *) data;
+	GHashTableIter iter;
+	gpointer key, old;
+	RawLevel *level;
+	gint index;
+
+	trace_name_thread("levelgen");
+	g_mutex_lock(&gen->lock);
+	while(!gen->quit) {
+		if(gen->next > gen->wanted + LEVELS_AHEAD) {
+			g_cond_wait(&gen->cond, &gen->lock);
+			continue;
+		}
+
+		index = gen->next;
+		g_mutex_unlock(&gen->lock);
+		TRACE_BEGIN("levelgen_generate");
+		level = levelgen_generate(gen->seed, index);
+		TRACE_END("levelgen_generate");
+		g_mutex_lock(&gen->lock);
+
+		g_hash_table_insert(gen->ready, GINT_TO_POINTER(index), level);
+		gen->next++;
+
+		g_hash_table_iter_init(&iter, gen->ready);
+		while(g_hash_table_iter_next(&iter, &key, &old)) {
+			if(GPOINTER_TO_INT(key) < gen->wanted) {
+				free_rawlevel((RawLevel *) old);
+				g_hash_table_iter_remove(&iter);
+			}
+		}
+		g_cond_broadcast(&gen->cond);
+	}
+	g_mutex_unlock(&gen->lock);
+
+	return NULL;
+}
+
+/* Picks a block type. Strong and invincible blocks get more common as curve
+ * goes from 0 to 1 */
+static gchar pick_block(Rng *rng, gdouble curve) {
+	gdouble r;
+
+	r = rng_double(rng);
+	if(r < 0.08)
+		return BLOCK_EXPLODE_CODE;
+	r -= 0.08;
+	if(r < 0.10 * curve)
+		return BLOCK_INVINCIBLE_CODE;
+	r -= 0.10 * curve;
+	if(r < 0.05 + 0.15 * curve)
+		return BLOCK_STRONG_3_CODE;
+	r -= 0.05 + 0.15 * curve;
+	if(r < 0.10 + 0.10 * curve)
+		return BLOCK_STRONG_2_CODE;
+	r -= 0.10 + 0.10 * curve;
+	if(r < 0.15)
+		return BLOCK_STRONG_1_CODE;
+	return BLOCK_DEFAULT_CODE;
+}
+
+/* Makes sure every breakable block can be reached by the ball. Anything
+ * walled in by invincible blocks is removed, as the level could never be
+ * finished otherwise */
+static void remove_unreachable(RawLevel *level) {
+	gint *stack, top = 0, i, x, y, total;
+	gboolean *reached;
+
+	total = level->width * level->height;
+	stack = g_malloc(sizeof(gint) * total);
+	reached = g_malloc0(sizeof(gboolean) * total);
+
+	/* The ball comes from the bottom row, which is always empty */
+	for(x = 0; x < level->width; x++) {
+		i = (level->height - 1) * level->width + x;
+		reached[i] = TRUE;
+		stack[top++] = i;
+	}
+
+	while(top) {
+		i = stack[--top];
+		x = i % level->width;
+		y = i / level->width;
+#define VISIT(n) \
+		if(!reached[n] && level->blocks[n] != BLOCK_INVINCIBLE_CODE) { \
+			reached[n] = TRUE; \
+			stack[top++] = n; \
+		}
+		if(x > 0)
+			VISIT(i - 1);
+		if(x < level->width - 1)
+			VISIT(i + 1);
+		if(y > 0)
+			VISIT(i - level->width);
+		if(y < level->height - 1)
+			VISIT(i + level->width);
+#undef VISIT
+	}
+
+	for(i = 0; i < total; i++) {
+		if(!reached[i] && level->blocks[i] != BLOCK_INVINCIBLE_CODE)
+			level->blocks[i] = BLOCK_NONE_CODE;
+	}
+
+	g_free(stack);
+	g_free(reached);
+}
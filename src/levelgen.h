@@ -0,0 +1,13 @@
+/*
+ * Generates levels for endless play
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+RawLevel *levelgen_generate(guint32 seed, gint index);
+struct _LevelGen *new_levelgen(guint32 seed);
+RawLevel *levelgen_get(struct _LevelGen *gen, gint index);
+void destroy_levelgen(struct _LevelGen *gen);
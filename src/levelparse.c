@@ -0,0 +1,551 @@
+/*
+ * The levelfile parser. This has no dependencies on the rest of the game, so
+ * that it can be shared by leveldata.c and the command line tools.
+ *
+ * Copyright (c) 2000 Michael Pearson <alcaron@senet.com.au>
+ *
+ * This file is license under the GNU General Public License. See the file
+ * "COPYING" for more details
+ */
+
+#include "breakout.h"
+#include "leveldata.h"
+#include "levelparse.h"
+#include "memstats.h"
+#include <errno.h>
+#include <string.h>
+
+/* Internal Contants */
+#define DEFAULT_NAME "No Name"
+#define DEFAULT_AUTHOR "No Author"
+#define DEFAULT_DIFFICULTY 0
+#define VALID_STRING "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz[];',./!@#$^&*()-=_+`~1234567890 "
+#define VALID_INT "1234567890"
+#define VALID_WHITESPACE " \n\t"
+#define DATA_LINE_LENGTH (MAX_BLOCKS_X * 8)
+
+/* Internal Functions */
+static gboolean read_levelfile(FILE *fp, gchar *filename, gchar **title, GList **levels);
+static RawLevel *read_level(FILE *fp, gchar *default_name, gchar *default_author, gint default_difficulty, gchar *filename, gint *lineno);
+static gboolean read_levelblocks(FILE *fp, gchar *blocks, gint width, gint height, gchar *filename, gint *lineno);
+static gchar *sep_string(gchar *line, gchar *tag, gchar *filename, gint lineno);
+static gint sep_uint(gchar *line, gchar *tag, gchar *filename, gint lineno);
+static void crop_by_whitespace(gchar *string);
+static gchar *sep_by_tag(gchar *line, gchar *tag, gchar *filename, gint lineno);
+static gboolean check_valid_chars(gchar *string, gchar *valid, gchar *filename, gint lineno);
+static void parse_warning(gchar *format, ...);
+
+/* Internal Variables */
+
+/* Where parse_warning puts its messages. Per thread, so that several files
+ * can be parsed at once */
+static GPrivate parse_warnings = G_PRIVATE_INIT(NULL);
+
+/* Functions */
+
+/* Parses a levelfile. On success returns TRUE, and sets title and levels,
+ * which is a list of RawLevels. Otherwise returns FALSE. Either way, any
+ * problems found are appended to warnings as freshly allocated strings. Safe
+ * to call from several threads at once */
+gboolean levelparse_load(gchar *filename, gchar **title, GList **levels, GList **warnings) {
+	FILE *fp;
+	gboolean ret;
+
+	g_private_set(&parse_warnings, warnings);
+
+	*title = NULL;
+	*levels = NULL;
+	fp = fopen(filename, "r");
+
+	if(!fp) {
+		parse_warning(_("Cannot open levelfile %s, discarding: %s"), filename, strerror(errno));
+		ret = FALSE;
+	} else {
+		ret = read_levelfile(fp, filename, title, levels);
+		fclose(fp);
+	}
+
+	g_private_set(&parse_warnings, NULL);
+	return ret;
+}
+
+/* Frees the list of messages filled in by levelparse_load */
+void levelparse_free_warnings(GList *warnings) {
+	GList *curr;
+
+	for(curr = warnings; curr; curr = g_list_next(curr)) {
+		g_free(curr->data);
+	}
+	g_list_free(warnings);
+}
+
+/* Deallocates a rawlevel structure */
+void free_rawlevel(RawLevel *level) {
+	memstats_remove(MEM_RAWLEVEL, sizeof(RawLevel));
+	memstats_remove_string(MEM_RAWLEVEL_STRING, level->name);
+	memstats_remove_string(MEM_RAWLEVEL_STRING, level->author);
+	memstats_remove_string(MEM_RAWLEVEL_STRING, level->levelfile_title);
+	if(level->name)
+		g_free(level->name);
+	if(level->author)
+		g_free(level->author);
+	if(level->levelfile_title)
+		g_free(level->levelfile_title);
+	if(level->blocks)
+		g_free(level->blocks);
+
+	g_free(level);
+}
+
+/* Generates a new rawlevel structure. Duplicates and assigns fields if they
+ * are provided. The blocks are left unallocated, as the size of a level can
+ * change until its data is read */
+RawLevel *new_rawlevel(gint width, gint height, gint difficulty, gchar *name, gchar *author, gchar *levelfile_title) {
+	RawLevel *new;
+
+	new = g_malloc(sizeof(RawLevel));
+	memset(new, 0, sizeof(RawLevel));
+	memstats_add(MEM_RAWLEVEL, sizeof(RawLevel));
+
+	new->width = width;
+	new->height = height;
+	if(difficulty)
+		new->difficulty = difficulty;
+	if(name)
+		new->name = g_strdup(name);
+	if(author)
+		new->author = g_strdup(author);
+	if(levelfile_title)
+		new->levelfile_title = g_strdup(levelfile_title);
+	memstats_add_string(MEM_RAWLEVEL_STRING, new->name);
+	memstats_add_string(MEM_RAWLEVEL_STRING, new->author);
+	memstats_add_string(MEM_RAWLEVEL_STRING, new->levelfile_title);
+
+	return new;
+}
+
+/* Returns a copy of level */
+RawLevel *copy_rawlevel(RawLevel *level) {
+	RawLevel *ret;
+
+	ret = new_rawlevel(level->width, level->height, level->difficulty,
+			level->name, level->author, level->levelfile_title);
+	ret->blocks = g_memdup(level->blocks,
+			sizeof(gchar) * level->width * level->height);
+
+	return ret;
+}
+
+/* Reads an already opened levelfile into title and levels. Returns FALSE on an
+ * error */
+static gboolean read_levelfile(FILE *fp, gchar *filename, gchar **title, GList **levels) {
+	GList *curr;
+	gint lineno = 0 , ret_zero = FALSE;
+	RawLevel *level;
+	gchar buffer[1024];
+	gchar *default_author = NULL;
+	gchar *default_name = NULL;
+	gint default_difficulty = -1;
+
+	while(!ret_zero && fgets(buffer, 1024, fp)) {
+		lineno++;
+		crop_by_whitespace(buffer);
+		if(!*buffer || *buffer == '#') {
+			continue;
+		}
+		ret_zero = FALSE;
+
+		if(!strncmp(buffer, "GLOBAL_AUTHOR", strlen("GLOBAL_AUTHOR"))) {
+			g_free(default_author);
+			default_author = sep_string(buffer, "GLOBAL_AUTHOR", filename, lineno);
+			if(!default_author) {
+				ret_zero = TRUE;
+			}
+		} else if (!strncmp(buffer, "GLOBAL_NAME", strlen("GLOBAL_NAME"))) {
+			g_free(default_name);
+			default_name = sep_string(buffer, "GLOBAL_NAME", filename, lineno);
+			if(!default_name) {
+				ret_zero = TRUE;
+			}
+		} else if (!strncmp(buffer, "GLOBAL_DIFFICULTY", strlen("GLOBAL_DIFFICULTY"))) {
+			default_difficulty = sep_uint(buffer, "GLOBAL_DIFFICULTY", filename, lineno);
+			if(default_difficulty == -1) {
+				ret_zero = TRUE;
+			}
+		} else if (!strcmp(buffer, "BEGIN_LEVEL")) {
+			level = read_level(fp, default_name, default_author, default_difficulty, filename, &lineno);
+			if(level) {
+				*levels = g_list_prepend(*levels, level);
+			} else {
+				ret_zero = TRUE;
+			}
+		} else if (!strncmp(buffer, "TITLE ", strlen("TITLE "))) {
+			if(*title) {
+				g_free(*title);
+			}
+
+			*title = sep_string(buffer, "TITLE", filename, lineno);
+			if(!*title) {
+				ret_zero = TRUE;
+			}
+		} else {
+			parse_warning(_("Unrecognized or incorrectly positioned directive '%s' on line %d of %s"), buffer, lineno, filename);
+			ret_zero = TRUE;
+		}
+	}
+
+	/* Check any weird IO errors */
+	if(!ret_zero && !feof(fp)) {
+		parse_warning(_("Error while parsing %s: %s"), filename, strerror(errno));
+		ret_zero = TRUE;
+	}
+
+	if(!ret_zero) {
+		/* Syntax tests passed */
+
+		/* Check that we have a title */
+		if(!ret_zero && !*title)
+			*title = g_strdup(filename);
+
+		/* Set the "title" entry in each rawlevel */
+		for(curr = *levels; curr; curr = g_list_next(curr)) {
+			level = (RawLevel *) curr->data;
+			level->levelfile_title = g_strdup(*title);
+			memstats_add_string(MEM_RAWLEVEL_STRING,
+					level->levelfile_title);
+		}
+	} else {
+		/* Syntax tests failed */
+
+		/* Free the junk */
+		for(curr = *levels; curr; curr = g_list_next(curr)) {
+			free_rawlevel((RawLevel *) curr->data);
+		}
+		g_list_free(*levels);
+		*levels = NULL;
+		if(*title) {
+			g_free(*title);
+			*title = NULL;
+		}
+	}
+
+		
+	/* Cleanup our defaults*/
+	if(default_name) {
+		g_free(default_name);
+	}
+	if(default_author) {
+		g_free(default_author);
+	}
+
+	return !ret_zero;
+}
+
+/* Reads a level section of a levelfile, until it hits an "END_LEVEL". Returns
+ * the RawLevel on success, NULL otherwise */
+static RawLevel *read_level(FILE *fp, gchar *default_name, gchar *default_author, gint default_difficulty, gchar *filename, gint *lineno) {
+	RawLevel *ret;
+	char buffer[1024];
+	gint ret_zero = FALSE, end_level = 0;
+
+	ret = new_rawlevel(BLOCKS_X, BLOCKS_Y, -1, NULL, NULL, NULL);
+	while(!ret_zero && !end_level && fgets(buffer, 1024, fp)) {
+		ret_zero = FALSE;
+		crop_by_whitespace(buffer);
+		(*lineno)++;
+		if(!*buffer || *buffer == '#') {
+			continue;
+		}
+
+		if(!strcmp(buffer, "END_LEVEL")) {
+			end_level = 1;
+		} else if (!strcmp(buffer, "BEGIN_DATA") && !ret->blocks) {
+			ret->blocks = g_malloc(sizeof(gchar) * ret->width * ret->height);
+			if(!read_levelblocks(fp, ret->blocks, ret->width, ret->height, filename, lineno)) {
+				ret_zero = TRUE;
+			}
+		} else if(!strncmp(buffer, "WIDTH", strlen("WIDTH")) && !ret->blocks) {
+			ret->width = sep_uint(buffer, "WIDTH", filename, *lineno);
+			if(ret->width == -1) {
+				ret_zero = TRUE;
+			} else if(ret->width < MIN_BLOCKS_X || ret->width > MAX_BLOCKS_X) {
+				parse_warning(_("WIDTH on line %d of %s must be between %d and %d"), *lineno, filename, MIN_BLOCKS_X, MAX_BLOCKS_X);
+				ret_zero = TRUE;
+			}
+		} else if(!strncmp(buffer, "HEIGHT", strlen("HEIGHT")) && !ret->blocks) {
+			ret->height = sep_uint(buffer, "HEIGHT", filename, *lineno);
+			if(ret->height == -1) {
+				ret_zero = TRUE;
+			} else if(ret->height < MIN_BLOCKS_Y || ret->height > MAX_BLOCKS_Y) {
+				parse_warning(_("HEIGHT on line %d of %s must be between %d and %d"), *lineno, filename, MIN_BLOCKS_Y, MAX_BLOCKS_Y);
+				ret_zero = TRUE;
+			}
+		} else if(!strncmp(buffer, "AUTHOR", strlen("AUTHOR"))) {
+			memstats_remove_string(MEM_RAWLEVEL_STRING,
+					ret->author);
+			g_free(ret->author);
+			ret->author = sep_string(buffer, "AUTHOR", filename, *lineno);
+			memstats_add_string(MEM_RAWLEVEL_STRING, ret->author);
+			if(!ret->author) {
+				ret_zero = TRUE;
+			}
+		} else if(!strncmp(buffer, "NAME", strlen("NAME"))) {
+			memstats_remove_string(MEM_RAWLEVEL_STRING, ret->name);
+			g_free(ret->name);
+			ret->name = sep_string(buffer, "NAME", filename, *lineno);
+			memstats_add_string(MEM_RAWLEVEL_STRING, ret->name);
+			if(!ret->name) {
+				ret_zero = TRUE;
+			}
+		} else if(!strncmp(buffer, "DIFFICULTY", strlen("DIFFICULTY"))) {
+			ret->difficulty = sep_uint(buffer, "DIFFICULTY", filename, *lineno);
+			if(ret->difficulty == -1) {
+				ret_zero = TRUE;
+			}
+		} else {
+			parse_warning(_("Unrecognized or incorrectly positioned directive '%s' on line %d of %s"), buffer, *lineno, filename);
+			ret_zero = TRUE;
+		}
+	}
+
+	if(!ret_zero && !end_level) {
+		if(feof(fp)) {
+			parse_warning(_("Unexpected EOF while parsing level in %s"), filename);
+		} else {
+			parse_warning(_("Error while parsing %s: %s"), filename, strerror(errno));
+		}
+		ret_zero = TRUE;
+	}
+
+	/* Assign defaults if necessary */
+	if(ret_zero) {
+		free_rawlevel(ret);
+		ret = 0;
+	} else {
+		if(!ret->blocks) {
+			ret->blocks = g_malloc0(sizeof(gchar) * ret->width * ret->height);
+		}
+		if(ret->difficulty == -1) {
+			if(default_difficulty == -1) {
+				ret->difficulty = DEFAULT_DIFFICULTY;
+			} else {
+				ret->difficulty = default_difficulty;
+			}
+		}
+		if(!ret->name) {
+			if(!default_name) {
+				ret->name = g_strdup(DEFAULT_NAME);
+			} else {
+				ret->name = g_strdup(default_name);
+			}
+			memstats_add_string(MEM_RAWLEVEL_STRING, ret->name);
+		}
+		if(!ret->author) {
+			if(!default_author) {
+				ret->author = g_strdup(DEFAULT_AUTHOR);
+			} else {
+				ret->author = g_strdup(default_author);
+			}
+			memstats_add_string(MEM_RAWLEVEL_STRING, ret->author);
+		}
+	}		
+
+	return ret;
+}
+
+/* Reads the leveldata section of a level in a levelfile until it hits the
+ * END_DATA tag, into the width * height sized array ret. Each line is one
+ * row of width comma seperated block codes. Returns TRUE on success, FALSE
+ * otherwise */
+static gboolean read_levelblocks(FILE *fp, gchar *ret, gint width, gint height, gchar *filename, gint *lineno) {
+	gchar buffer[DATA_LINE_LENGTH];
+	gchar *p, *end;
+	glong code;
+	gint row = 0, ret_zero = FALSE, end_data = 0, got_records;
+
+	while(!ret_zero && !end_data && fgets(buffer, DATA_LINE_LENGTH, fp)) {
+		(*lineno)++;
+		crop_by_whitespace(buffer);
+		if(!*buffer || *buffer == '#') {
+			continue;
+		}
+
+		if(!strcmp(buffer, "END_DATA")) {
+			end_data = 1;
+			continue;
+		} else if(row >= height) {
+			parse_warning(_("Too many blocks in line %d of %s"), *lineno, filename);
+			ret_zero = TRUE;
+			continue;
+		}
+
+		p = buffer;
+		for(got_records = 0; !ret_zero && *p; got_records++) {
+			code = strtol(p, &end, 10);
+			if(end == p) {
+				parse_warning(_("Syntax error reading level data in line %d of %s"), *lineno, filename);
+				ret_zero = TRUE;
+			} else if(code < 0 || code > MAX_BLOCK_CODE) {
+				parse_warning(_("Block %d (%d) of line %d of %s is not between 0 and %d"), got_records + 1, (int) code, *lineno, filename, MAX_BLOCK_CODE);
+				ret_zero = TRUE;
+			} else if(got_records >= width) {
+				parse_warning(_("Expected %d values, got more at line %d of %s"), width, *lineno, filename);
+				ret_zero = TRUE;
+			} else {
+				ret[row * width + got_records] = (gchar) code;
+				for(p = end; *p && strchr(VALID_WHITESPACE, *p); p++);
+				if(*p == ',') {
+					p++;
+				} else if(*p) {
+					parse_warning(_("Syntax error reading level data in line %d of %s"), *lineno, filename);
+					ret_zero = TRUE;
+				}
+			}
+		}
+
+		if(!ret_zero && got_records != width) {
+			parse_warning(_("Expected %d values, got %d at line %d of %s"), width, got_records, *lineno, filename);
+			ret_zero = TRUE;
+		}
+		row++;
+	}
+
+	if(!ret_zero && !end_data && (feof(fp) || ferror(fp))) {
+		if(feof(fp)) {
+			parse_warning(_("Unexpected EOF while reading level data in file %s"), filename);
+		} else {
+			parse_warning(_("Error while reading %s: %s"), filename, strerror(errno));
+		}
+
+		ret_zero = TRUE;
+	}
+
+	if(!ret_zero) {
+		g_assert(end_data);
+	}
+
+	if(!ret_zero && row < height) {
+		parse_warning(_("Not enough blocks in level data at line %d of %s"), *lineno, filename);
+		ret_zero = TRUE;
+	}
+
+	return !ret_zero;
+}
+
+/* Takes an input line and seperates the supplied tag from the value following
+ * it. Does checking for valid characters. On success, returns the string,
+ * else NULL */
+static gchar *sep_string(gchar *line, gchar *tag, gchar *filename, gint lineno) {
+	gchar *buffer, *value;
+
+	/* So we can mess with the line without damaging the original contents
+	 */
+	buffer = g_strdup(line);
+
+	value = sep_by_tag(buffer, tag, filename, lineno);
+	if(value) {
+		if(check_valid_chars(value, VALID_STRING, filename, lineno)) {
+			value = g_strdup(value);
+		} else {
+			value = FALSE;
+		}
+	} else {
+		value = FALSE;
+	}
+
+	g_free(buffer);
+
+	return value;
+
+}
+
+/* Seperates a value from the supplied tag, showing an error if no value is
+ * given. Returns the value on success, NULL on failure. Also crops 
+ * surrounding whitespace from the value*/
+static gchar *sep_by_tag(gchar *line, gchar *tag, gchar *filename, gint lineno) {
+	gint tag_len;
+	gchar *ret;
+
+	tag_len = strlen(tag);
+
+	ret = line + tag_len;
+
+	crop_by_whitespace(ret);
+
+	if(!*ret) {
+		parse_warning(_("Line %d of %s contains the tag '%s' without a value"), lineno, filename, tag);
+		return FALSE;
+	} else {
+		return ret;
+	}
+}
+
+/* Checks the validity of a string against a set of allowed characters,
+ * showing an error if the check fails. Returns non-NULL if the test passes. */
+static gboolean check_valid_chars(gchar *string, gchar *valid, gchar *filename, gint lineno) {
+	if(strspn(string, valid) != strlen(string)) {
+		parse_warning(_("Line %d of %s contains the value '%s', which contains illegal characters. Legal characters are: '%s'"), lineno, filename, string, valid);
+		return FALSE;
+	} else {
+		return TRUE;
+	}
+}
+
+/* Takes an input line and seperates the supplied tag from the value following
+ * it. Does checking for valid characters. Unlike sep_string, the value in
+ * this case must be an unsigned integer. Returns the integer on success, -1
+ * otherwise */
+static gint sep_uint(gchar *line, gchar *tag, gchar *filename, gint lineno) {
+	gchar *buffer, *value;
+	gint ret;
+
+	/* So we can mess with the line without damaging the original contents
+	 */
+	buffer = g_strdup(line);
+
+	value = sep_by_tag(buffer, tag, filename, lineno);
+	if(value) {
+		if(check_valid_chars(value, VALID_INT, filename, lineno)) {
+			ret = atoi(value);
+		} else {
+			ret = -1;
+		}
+	} else {
+		ret = -1;
+	}
+
+	g_free(buffer);
+
+	return ret;
+}
+
+/* Crops the leading and ending whitespace of a string. Modifies the original
+ * string rather than allocating a new one.
+ *
+ * This isn't obfuscated, just efficient ;) */
+static void crop_by_whitespace(gchar *string) {
+	gchar *a, *b;
+
+	for(b = string; *b; b++);
+	for(; b > string && strchr(VALID_WHITESPACE, *(b - 1)); b--);
+	*b = '\0';	
+
+	/* Move the beginning */
+	for(b = string; *b && strchr(VALID_WHITESPACE, *b); b++);
+	for(a = string; *b; *a++ = *b++);
+	*a = '\0';
+}
+
+/* Reports a problem found while parsing a levelfile, by adding it to the
+ * list given to levelparse_load on this thread */
+static void parse_warning(gchar *format, ...) {
+	GList **warnings;
+	va_list ap;
+
+	warnings = (GList **) g_private_get(&parse_warnings);
+	g_assert(warnings);
+
+	va_start(ap, format);
+	*warnings = g_list_append(*warnings, g_strdup_vprintf(format, ap));
+	va_end(ap);
+}
@@ -0,0 +1,14 @@
+/*
+ * The levelfile parser
+ *
+ * Copyright (c) 2000 Michael Pearson <alcaron@senet.com.au>
+ *
+ * This file is license under the GNU General Public License. See the file
+ * "COPYING" for more details
+ */
+
+gboolean levelparse_load(gchar *filename, gchar **title, GList **levels, GList **warnings);
+void levelparse_free_warnings(GList *warnings);
+RawLevel *new_rawlevel(gint width, gint height, gint difficulty, gchar *name, gchar *author, gchar *levelfile_title);
+RawLevel *copy_rawlevel(RawLevel *level);
+void free_rawlevel(RawLevel *level);
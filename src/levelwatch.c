@@ -0,0 +1,212 @@
+/*
+ * Watches the configured levelfiles for changes, so that level authors can
+ * edit them while the game is running. Uses inotify where we have it, and
+ * quietly does nothing where we don't.
+ *
+ * We watch the directory a levelfile lives in rather than the file itself,
+ * because most editors save by writing a new file and renaming it over the
+ * old one, which would silently kill a watch on the old inode.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "leveldata.h"
+#include "levelwatch.h"
+#include "util.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO)
+#define EVENT_BUFFER_SIZE 4096
+
+/* Internal Data Structures */
+typedef struct {
+	gchar *path;
+	gint wd;
+	gint refs; /* Number of watched levelfiles in this directory */
+} WatchDir;
+
+/* Internal Functions */
+static gboolean cb_inotify(GIOChannel *source, GIOCondition condition, gpointer data);
+static gchar *watch_key(gchar *filename);
+static WatchDir *find_watchdir_by_wd(gint wd);
+static WatchDir *find_watchdir_by_path(gchar *path);
+
+/* Internal Variables */
+static gint inotify_fd = -1;
+static GList *watchdirs = NULL; /* Contains WatchDir structures */
+static GHashTable *watched = NULL; /* watch_key -> filename given to us */
+
+/* Sets up inotify and hooks it into the main loop. Must be called before any
+ * levelfiles are added */
+void levelwatch_init(void) {
+	GIOChannel *channel;
+
+	inotify_fd = inotify_init();
+	if(inotify_fd < 0) {
+		gb_warning("Cannot watch levelfiles for changes: %s", strerror(errno));
+		return;
+	}
+
+	watched = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+	channel = g_io_channel_unix_new(inotify_fd);
+	g_io_add_watch(channel, G_IO_IN, cb_inotify, NULL);
+	g_io_channel_unref(channel);
+}
+
+/* Starts watching filename */
+void levelwatch_add(gchar *filename) {
+	WatchDir *dir;
+	gchar *key, *path;
+	gint wd;
+
+	if(inotify_fd < 0)
+		return;
+
+	key = watch_key(filename);
+	if(g_hash_table_lookup(watched, key)) {
+		g_free(key);
+		return;
+	}
+
+	path = g_path_get_dirname(key);
+	dir = find_watchdir_by_path(path);
+	if(!dir) {
+		wd = inotify_add_watch(inotify_fd, path, WATCH_MASK);
+		if(wd < 0) {
+			gb_warning("Cannot watch %s for changes: %s", path, strerror(errno));
+			g_free(path);
+			g_free(key);
+			return;
+		}
+
+		dir = g_malloc(sizeof(WatchDir));
+		dir->path = path;
+		dir->wd = wd;
+		dir->refs = 0;
+		watchdirs = g_list_prepend(watchdirs, dir);
+	} else {
+		g_free(path);
+	}
+
+	dir->refs++;
+	g_hash_table_insert(watched, key, g_strdup(filename));
+}
+
+/* Stops watching filename. Does nothing if it isn't being watched */
+void levelwatch_remove(gchar *filename) {
+	WatchDir *dir;
+	gchar *key, *path;
+
+	if(inotify_fd < 0)
+		return;
+
+	key = watch_key(filename);
+	if(g_hash_table_remove(watched, key)) {
+		path = g_path_get_dirname(key);
+		dir = find_watchdir_by_path(path);
+		g_assert(dir);
+
+		dir->refs--;
+		if(!dir->refs) {
+			inotify_rm_watch(inotify_fd, dir->wd);
+			watchdirs = g_list_remove(watchdirs, dir);
+			g_free(dir->path);
+			g_free(dir);
+		}
+		g_free(path);
+	}
+	g_free(key);
+}
+
+/* Drains the inotify fd and asks leveldata.c to reload any levelfile that
+ * was written to */
+static gboolean cb_inotify(GIOChannel *source, GIOCondition condition, gpointer data) {
+	gchar buffer[EVENT_BUFFER_SIZE]
+		__attribute__ ((aligned(__alignof__(struct inotify_event))));
+	struct inotify_event *event;
+	WatchDir *dir;
+	gchar *key, *filename;
+	ssize_t len;
+	gchar *p;
+
+	len = read(inotify_fd, buffer, EVENT_BUFFER_SIZE);
+	if(len <= 0)
+		return TRUE;
+
+	for(p = buffer; p < buffer + len; p += sizeof(struct inotify_event) + event->len) {
+		event = (struct inotify_event *) p;
+		if(!event->len || !(event->mask & WATCH_MASK))
+			continue;
+
+		dir = find_watchdir_by_wd(event->wd);
+		if(!dir)
+			continue;
+
+		key = g_build_filename(dir->path, event->name, NULL);
+		filename = (gchar *) g_hash_table_lookup(watched, key);
+		if(filename)
+			leveldata_reload(filename);
+		g_free(key);
+	}
+
+	return TRUE;
+}
+
+/* Normalises filename into the form we build from inotify events, so that
+ * "foo.gbl" and "./foo.gbl" are the same file */
+static gchar *watch_key(gchar *filename) {
+	gchar *dir, *base, *ret;
+
+	dir = g_path_get_dirname(filename);
+	base = g_path_get_basename(filename);
+	ret = g_build_filename(dir, base, NULL);
+	g_free(dir);
+	g_free(base);
+
+	return ret;
+}
+
+static WatchDir *find_watchdir_by_wd(gint wd) {
+	GList *curr;
+
+	for(curr = watchdirs; curr; curr = g_list_next(curr)) {
+		if(((WatchDir *) curr->data)->wd == wd)
+			return (WatchDir *) curr->data;
+	}
+
+	return NULL;
+}
+
+static WatchDir *find_watchdir_by_path(gchar *path) {
+	GList *curr;
+
+	for(curr = watchdirs; curr; curr = g_list_next(curr)) {
+		if(!strcmp(((WatchDir *) curr->data)->path, path))
+			return (WatchDir *) curr->data;
+	}
+
+	return NULL;
+}
+
+#else /* !__linux__ */
+
+void levelwatch_init(void) {
+}
+
+void levelwatch_add(gchar *filename) {
+}
+
+void levelwatch_remove(gchar *filename) {
+}
+
+#endif
@@ -0,0 +1,12 @@
+/*
+ * Watches the configured levelfiles for changes
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+void levelwatch_init(void);
+void levelwatch_add(gchar *filename);
+void levelwatch_remove(gchar *filename);
@@ -0,0 +1,121 @@
+/*
+ * Keeps a count of how many of each kind of thing the game has allocated and
+ * not yet freed, and how many bytes they take up, so that leaks show up as
+ * counts that never come back down. Blocks are made by the prefetch thread
+ * and RawLevels by the levelgen one, so the counts are kept atomically.
+ *
+ * The strings counted are the ones held by RawLevels and Levels, their names,
+ * authors and titles. A string is counted when it is put into one of these,
+ * however it was made, and uncounted when it is freed.
+ *
+ * The tools that play many games at once on a pool of threads share the
+ * counts between all of them, so the check that a game has left nothing
+ * behind is only made once the last of the games running has ended.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "memstats.h"
+#include <string.h>
+
+/* Internal Variables */
+static gint counts[NUM_MEM_TYPES];
+static gint bytes[NUM_MEM_TYPES];
+static gint games_running = 0;
+static GMutex games_lock;
+static const gchar *type_names[NUM_MEM_TYPES] = {
+	"Block", "Ball", "Powerup", "Laser", "CanvasItem", "LevelString",
+	"RawLevel", "RawLevelString"
+};
+
+/* Counts one more of type, taking up size bytes */
+void memstats_add(MemType type, gsize size) {
+	g_atomic_int_add(&counts[type], 1);
+	g_atomic_int_add(&bytes[type], (gint) size);
+}
+
+/* Counts one less of type, that took up size bytes */
+void memstats_remove(MemType type, gsize size) {
+	g_atomic_int_add(&counts[type], -1);
+	g_atomic_int_add(&bytes[type], -(gint) size);
+}
+
+/* Counts a string that has just been put into a Level, as
+ * MEM_LEVEL_STRING, or a RawLevel, as MEM_RAWLEVEL_STRING. Does nothing if it
+ * is NULL */
+void memstats_add_string(MemType type, const gchar *string) {
+	if(string)
+		memstats_add(type, strlen(string) + 1);
+}
+
+/* Uncounts a string of type that is about to be freed. Does nothing if it is
+ * NULL */
+void memstats_remove_string(MemType type, const gchar *string) {
+	if(string)
+		memstats_remove(type, strlen(string) + 1);
+}
+
+gint memstats_count(MemType type) {
+	return g_atomic_int_get(&counts[type]);
+}
+
+gint memstats_bytes(MemType type) {
+	return g_atomic_int_get(&bytes[type]);
+}
+
+/* Notes that a game is starting. Must be called before it allocates
+ * anything */
+void memstats_begin_game(void) {
+	g_mutex_lock(&games_lock);
+	games_running++;
+	g_mutex_unlock(&games_lock);
+}
+
+/* Notes that a game has ended, having freed everything of its own. If no
+ * other game is running, checks that nothing is left over, as
+ * memstats_check_game does, and returns what that did. Otherwise returns
+ * TRUE */
+gboolean memstats_end_game(const gchar *when) {
+	gboolean ret = TRUE;
+
+	g_mutex_lock(&games_lock);
+	g_assert(games_running > 0);
+	if(--games_running == 0)
+		ret = memstats_check_game(when);
+	g_mutex_unlock(&games_lock);
+
+	return ret;
+}
+
+/* Checks that everything belonging to a game has been freed. If not, warns
+ * about each kind of thing left over, saying when the check was made, and
+ * returns FALSE */
+gboolean memstats_check_game(const gchar *when) {
+	gboolean ret = TRUE;
+	gint i;
+
+	for(i = 0; i < MEM_RAWLEVEL; i++) {
+		if(memstats_count(i) || memstats_bytes(i)) {
+			g_warning("%s: %d %s left over, %d bytes", when,
+					memstats_count(i), type_names[i],
+					memstats_bytes(i));
+			ret = FALSE;
+		}
+	}
+
+	return ret;
+}
+
+/* Prints what is still allocated of each kind of thing, for example
+ *   memstats Block count=0 bytes=0 */
+void memstats_print(void) {
+	gint i;
+
+	for(i = 0; i < NUM_MEM_TYPES; i++)
+		g_printerr("memstats %s count=%d bytes=%d\n", type_names[i],
+				memstats_count(i), memstats_bytes(i));
+}
@@ -0,0 +1,26 @@
+/*
+ * Counting what the game has allocated, to find leaks
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+/* The kinds of things that are counted. Everything before MEM_RAWLEVEL
+ * belongs to a game, and should all be gone once the game has ended. A
+ * Level's strings are the game's, but a RawLevel's are kept with it */
+typedef enum { MEM_BLOCK, MEM_BALL, MEM_POWERUP, MEM_LASER, MEM_CANVAS_ITEM,
+	MEM_LEVEL_STRING, MEM_RAWLEVEL, MEM_RAWLEVEL_STRING, NUM_MEM_TYPES
+} MemType;
+
+void memstats_add(MemType type, gsize size);
+void memstats_remove(MemType type, gsize size);
+void memstats_add_string(MemType type, const gchar *string);
+void memstats_remove_string(MemType type, const gchar *string);
+gint memstats_count(MemType type);
+gint memstats_bytes(MemType type);
+void memstats_begin_game(void);
+gboolean memstats_end_game(const gchar *when);
+gboolean memstats_check_game(const gchar *when);
+void memstats_print(void);
@@ -16,8 +16,9 @@
 #include "bat.h"
 #include "collision.h"
 #include "powerup.h"
-
-#define POWERUP_SPEED 2
+#include "rng.h"
+#include "memstats.h"
+#include "trace.h"
 
 /* Note that it's better to have a low chance of a powerup appearing and
  * powerful powerups, rather than a high chance and weak powerups. This is
@@ -49,10 +50,11 @@ void new_powerup(Game *game, int x, int y) {
 	gint num_powerups;
 	PowerupType *p_section = NULL;
 
-	if((POWERUP_CHANCE * rand()/RAND_MAX) > 1.0)
+	if(POWERUP_CHANCE * rng_double(&game->rng) > 1.0)
 		return;
 
 	powerup = g_malloc(sizeof(Powerup));
+	memstats_add(MEM_POWERUP, sizeof(Powerup));
 	g_assert(powerup);
 
 	powerup->geometry.x1 = x;
@@ -60,7 +62,7 @@ void new_powerup(Game *game, int x, int y) {
 	powerup->geometry.x2 = x + POWERUP_WIDTH;
 	powerup->geometry.y2 = y + POWERUP_HEIGHT;
 
-	rand_result = (int) (PROBABILITY_CAP * rand() / RAND_MAX);
+	rand_result = rng_range(&game->rng, (gint) PROBABILITY_CAP);
 	if(rand_result >= LOW_PROBABILITY)
 		p_section = low_probability;
 	else if(rand_result >= MEDIUM_PROBABILITY)
@@ -71,7 +73,7 @@ void new_powerup(Game *game, int x, int y) {
 		g_assert_not_reached();
 
 	for(num_powerups = 0; p_section[num_powerups] != -1; num_powerups++);
-	rand_result = (int) ((double) num_powerups * rand() / RAND_MAX);
+	rand_result = rng_range(&game->rng, num_powerups);
 	powerup->type = p_section[rand_result];
 
 	switch(powerup->type) {
@@ -113,6 +115,8 @@ void new_powerup(Game *game, int x, int y) {
 
 /* Adtivates a powerup, and removes it */
 void activate_powerup(Game *game, Powerup *powerup) {
+	game->stats.powerups_caught++;
+	TRACE_INSTANT("powerup", "type", powerup->type);
 	switch(powerup->type) {
 		case POWER_SCORE500 :
 			ADD_SCORE(game, 500);
@@ -146,6 +150,7 @@ void activate_powerup(Game *game, Powerup *powerup) {
 static GList *remove_powerup(GList *powerups, Powerup *powerup) {
         powerups = g_list_remove(powerups, powerup);
         remove_from_canvas((Entity *) powerup);
+        memstats_remove(MEM_POWERUP, sizeof(Powerup));
         g_free(powerup);
 
         return powerups;
@@ -169,7 +174,7 @@ void iterate_powerups(Game *game) {
 		move_powerup(powerup);
 
 		if(!bat_powerup_collision(game, powerup))
-			if(powerup->geometry.y2 > GAME_HEIGHT)
+			if(powerup->geometry.y2 > GAME_HEIGHT(game->level))
 				game->powerups = remove_powerup(game->powerups, powerup);
 	}
 }
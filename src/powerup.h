@@ -7,6 +7,9 @@
  * "COPYING" for more details.
  */
 
+/* How far powerups fall each tick */
+#define POWERUP_SPEED 2
+
 void new_powerup(Game *game, int x, int y);
 void activate_powerup(Game *game, Powerup *powerup);
 void destroy_powerup_list(GList *powerups);
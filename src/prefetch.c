@@ -0,0 +1,211 @@
+/*
+ * Builds the next level in the background, so that moving on to it doesn't
+ * stall the game while hundreds (or, for big levels, tens of thousands) of
+ * blocks are allocated and put on the canvas.
+ *
+ * The blocks are allocated on a worker thread as soon as a level starts.
+ * Once that's done they are added to a hidden canvas layer a few at a time
+ * each frame, as the canvas may only be touched from the GUI thread. Moving
+ * on to the level just swaps it in. If it wasn't all on the canvas yet, the
+ * rest is added over the next frames in the same way. The old level is
+ * hidden when it ends and torn down the same way.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "block.h"
+#include "leveldata.h"
+#include "levelparse.h"
+#include "game.h"
+#include "gui.h"
+#include "prefetch.h"
+#include "trace.h"
+
+/* How many blocks to put on, or take off, the canvas per frame */
+#define BLOCKS_PER_FRAME 200
+
+/* Internal Data Structures */
+struct _LevelPrefetch {
+	gint level_num; /* -1 if nothing is being prefetched */
+	gint generation; /* source_generation() when we started */
+	RawLevel *rawlevel; /* Our own copy, owned by the thread while it runs */
+	Level *level;
+	GThread *thread;
+	volatile gint done; /* Set by the thread when level is ready */
+	GList *retired; /* Levels waiting to be torn down */
+};
+
+typedef struct _LevelPrefetch LevelPrefetch;
+
+/* Internal Functions */
+static gpointer prefetch_thread(gpointer data);
+static void finish_thread(LevelPrefetch *prefetch);
+static void discard_prefetch(LevelPrefetch *prefetch);
+static gint source_generation(Game *game);
+
+LevelPrefetch *new_prefetch(void) {
+	LevelPrefetch *prefetch;
+
+	prefetch = g_malloc(sizeof(LevelPrefetch));
+	prefetch->level_num = -1;
+	prefetch->generation = 0;
+	prefetch->rawlevel = NULL;
+	prefetch->level = NULL;
+	prefetch->thread = NULL;
+	prefetch->done = FALSE;
+	prefetch->retired = NULL;
+
+	return prefetch;
+}
+
+/* Waits for any running prefetch, and frees everything, including levels that
+ * were still being torn down */
+void destroy_prefetch(Game *game) {
+	LevelPrefetch *prefetch = game->prefetch;
+	GList *curr;
+
+	discard_prefetch(prefetch);
+	for(curr = prefetch->retired; curr; curr = g_list_next(curr)) {
+		reap_level((Level *) curr->data, G_MAXINT);
+	}
+	g_list_free(prefetch->retired);
+
+	g_free(prefetch);
+	game->prefetch = NULL;
+}
+
+/* Starts building level_num in the background, replacing whatever was being
+ * prefetched before. Does nothing if there is no such level */
+void prefetch_level(Game *game, gint level_num) {
+	LevelPrefetch *prefetch = game->prefetch;
+
+	discard_prefetch(prefetch);
+	if(!game_has_level(game, level_num))
+		return;
+
+	/* The levels list may be changed under us by a reload, so the thread
+	 * works from a copy */
+	prefetch->level_num = level_num;
+	prefetch->generation = source_generation(game);
+	prefetch->rawlevel = game_get_rawlevel(game, level_num);
+	prefetch->done = FALSE;
+	prefetch->thread = g_thread_new("level-prefetch", prefetch_thread,
+			prefetch);
+}
+
+/* Returns level_num, on the (hidden) canvas as far as it has got, if it has
+ * been prefetched and is still current. Returns NULL otherwise, in which
+ * case use generate_level. Waits for the worker thread if it hasn't
+ * finished. iterate_prefetch puts the rest of the level on the canvas */
+Level *prefetch_take(Game *game, gint level_num) {
+	LevelPrefetch *prefetch = game->prefetch;
+	Level *level;
+
+	if(prefetch->level_num != level_num
+			|| prefetch->generation != source_generation(game)) {
+		discard_prefetch(prefetch);
+		return NULL;
+	}
+
+	finish_thread(prefetch);
+	level = prefetch->level;
+	/* Gives it a layer to show, if it hasn't been started on yet */
+	if(!level->layer)
+		realize_level(level, 0);
+
+	prefetch->level = NULL;
+	prefetch->level_num = -1;
+
+	return level;
+}
+
+/* Hides the current level and queues it to be torn down over the next few
+ * frames */
+void retire_level(Game *game) {
+	gui_hide_layer(game->level->layer);
+	game->prefetch->retired = g_list_append(game->prefetch->retired,
+			game->level);
+	game->level = NULL;
+}
+
+/* Called once a frame, not once a tick. Spends a little time putting the
+ * prefetched level on the canvas and tearing old ones down. If the level
+ * being played isn't all on the canvas yet, it gets the time instead. If a
+ * levelfile was reloaded while we were prefetching, starts again */
+void iterate_prefetch(Game *game) {
+	LevelPrefetch *prefetch = game->prefetch;
+	Level *level;
+
+	if(game->level && !realize_level(game->level, BLOCKS_PER_FRAME))
+		return;
+
+	if(prefetch->level_num >= 0
+			&& prefetch->generation != source_generation(game)) {
+		prefetch_level(game, prefetch->level_num);
+	} else if(prefetch->thread && g_atomic_int_get(&prefetch->done)) {
+		finish_thread(prefetch);
+	} else if(prefetch->level) {
+		realize_level(prefetch->level, BLOCKS_PER_FRAME);
+	}
+
+	if(prefetch->retired) {
+		level = (Level *) prefetch->retired->data;
+		if(reap_level(level, BLOCKS_PER_FRAME)) {
+			prefetch->retired = g_list_remove(prefetch->retired,
+					level);
+		}
+	}
+}
+
+/* Body of the prefetch thread. new_level doesn't touch the canvas, and the
+ * animations it uses are never changed once loaded, so no locking is
+ * needed */
+static gpointer prefetch_thread(gpointer data) {
+	LevelPrefetch *prefetch = (LevelPrefetch *) data;
+	Level *level;
+
+	trace_name_thread("prefetch");
+	TRACE_BEGIN("new_level");
+	level = new_level(prefetch->rawlevel);
+	TRACE_END("new_level");
+	g_atomic_int_set(&prefetch->done, TRUE);
+
+	return level;
+}
+
+/* Waits for the prefetch thread, if there is one, and collects its level */
+static void finish_thread(LevelPrefetch *prefetch) {
+	if(!prefetch->thread)
+		return;
+
+	prefetch->level = (Level *) g_thread_join(prefetch->thread);
+	prefetch->thread = NULL;
+	free_rawlevel(prefetch->rawlevel);
+	prefetch->rawlevel = NULL;
+}
+
+/* Throws away whatever has been prefetched */
+static void discard_prefetch(LevelPrefetch *prefetch) {
+	finish_thread(prefetch);
+	if(prefetch->level) {
+		if(prefetch->level->layer)
+			gui_hide_layer(prefetch->level->layer);
+		prefetch->retired = g_list_append(prefetch->retired,
+				prefetch->level);
+		prefetch->level = NULL;
+	}
+	prefetch->level_num = -1;
+}
+
+/* Generated and replayed levels never change, but the levelfiles can be
+ * reloaded */
+static gint source_generation(Game *game) {
+	if(game->levelgen || game->playback)
+		return 0;
+	else
+		return leveldata_generation();
+}
@@ -0,0 +1,15 @@
+/*
+ * Builds the next level in the background
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+struct _LevelPrefetch *new_prefetch(void);
+void destroy_prefetch(Game *game);
+void prefetch_level(Game *game, gint level_num);
+Level *prefetch_take(Game *game, gint level_num);
+void retire_level(Game *game);
+void iterate_prefetch(Game *game);
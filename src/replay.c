@@ -0,0 +1,532 @@
+/*
+ * Recording and playing back games. Since a game is entirely determined by
+ * its seed, its settings, its levels and the player's input on each tick (see
+ * step_game), that is all a replay holds.
+ *
+ * The input is stored as a series of records, each giving the input that
+ * held for a run of ticks as the change from the previous record. The mouse
+ * usually moves a few pixels at a time, and the keyboard and buttons rarely
+ * change at all, so most records are two or three bytes, and most ticks are
+ * covered by runs.
+ *
+ * The hash of the game's state after each tick is stored too (see
+ * statehash.c), so that playing back can tell the moment a game stops doing
+ * what it did when it was recorded, which it shouldn't ever do. Each part of
+ * the hash is only stored when it changes.
+ *
+ * File format, with integers little endian or as varints (see binio.c):
+ *
+ *   "GBRP" version:u8 seed:u32 difficulty:u8 bounce_entropy:u8 flags:u8
+ *     (flags being keyboard control, endless and fixed point, as bits 0
+ *     to 2)
+ *   num_levels:varint
+ *     present:u8 [width height difficulty name author title blocks]
+ *       (blocks are run length encoded, as run:varint code:u8 pairs)
+ *   num_ticks:varint stream_length:varint stream
+ *     each record is run:varint changed:u8 [mouse:svarint]
+ *     [keyboard:svarint] [buttons:u8]
+ *   hashes_length:varint hashes
+ *     for each tick, changed:u8, then part:u32 for each bit set in changed
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "leveldata.h"
+#include "levelparse.h"
+#include "game.h"
+#include "binio.h"
+#include "util.h"
+#include "statehash.h"
+#include "memstats.h"
+#include "replay.h"
+#include <string.h>
+
+#define REPLAY_MAGIC "GBRP"
+#define REPLAY_VERSION 5
+
+/* flags byte in the header */
+#define REPLAY_KEYBOARD_CONTROL 0x01
+#define REPLAY_ENDLESS 0x02
+#define REPLAY_FIXED_POINT 0x04
+
+/* changed byte of an input record */
+#define CHANGED_MOUSE 0x01
+#define CHANGED_KEYBOARD 0x02
+#define CHANGED_BUTTONS 0x04
+
+/* Bits of ReplayInput.buttons */
+#define BUTTON_FIRE1 0x01
+#define BUTTON_FIRE2 0x02
+#define BUTTON_KILL_BALL 0x04
+
+/* Internal Data Structures */
+typedef struct {
+	gint mouse_move;
+	gint keyboard_move;
+	guint8 buttons;
+} ReplayInput;
+
+struct _Replay {
+	guint32 seed;
+	gint difficulty;
+	gint bounce_entropy;
+	gboolean keyboard_control;
+	gboolean endless;
+	gboolean fixed_point;
+	GPtrArray *levels; /* RawLevels by level number. Gaps are NULL */
+
+	GString *stream; /* Encoded input records */
+	guint num_ticks;
+	GString *hashes; /* Encoded state hashes */
+
+	/* The hash of the previous tick, which the next is stored relative
+	 * to, or checked relative to */
+	StateHash hash;
+
+	/* While recording: the record that is still being extended, and the
+	 * one before it, which its changes are relative to */
+	ReplayInput prev, curr;
+	guint run;
+
+	/* While playing back */
+	BinReader reader;
+	ReplayInput input; /* The input of the current record */
+	guint remaining; /* Ticks left in the current record */
+	guint tick;
+	BinReader hash_reader;
+	gint desync_tick; /* The first tick whose hash was wrong, or -1 */
+	guint desync_parts; /* Bitmask of the HashParts that were wrong */
+};
+
+typedef struct _Replay Replay;
+
+/* Internal Functions */
+static Replay *alloc_replay(void);
+static void write_record(GString *out, ReplayInput *prev, ReplayInput *curr, guint run);
+static gboolean read_record(Replay *replay);
+static void write_level(GString *out, RawLevel *level);
+static RawLevel *read_level(BinReader *reader);
+static void get_input(Game *game, ReplayInput *input);
+
+/* Starts recording game, which must just have been seeded */
+Replay *new_replay(Game *game) {
+	Replay *replay;
+
+	replay = alloc_replay();
+	replay->seed = game->seed;
+	replay->difficulty = game->flags->difficulty;
+	replay->bounce_entropy = game->flags->bounce_entropy;
+	replay->keyboard_control = game->flags->keyboard_control;
+	replay->endless = game->endless;
+	replay->fixed_point = game->fixed_point;
+
+	return replay;
+}
+
+void destroy_replay(Replay *replay) {
+	guint i;
+
+	for(i = 0; i < replay->levels->len; i++) {
+		if(g_ptr_array_index(replay->levels, i))
+			free_rawlevel(g_ptr_array_index(replay->levels, i));
+	}
+	g_ptr_array_free(replay->levels, TRUE);
+	g_string_free(replay->stream, TRUE);
+	g_string_free(replay->hashes, TRUE);
+	g_free(replay);
+}
+
+/* Notes that level level_num of the game is level. Endless games don't need
+ * their levels recorded, as they can be generated again */
+void replay_record_level(Replay *replay, gint level_num, RawLevel *level) {
+	if(replay->endless)
+		return;
+
+	if(level_num >= (gint) replay->levels->len)
+		g_ptr_array_set_size(replay->levels, level_num + 1);
+	if(g_ptr_array_index(replay->levels, level_num))
+		free_rawlevel(g_ptr_array_index(replay->levels, level_num));
+	g_ptr_array_index(replay->levels, level_num) = copy_rawlevel(level);
+}
+
+/* Records the input that game is about to use for a tick */
+void replay_record_tick(Replay *replay, Game *game) {
+	ReplayInput input;
+
+	get_input(game, &input);
+
+	if(replay->run && !memcmp(&input, &replay->curr, sizeof(ReplayInput))) {
+		replay->run++;
+	} else {
+		if(replay->run) {
+			write_record(replay->stream, &replay->prev,
+					&replay->curr, replay->run);
+			replay->prev = replay->curr;
+		}
+		replay->curr = input;
+		replay->run = 1;
+	}
+	replay->num_ticks++;
+}
+
+/* Writes a replay to filename. The replay can carry on being recorded
+ * afterwards. Returns FALSE, having warned the user, on failure */
+gboolean replay_save(Replay *replay, gchar *filename) {
+	GString *out, *stream;
+	GError *error = NULL;
+	RawLevel *level;
+	guint i;
+	gboolean ret;
+
+	out = g_string_new(REPLAY_MAGIC);
+	binio_put_u8(out, REPLAY_VERSION);
+	binio_put_u32(out, replay->seed);
+	binio_put_u8(out, replay->difficulty);
+	binio_put_u8(out, replay->bounce_entropy);
+	binio_put_u8(out, (replay->keyboard_control ? REPLAY_KEYBOARD_CONTROL : 0)
+			| (replay->endless ? REPLAY_ENDLESS : 0)
+			| (replay->fixed_point ? REPLAY_FIXED_POINT : 0));
+
+	binio_put_varint(out, replay->levels->len);
+	for(i = 0; i < replay->levels->len; i++) {
+		level = (RawLevel *) g_ptr_array_index(replay->levels, i);
+		binio_put_u8(out, level != NULL);
+		if(level)
+			write_level(out, level);
+	}
+
+	/* The record being extended hasn't been written yet */
+	stream = g_string_new_len(replay->stream->str, replay->stream->len);
+	if(replay->run)
+		write_record(stream, &replay->prev, &replay->curr, replay->run);
+	binio_put_varint(out, replay->num_ticks);
+	binio_put_varint(out, stream->len);
+	g_string_append_len(out, stream->str, stream->len);
+	g_string_free(stream, TRUE);
+	binio_put_varint(out, replay->hashes->len);
+	g_string_append_len(out, replay->hashes->str, replay->hashes->len);
+
+	ret = g_file_set_contents(filename, out->str, out->len, &error);
+	if(!ret) {
+		gb_warning(_("Cannot save replay %s: %s"), filename, error->message);
+		g_error_free(error);
+	}
+	g_string_free(out, TRUE);
+
+	return ret;
+}
+
+/* Reads a replay saved by replay_save. Returns NULL, having warned the user,
+ * on failure */
+Replay *replay_load(gchar *filename) {
+	Replay *replay;
+	BinReader reader;
+	GError *error = NULL;
+	gchar *contents;
+	const guchar *stream;
+	gsize len;
+	guint64 num_levels, stream_len, hashes_len, i;
+	guint8 flags;
+
+	if(!g_file_get_contents(filename, &contents, &len, &error)) {
+		gb_warning(_("Cannot read replay %s: %s"), filename, error->message);
+		g_error_free(error);
+		return NULL;
+	}
+
+	binio_reader_init(&reader, (guchar *) contents, len);
+	stream = binio_get_bytes(&reader, strlen(REPLAY_MAGIC));
+	if(!stream || memcmp(stream, REPLAY_MAGIC, strlen(REPLAY_MAGIC))
+			|| binio_get_u8(&reader) != REPLAY_VERSION) {
+		gb_warning(_("%s is not a replay, or is from another version"), filename);
+		g_free(contents);
+		return NULL;
+	}
+
+	replay = alloc_replay();
+	replay->seed = binio_get_u32(&reader);
+	replay->difficulty = binio_get_u8(&reader);
+	replay->bounce_entropy = binio_get_u8(&reader);
+	flags = binio_get_u8(&reader);
+	replay->keyboard_control = (flags & REPLAY_KEYBOARD_CONTROL) != 0;
+	replay->endless = (flags & REPLAY_ENDLESS) != 0;
+	replay->fixed_point = (flags & REPLAY_FIXED_POINT) != 0;
+
+	num_levels = binio_get_varint(&reader);
+	for(i = 0; !reader.error && i < num_levels; i++) {
+		if(binio_get_u8(&reader))
+			g_ptr_array_add(replay->levels, read_level(&reader));
+		else
+			g_ptr_array_add(replay->levels, NULL);
+	}
+
+	replay->num_ticks = binio_get_varint(&reader);
+	stream_len = binio_get_varint(&reader);
+	stream = binio_get_bytes(&reader, stream_len);
+	if(stream)
+		g_string_append_len(replay->stream, (gchar *) stream, stream_len);
+	hashes_len = binio_get_varint(&reader);
+	stream = binio_get_bytes(&reader, hashes_len);
+	if(stream)
+		g_string_append_len(replay->hashes, (gchar *) stream, hashes_len);
+
+	g_free(contents);
+	if(reader.error) {
+		gb_warning(_("Replay %s is damaged"), filename);
+		destroy_replay(replay);
+		return NULL;
+	}
+
+	return replay;
+}
+
+/* Starts a new game that plays replay back. Set up game->flags before calling
+ * this; the settings that affect play are overridden with the replay's.
+ * Returns FALSE if the game couldn't be started */
+gboolean replay_start(Replay *replay, Game *game) {
+	binio_reader_init(&replay->reader, (guchar *) replay->stream->str,
+			replay->stream->len);
+	memset(&replay->input, 0, sizeof(ReplayInput));
+	replay->remaining = 0;
+	replay->tick = 0;
+	binio_reader_init(&replay->hash_reader, (guchar *) replay->hashes->str,
+			replay->hashes->len);
+	memset(&replay->hash, 0, sizeof(StateHash));
+	replay->desync_tick = -1;
+	replay->desync_parts = 0;
+
+	game->flags->next_game_difficulty = replay->difficulty;
+	game->flags->bounce_entropy = replay->bounce_entropy;
+	game->flags->keyboard_control = replay->keyboard_control;
+	game->flags->mouse_control = !replay->keyboard_control;
+	game->endless = replay->endless;
+	game->fixed_point = replay->fixed_point;
+	game->playback = replay;
+
+	return new_game(game, replay->seed);
+}
+
+/* Sets game's input for the next tick. Returns FALSE when the replay has run
+ * out, or is damaged */
+gboolean replay_play_tick(Replay *replay, Game *game) {
+	if(replay->tick >= replay->num_ticks)
+		return FALSE;
+	if(!replay->remaining && !read_record(replay))
+		return FALSE;
+
+	game->mouse_move = replay->input.mouse_move;
+	game->keyboard_move = replay->input.keyboard_move;
+	game->fire1_pressed = (replay->input.buttons & BUTTON_FIRE1) != 0;
+	game->fire2_pressed = (replay->input.buttons & BUTTON_FIRE2) != 0;
+	game->kill_ball_pressed = (replay->input.buttons & BUTTON_KILL_BALL) != 0;
+
+	replay->remaining--;
+	replay->tick++;
+
+	return TRUE;
+}
+
+/* Records the state of game after a tick */
+void replay_record_hash(Replay *replay, Game *game) {
+	StateHash hash;
+	guint8 changed = 0;
+	gint i;
+
+	statehash_compute(game, &hash);
+	for(i = 0; i < NUM_HASH_PARTS; i++) {
+		if(hash.part[i] != replay->hash.part[i])
+			changed |= 1 << i;
+	}
+	binio_put_u8(replay->hashes, changed);
+	for(i = 0; i < NUM_HASH_PARTS; i++) {
+		if(changed & (1 << i))
+			binio_put_u32(replay->hashes, hash.part[i]);
+	}
+	replay->hash = hash;
+}
+
+/* Checks the state of game after a tick against the recording. Returns FALSE
+ * if it differs, and notes the first tick that did. Replays that are too
+ * short, or damaged, count as differing */
+gboolean replay_check_hash(Replay *replay, Game *game) {
+	BinReader *reader = &replay->hash_reader;
+	StateHash hash;
+	guint8 changed;
+	guint parts = 0;
+	gint i;
+
+	changed = binio_get_u8(reader);
+	for(i = 0; i < NUM_HASH_PARTS; i++) {
+		if(changed & (1 << i))
+			replay->hash.part[i] = binio_get_u32(reader);
+	}
+
+	statehash_compute(game, &hash);
+	for(i = 0; i < NUM_HASH_PARTS; i++) {
+		if(reader->error || hash.part[i] != replay->hash.part[i])
+			parts |= 1 << i;
+	}
+
+	if(parts && replay->desync_tick < 0) {
+		replay->desync_tick = replay->tick - 1;
+		replay->desync_parts = parts;
+	}
+
+	return !parts;
+}
+
+/* Returns the first tick after which the game played back differed from the
+ * recording, or -1 if it hasn't yet. parts is set to a bitmask of the
+ * HashParts that differed */
+gint replay_desync_tick(Replay *replay, guint *parts) {
+	if(parts)
+		*parts = replay->desync_parts;
+	return replay->desync_tick;
+}
+
+gboolean replay_has_level(Replay *replay, gint level_num) {
+	return level_num < (gint) replay->levels->len
+		&& g_ptr_array_index(replay->levels, level_num);
+}
+
+/* Returns a copy of a recorded level. Free it with free_rawlevel */
+RawLevel *replay_get_level(Replay *replay, gint level_num) {
+	g_assert(replay_has_level(replay, level_num));
+
+	return copy_rawlevel(g_ptr_array_index(replay->levels, level_num));
+}
+
+guint replay_num_ticks(Replay *replay) {
+	return replay->num_ticks;
+}
+
+static Replay *alloc_replay(void) {
+	Replay *replay;
+
+	replay = g_malloc0(sizeof(Replay));
+	replay->levels = g_ptr_array_new();
+	replay->stream = g_string_new(NULL);
+	replay->hashes = g_string_new(NULL);
+	replay->desync_tick = -1;
+
+	return replay;
+}
+
+/* Writes the input curr, which held for run ticks, as changes from prev */
+static void write_record(GString *out, ReplayInput *prev, ReplayInput *curr, guint run) {
+	guint8 changed = 0;
+
+	if(curr->mouse_move != prev->mouse_move)
+		changed |= CHANGED_MOUSE;
+	if(curr->keyboard_move != prev->keyboard_move)
+		changed |= CHANGED_KEYBOARD;
+	if(curr->buttons != prev->buttons)
+		changed |= CHANGED_BUTTONS;
+
+	binio_put_varint(out, run);
+	binio_put_u8(out, changed);
+	if(changed & CHANGED_MOUSE)
+		binio_put_svarint(out, curr->mouse_move - prev->mouse_move);
+	if(changed & CHANGED_KEYBOARD)
+		binio_put_svarint(out, curr->keyboard_move - prev->keyboard_move);
+	if(changed & CHANGED_BUTTONS)
+		binio_put_u8(out, curr->buttons);
+}
+
+/* Reads the next input record into replay->input */
+static gboolean read_record(Replay *replay) {
+	BinReader *reader = &replay->reader;
+	guint8 changed;
+
+	replay->remaining = binio_get_varint(reader);
+	changed = binio_get_u8(reader);
+	if(changed & CHANGED_MOUSE)
+		replay->input.mouse_move += binio_get_svarint(reader);
+	if(changed & CHANGED_KEYBOARD)
+		replay->input.keyboard_move += binio_get_svarint(reader);
+	if(changed & CHANGED_BUTTONS)
+		replay->input.buttons = binio_get_u8(reader);
+
+	return !reader->error && replay->remaining;
+}
+
+static void write_level(GString *out, RawLevel *level) {
+	gint i, run, total;
+
+	binio_put_varint(out, level->width);
+	binio_put_varint(out, level->height);
+	binio_put_varint(out, level->difficulty);
+	binio_put_string(out, level->name);
+	binio_put_string(out, level->author);
+	binio_put_string(out, level->levelfile_title);
+
+	total = level->width * level->height;
+	for(i = 0; i < total; i += run) {
+		for(run = 1; i + run < total
+				&& level->blocks[i + run] == level->blocks[i]; run++);
+		binio_put_varint(out, run);
+		binio_put_u8(out, level->blocks[i]);
+	}
+}
+
+/* Returns NULL, and sets reader->error, if the level is damaged */
+static RawLevel *read_level(BinReader *reader) {
+	RawLevel *level;
+	gint width, height, difficulty, i, total;
+	guint64 run;
+	guint8 code;
+
+	width = binio_get_varint(reader);
+	height = binio_get_varint(reader);
+	difficulty = binio_get_varint(reader);
+	if(width < MIN_BLOCKS_X || width > MAX_BLOCKS_X
+			|| height < MIN_BLOCKS_Y || height > MAX_BLOCKS_Y) {
+		reader->error = TRUE;
+		return NULL;
+	}
+
+	level = new_rawlevel(width, height, difficulty, NULL, NULL, NULL);
+	level->name = binio_get_string(reader);
+	level->author = binio_get_string(reader);
+	level->levelfile_title = binio_get_string(reader);
+	memstats_add_string(MEM_RAWLEVEL_STRING, level->name);
+	memstats_add_string(MEM_RAWLEVEL_STRING, level->author);
+	memstats_add_string(MEM_RAWLEVEL_STRING, level->levelfile_title);
+
+	total = width * height;
+	level->blocks = g_malloc(sizeof(gchar) * total);
+	for(i = 0; !reader->error && i < total; i += run) {
+		run = binio_get_varint(reader);
+		code = binio_get_u8(reader);
+		if(!run || run > (guint64) (total - i) || code > MAX_BLOCK_CODE) {
+			reader->error = TRUE;
+		} else {
+			memset(level->blocks + i, code, run);
+		}
+	}
+
+	if(reader->error) {
+		free_rawlevel(level);
+		return NULL;
+	}
+
+	return level;
+}
+
+static void get_input(Game *game, ReplayInput *input) {
+	/* Keep the padding zeroed, so that inputs can be memcmp'd. Only one
+	 * of the mouse and keyboard is used, so the other is left at zero
+	 * to keep it out of the stream */
+	memset(input, 0, sizeof(ReplayInput));
+	if(game->flags->keyboard_control)
+		input->keyboard_move = game->keyboard_move;
+	else
+		input->mouse_move = game->mouse_move;
+	input->buttons = (game->fire1_pressed ? BUTTON_FIRE1 : 0)
+		| (game->fire2_pressed ? BUTTON_FIRE2 : 0)
+		| (game->kill_ball_pressed ? BUTTON_KILL_BALL : 0);
+}
@@ -0,0 +1,23 @@
+/*
+ * Recording and playing back games
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+struct _Replay *new_replay(Game *game);
+void destroy_replay(struct _Replay *replay);
+void replay_record_level(struct _Replay *replay, gint level_num, RawLevel *level);
+void replay_record_tick(struct _Replay *replay, Game *game);
+gboolean replay_save(struct _Replay *replay, gchar *filename);
+struct _Replay *replay_load(gchar *filename);
+gboolean replay_start(struct _Replay *replay, Game *game);
+gboolean replay_play_tick(struct _Replay *replay, Game *game);
+void replay_record_hash(struct _Replay *replay, Game *game);
+gboolean replay_check_hash(struct _Replay *replay, Game *game);
+gint replay_desync_tick(struct _Replay *replay, guint *parts);
+gboolean replay_has_level(struct _Replay *replay, gint level_num);
+RawLevel *replay_get_level(struct _Replay *replay, gint level_num);
+guint replay_num_ticks(struct _Replay *replay);
@@ -0,0 +1,376 @@
+/*
+ * Rewinding games in progress. Every REWIND_INTERVAL ticks the game is saved
+ * (see savegame.c), and the rewind key puts back the save from REWIND_TICKS
+ * ago.
+ *
+ * From one snapshot to the next, most of a game doesn't change: the block
+ * grid loses a block or two, and the balls and bat move. So each snapshot is
+ * stored as a delta against the one before it, as runs copied from the
+ * previous snapshot and runs of new bytes. A copy can come from anywhere in
+ * the previous snapshot, not just the same place, as a block going or a
+ * number getting longer shifts everything after it along. Every
+ * KEYFRAME_INTERVAL snapshots one is stored whole, so that going back doesn't
+ * mean decoding from the start of the game.
+ *
+ * The deltas go into a ring of REWIND_BUDGET bytes, and new ones overwrite
+ * the oldest, so rewinding takes the same memory however long the game goes
+ * on. Deltas whose keyframe has been overwritten are no use and are dropped
+ * with it.
+ *
+ * Delta format:
+ *
+ *   length:varint, then ops until that many bytes have been made, each
+ *   (run << 1 | 1):varint offset:svarint   copy run bytes from offset + the
+ *                                          current position in the previous
+ *                                          snapshot
+ *   (run << 1):varint bytes[run]           run new bytes
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "binio.h"
+#include "savegame.h"
+#include "rewind.h"
+#include <string.h>
+
+#define REWIND_MAX_SNAPSHOTS 4096
+#define KEYFRAME_INTERVAL 16
+
+/* Copies shorter than this aren't worth the op */
+#define MIN_COPY 4
+#define MATCH_HASH_BITS 10
+#define MATCH_HASH_SIZE (1 << MATCH_HASH_BITS)
+
+typedef struct {
+	gsize offset;
+	gsize len;
+	guint tick;
+	gboolean keyframe;
+} Snapshot;
+
+struct _Rewind {
+	/* The ring of deltas, and where the next one goes */
+	guchar *data;
+	gsize head;
+
+	/* The snapshots in the ring, oldest first, starting at first */
+	Snapshot *snapshots;
+	guint first;
+	guint count;
+	guint since_keyframe;
+
+	/* Ticks seen, and the newest snapshot decoded, to make the next delta
+	 * against */
+	guint tick;
+	GString *last;
+
+	/* Scratch space, kept to save allocating it every snapshot */
+	GString *delta;
+	gint match[MATCH_HASH_SIZE];
+};
+
+/* Internal Functions */
+static void take_snapshot(Rewind *rewind, Game *game);
+static void store_delta(Rewind *rewind, gsize len, gboolean keyframe);
+static void evict_range(Rewind *rewind, gsize offset, gsize len);
+static void evict_oldest(Rewind *rewind);
+static Snapshot *nth_snapshot(Rewind *rewind, guint n);
+static void encode_delta(Rewind *rewind, GString *prev, GString *next);
+static void decode_delta(const guchar *delta, gsize len, GString *prev,
+		GString *out);
+static guint match_hash(const guchar *bytes);
+static gsize match_length(const guchar *a, const guchar *b, gsize max);
+
+Rewind *new_rewind(void) {
+	Rewind *rewind;
+
+	rewind = g_malloc0(sizeof(Rewind));
+	rewind->data = g_malloc(REWIND_BUDGET);
+	rewind->snapshots = g_malloc(REWIND_MAX_SNAPSHOTS * sizeof(Snapshot));
+	rewind->last = g_string_new(NULL);
+	rewind->delta = g_string_new(NULL);
+
+	return rewind;
+}
+
+void destroy_rewind(Rewind *rewind) {
+	g_free(rewind->data);
+	g_free(rewind->snapshots);
+	g_string_free(rewind->last, TRUE);
+	g_string_free(rewind->delta, TRUE);
+	g_free(rewind);
+}
+
+/* Called once a tick, after the game has moved on. game must be running */
+void rewind_tick(Rewind *rewind, Game *game) {
+	if(rewind->tick % REWIND_INTERVAL == 0)
+		take_snapshot(rewind, game);
+	rewind->tick++;
+}
+
+/* Goes back ticks, or as far as the snapshots go if that's not as far, and
+ * returns the snapshot there, for savegame_read. Later snapshots are thrown
+ * away, so going back again goes further back. Returns NULL if there are no
+ * snapshots. Free the snapshot with g_string_free */
+GString *rewind_back(Rewind *rewind, guint ticks) {
+	Snapshot *snapshot;
+	GString *prev, *tmp;
+	guint target, n, key;
+
+	if(!rewind->count)
+		return NULL;
+
+	target = rewind->tick > ticks ? rewind->tick - ticks : 0;
+	for(n = rewind->count - 1; n > 0; n--) {
+		if(nth_snapshot(rewind, n)->tick <= target)
+			break;
+	}
+	for(key = n; !nth_snapshot(rewind, key)->keyframe; key--)
+		;
+
+	/* Decode forward from the keyframe */
+	prev = g_string_new(NULL);
+	for(; key <= n; key++) {
+		snapshot = nth_snapshot(rewind, key);
+		decode_delta(rewind->data + snapshot->offset, snapshot->len,
+				prev, rewind->last);
+		tmp = prev;
+		prev = rewind->last;
+		rewind->last = tmp;
+	}
+	tmp = rewind->last;
+	rewind->last = prev;
+	g_string_free(tmp, TRUE);
+
+	/* Forget everything after it */
+	snapshot = nth_snapshot(rewind, n);
+	rewind->count = n + 1;
+	rewind->head = snapshot->offset + snapshot->len;
+	rewind->tick = snapshot->tick + 1;
+	for(rewind->since_keyframe = 0;
+			!nth_snapshot(rewind, n)->keyframe; n--)
+		rewind->since_keyframe++;
+
+	return g_string_new_len(rewind->last->str, rewind->last->len);
+}
+
+/* How many snapshots are held, how much of REWIND_BUDGET they take up, and
+ * how many ticks back they go */
+void rewind_stats(Rewind *rewind, guint *num_snapshots, gsize *bytes_used,
+		guint *ticks_held) {
+	guint n;
+
+	*num_snapshots = rewind->count;
+	*bytes_used = 0;
+	for(n = 0; n < rewind->count; n++)
+		*bytes_used += nth_snapshot(rewind, n)->len;
+	*ticks_held = rewind->count
+		? rewind->tick - nth_snapshot(rewind, 0)->tick : 0;
+}
+
+static void take_snapshot(Rewind *rewind, Game *game) {
+	GString *next;
+	gboolean keyframe;
+
+	next = savegame_write(game);
+
+	keyframe = !rewind->count || rewind->since_keyframe >= KEYFRAME_INTERVAL;
+	encode_delta(rewind, keyframe ? NULL : rewind->last, next);
+	if(rewind->delta->len > REWIND_BUDGET) {
+		/* Too big to keep at all. Levels are nowhere near this big */
+		rewind->count = 0;
+		g_string_free(next, TRUE);
+		return;
+	}
+	store_delta(rewind, rewind->delta->len, keyframe);
+
+	/* Making room may have overwritten the delta's keyframe */
+	if(!rewind->count) {
+		encode_delta(rewind, NULL, next);
+		store_delta(rewind, rewind->delta->len, TRUE);
+	}
+
+	g_string_free(rewind->last, TRUE);
+	rewind->last = next;
+}
+
+/* Puts the delta in rewind->delta in the ring, overwriting the oldest
+ * snapshots to make room. If that leaves a delta without its keyframe, and
+ * the delta being stored isn't a keyframe, nothing is stored and the ring is
+ * left empty */
+static void store_delta(Rewind *rewind, gsize len, gboolean keyframe) {
+	Snapshot *snapshot;
+
+	if(rewind->head + len > REWIND_BUDGET) {
+		evict_range(rewind, rewind->head, REWIND_BUDGET - rewind->head);
+		rewind->head = 0;
+	}
+	evict_range(rewind, rewind->head, len);
+	if(rewind->count == REWIND_MAX_SNAPSHOTS)
+		evict_oldest(rewind);
+	if(!keyframe && !rewind->count)
+		return;
+
+	memcpy(rewind->data + rewind->head, rewind->delta->str, len);
+	rewind->count++;
+	snapshot = nth_snapshot(rewind, rewind->count - 1);
+	snapshot->offset = rewind->head;
+	snapshot->len = len;
+	snapshot->tick = rewind->tick;
+	snapshot->keyframe = keyframe;
+	rewind->head += len;
+	rewind->since_keyframe = keyframe ? 0 : rewind->since_keyframe + 1;
+}
+
+/* Drops the oldest snapshots until none of them are in the len bytes of the
+ * ring at offset. The oldest snapshot always comes straight after the head,
+ * so that's the first to go */
+static void evict_range(Rewind *rewind, gsize offset, gsize len) {
+	Snapshot *oldest;
+
+	while(rewind->count) {
+		oldest = nth_snapshot(rewind, 0);
+		if(oldest->offset >= offset + len
+				|| oldest->offset + oldest->len <= offset)
+			break;
+		evict_oldest(rewind);
+	}
+}
+
+/* Drops the oldest snapshot, and the deltas that needed it */
+static void evict_oldest(Rewind *rewind) {
+	do {
+		rewind->first = (rewind->first + 1) % REWIND_MAX_SNAPSHOTS;
+		rewind->count--;
+	} while(rewind->count && !nth_snapshot(rewind, 0)->keyframe);
+}
+
+static Snapshot *nth_snapshot(Rewind *rewind, guint n) {
+	g_assert(n < rewind->count);
+
+	return &rewind->snapshots[(rewind->first + n) % REWIND_MAX_SNAPSHOTS];
+}
+
+/* Puts the delta from prev to next in rewind->delta. If prev is NULL, next
+ * is stored whole */
+static void encode_delta(Rewind *rewind, GString *prev, GString *next) {
+	const guchar *old, *new;
+	gsize pos, literal, run, best_run;
+	gssize offset, best_offset;
+	gint candidate;
+	guint i;
+
+	g_string_truncate(rewind->delta, 0);
+	binio_put_varint(rewind->delta, next->len);
+	old = prev ? (guchar *) prev->str : NULL;
+	new = (guchar *) next->str;
+
+	/* Where each run of MIN_COPY bytes can be found in prev. Later
+	 * places replace earlier ones, which is fine */
+	for(i = 0; i < MATCH_HASH_SIZE; i++)
+		rewind->match[i] = -1;
+	for(pos = 0; prev && pos + MIN_COPY <= prev->len; pos++)
+		rewind->match[match_hash(old + pos)] = pos;
+
+	offset = 0;
+	literal = 0;
+	pos = 0;
+	while(pos < next->len) {
+		/* Try carrying on from where the last copy left off, then
+		 * wherever the hash says */
+		best_run = 0;
+		best_offset = 0;
+		if(prev && pos + offset < prev->len)
+			best_run = match_length(old + pos + offset, new + pos,
+					MIN(prev->len - (pos + offset),
+						next->len - pos));
+		if(best_run)
+			best_offset = offset;
+		if(prev && best_run < MIN_COPY && pos + MIN_COPY <= next->len) {
+			candidate = rewind->match[match_hash(new + pos)];
+			if(candidate >= 0) {
+				run = match_length(old + candidate, new + pos,
+						MIN(prev->len - candidate,
+							next->len - pos));
+				if(run > best_run) {
+					best_run = run;
+					best_offset = candidate - (gssize) pos;
+				}
+			}
+		}
+
+		if(best_run < MIN_COPY && pos + best_run < next->len) {
+			literal++;
+			pos++;
+			continue;
+		}
+
+		if(literal) {
+			binio_put_varint(rewind->delta, literal << 1);
+			g_string_append_len(rewind->delta,
+					(gchar *) new + pos - literal, literal);
+			literal = 0;
+		}
+		binio_put_varint(rewind->delta, (best_run << 1) | 1);
+		binio_put_svarint(rewind->delta, best_offset);
+		offset = best_offset;
+		pos += best_run;
+	}
+	if(literal) {
+		binio_put_varint(rewind->delta, literal << 1);
+		g_string_append_len(rewind->delta, (gchar *) new + pos - literal,
+				literal);
+	}
+}
+
+/* Applies a delta made by encode_delta to prev, putting the result in out.
+ * Deltas only ever come from encode_delta, so they're trusted */
+static void decode_delta(const guchar *delta, gsize len, GString *prev,
+		GString *out) {
+	BinReader reader;
+	const guchar *bytes;
+	gsize size, run;
+	guint64 op;
+	gint64 offset;
+
+	binio_reader_init(&reader, delta, len);
+	size = binio_get_varint(&reader);
+	g_string_truncate(out, 0);
+
+	while(out->len < size) {
+		op = binio_get_varint(&reader);
+		run = op >> 1;
+		if(op & 1) {
+			offset = binio_get_svarint(&reader) + out->len;
+			g_assert(offset >= 0 && offset + run <= prev->len);
+			g_string_append_len(out, prev->str + offset, run);
+		} else {
+			bytes = binio_get_bytes(&reader, run);
+			g_assert(bytes);
+			g_string_append_len(out, (gchar *) bytes, run);
+		}
+	}
+
+	g_assert(!reader.error && out->len == size);
+}
+
+static guint match_hash(const guchar *bytes) {
+	guint32 word;
+
+	word = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16)
+		| ((guint32) bytes[3] << 24);
+	return (word * 2654435761U) >> (32 - MATCH_HASH_BITS);
+}
+
+static gsize match_length(const guchar *a, const guchar *b, gsize max) {
+	gsize len;
+
+	for(len = 0; len < max && a[len] == b[len]; len++)
+		;
+
+	return len;
+}
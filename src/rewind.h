@@ -0,0 +1,24 @@
+/*
+ * Rewinding games in progress
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+/* How often a snapshot is taken, and how far back the rewind key goes */
+#define REWIND_INTERVAL 10
+#define REWIND_TICKS 100
+
+/* The memory the snapshots may take up, all told */
+#define REWIND_BUDGET (128 * 1024)
+
+typedef struct _Rewind Rewind;
+
+Rewind *new_rewind(void);
+void destroy_rewind(Rewind *rewind);
+void rewind_tick(Rewind *rewind, Game *game);
+GString *rewind_back(Rewind *rewind, guint ticks);
+void rewind_stats(Rewind *rewind, guint *num_snapshots, gsize *bytes_used,
+		guint *ticks_held);
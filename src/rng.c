@@ -0,0 +1,51 @@
+/*
+ * The game's random number generator. This is PCG32: small, fast, and, unlike
+ * rand(), the same everywhere. Each Game has its own, seeded when the game
+ * starts, so a game can be replayed exactly from its seed and several games
+ * can be simulated at once on different threads.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "rng.h"
+
+#define PCG_MULTIPLIER 6364136223846793005ULL
+#define PCG_INCREMENT 1442695040888963407ULL
+
+/* Resets rng so that it produces the sequence for seed */
+void rng_seed(Rng *rng, guint64 seed) {
+	rng->state = 0;
+	rng->inc = PCG_INCREMENT;
+	rng_next(rng);
+	rng->state += seed;
+	rng_next(rng);
+}
+
+/* Returns the next 32 random bits */
+guint32 rng_next(Rng *rng) {
+	guint64 old;
+	guint32 xorshifted, rot;
+
+	old = rng->state;
+	rng->state = old * PCG_MULTIPLIER + rng->inc;
+	xorshifted = (guint32) (((old >> 18) ^ old) >> 27);
+	rot = (guint32) (old >> 59);
+
+	return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+/* Returns a number in [0, 1) */
+gdouble rng_double(Rng *rng) {
+	return rng_next(rng) / 4294967296.0;
+}
+
+/* Returns a number in [0, n) */
+gint rng_range(Rng *rng, gint n) {
+	g_assert(n > 0);
+
+	return (gint) (rng_double(rng) * n);
+}
@@ -0,0 +1,13 @@
+/*
+ * The game's random number generator
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+void rng_seed(Rng *rng, guint64 seed);
+guint32 rng_next(Rng *rng);
+gdouble rng_double(Rng *rng);
+gint rng_range(Rng *rng, gint n);
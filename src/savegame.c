@@ -0,0 +1,690 @@
+/*
+ * Saving and restoring games in progress. Everything that a game is made of
+ * goes into a compact binary blob: the game itself, the level as it stands,
+ * the bat and its lasers, the balls and the powerups, down to the frame each
+ * animation is at. Restoring makes the entities again straight from the blob,
+ * and points their animations at the pixmaps that anim.c has already loaded,
+ * so nothing is read from disk or decoded but the blob itself. Rewinding
+ * restores into the game as it stands instead, see savegame_restore.
+ *
+ * Format, with integers little endian or as varints (see binio.c):
+ *
+ *   "GBSV" version:u8
+ *   seed:u32 rng_state:varint rng_inc:varint difficulty:u8 endless:u8
+ *   fixed_point:u8 (from version 2 on)
+ *   score:svarint last_newlife_score:svarint lives:svarint level_no:varint
+ *   powerup_next_level:u8
+ *   level: width height difficulty name author title blocks_left
+ *     blocks, as run:varint code:u8 pairs, code being 0 for no block or
+ *     the BlockType plus one. Blocks part way through changing are written
+ *     as runs of one, followed by their animation.
+ *     num_active:varint block_no:varint... (the active list, in order)
+ *   bat: geometry width type num_lasers_allowed animation
+ *     num_lasers:varint (geometry animation)...
+ *   num_balls:varint (geometry pseudo_x1:double pseudo_y1:double
+ *     speed:double direction:double airtime type animation)...
+ *   num_powerups:varint (geometry type animation)...
+ *
+ * where a geometry is four svarints, and an animation is id:u8 type:u8
+ * frame_no:varint.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "anim.h"
+#include "block.h"
+#include "ball.h"
+#include "powerup.h"
+#include "flags.h"
+#include "game.h"
+#include "gui.h"
+#include "levelparse.h"
+#include "leveldata.h"
+#include "levelgen.h"
+#include "prefetch.h"
+#include "replay.h"
+#include "binio.h"
+#include "util.h"
+#include "memstats.h"
+#include "trajectory.h"
+#include "savegame.h"
+#include <string.h>
+
+#define SAVEGAME_MAGIC "GBSV"
+#define SAVEGAME_VERSION 2
+
+/* Internal Data Structures */
+/* A game as read back from a blob, before it's put in a game */
+typedef struct {
+	guint32 seed;
+	Rng rng;
+	Difficulty difficulty;
+	gboolean endless;
+	gboolean fixed_point;
+	gint32 score;
+	gint32 last_newlife_score;
+	gint lives;
+	gint level_no;
+	gboolean powerup_next_level;
+	Level *level;
+	Bat *bat;
+	GList *balls;
+	GList *powerups;
+} SavedGame;
+
+/* Internal Functions */
+static void write_geometry(GString *out, Geometry *geometry);
+static void write_animation(GString *out, Animation *animation);
+static void write_level(GString *out, Level *level);
+static void write_bat(GString *out, Bat *bat);
+static void read_geometry(BinReader *reader, Geometry *geometry);
+static void read_animation(BinReader *reader, Animation *animation);
+static Level *read_level(BinReader *reader);
+static Bat *read_bat(BinReader *reader);
+static GList *read_balls(BinReader *reader);
+static GList *read_powerups(BinReader *reader);
+static void free_bat(Bat *bat);
+static gboolean block_is_changing(Block *block);
+static gboolean read_game(const guchar *data, gsize len, SavedGame *saved);
+static void free_saved_game(SavedGame *saved);
+static void restore_bat(Bat *bat, Bat *saved);
+static void add_list_to_canvas(GList *entities);
+static void reset_input(Game *game);
+
+/* Returns game, which must be running or paused, as a blob. Free it with
+ * g_string_free */
+GString *savegame_write(Game *game) {
+	GString *out;
+	GList *curr;
+	Ball *ball;
+	Powerup *powerup;
+
+	g_assert(game->state != STATE_STOPPED);
+
+	out = g_string_new(SAVEGAME_MAGIC);
+	binio_put_u8(out, SAVEGAME_VERSION);
+
+	binio_put_u32(out, game->seed);
+	binio_put_varint(out, game->rng.state);
+	binio_put_varint(out, game->rng.inc);
+	binio_put_u8(out, game->flags->difficulty);
+	binio_put_u8(out, game->endless);
+	binio_put_u8(out, game->fixed_point);
+	binio_put_svarint(out, game->score);
+	binio_put_svarint(out, game->last_newlife_score);
+	binio_put_svarint(out, game->lives);
+	binio_put_varint(out, game->level_no);
+	binio_put_u8(out, game->powerup_next_level);
+
+	write_level(out, game->level);
+	write_bat(out, game->bat);
+
+	binio_put_varint(out, g_list_length(game->balls));
+	for(curr = game->balls; curr; curr = g_list_next(curr)) {
+		ball = (Ball *) curr->data;
+		write_geometry(out, &ball->geometry);
+		binio_put_double(out, ball->pseudo_x1);
+		binio_put_double(out, ball->pseudo_y1);
+		binio_put_double(out, ball->speed);
+		binio_put_double(out, ball->direction);
+		binio_put_varint(out, ball->airtime);
+		binio_put_u8(out, ball->type);
+		write_animation(out, &ball->animation);
+	}
+
+	binio_put_varint(out, g_list_length(game->powerups));
+	for(curr = game->powerups; curr; curr = g_list_next(curr)) {
+		powerup = (Powerup *) curr->data;
+		write_geometry(out, &powerup->geometry);
+		binio_put_u8(out, powerup->type);
+		write_animation(out, &powerup->animation);
+	}
+
+	return out;
+}
+
+/* Restores a game written by savegame_write into game, which must be stopped,
+ * and puts it on the canvas. The game is left running, but not iterated.
+ * Returns FALSE, leaving game alone, if the blob is damaged */
+gboolean savegame_read(Game *game, const guchar *data, gsize len) {
+	SavedGame saved;
+	GList *curr;
+
+	g_assert(game->state == STATE_STOPPED);
+
+	memstats_begin_game();
+	if(!read_game(data, len, &saved)) {
+		memstats_end_game("savegame_read");
+		return FALSE;
+	}
+
+	game->seed = saved.seed;
+	game->rng = saved.rng;
+	game->flags->difficulty = saved.difficulty;
+	compute_flags(game->flags);
+	game->endless = saved.endless;
+	game->fixed_point = saved.fixed_point;
+	game->score = saved.score;
+	game->last_newlife_score = saved.last_newlife_score;
+	game->lives = saved.lives;
+	game->level_no = saved.level_no;
+	game->powerup_next_level = saved.powerup_next_level;
+
+	/* A replay has to start at the start of a game */
+	if(game->recording) {
+		destroy_replay(game->recording);
+		game->recording = NULL;
+	}
+	game->playback = NULL;
+
+	if(game->endless)
+		game->levelgen = new_levelgen(saved.seed);
+	game->level = saved.level;
+	realize_level(saved.level, saved.level->width * saved.level->height);
+	gui_show_layer(saved.level->layer);
+	gui_new_level(saved.level);
+	game->prefetch = new_prefetch();
+	prefetch_level(game, saved.level_no + 1);
+
+	game->bat = saved.bat;
+	add_to_canvas((Entity *) saved.bat);
+	add_list_to_canvas(saved.bat->children);
+	game->balls = saved.balls;
+	for(curr = saved.balls; curr; curr = g_list_next(curr))
+		((Ball *) curr->data)->fixed_point = saved.fixed_point;
+	add_list_to_canvas(saved.balls);
+	game->powerups = saved.powerups;
+	add_list_to_canvas(saved.powerups);
+
+	game->state = STATE_RUNNING;
+	reset_input(game);
+	gui_begin_game();
+
+	return TRUE;
+}
+
+/* Puts game, which must be running, back to how it was when savegame_write
+ * made data from it, as for rewinding. Unlike savegame_read this works on
+ * the game as it stands. The blocks that haven't changed, the bat and the
+ * canvas are kept, and only what differs is taken off the canvas or put on
+ * it. Returns FALSE, leaving game alone, if the blob is damaged or from
+ * another game */
+gboolean savegame_restore(Game *game, const guchar *data, gsize len) {
+	SavedGame saved;
+	GList *curr;
+
+	g_assert(game->state == STATE_RUNNING);
+
+	if(!read_game(data, len, &saved))
+		return FALSE;
+	if(saved.seed != game->seed || saved.endless != game->endless
+			|| saved.fixed_point != game->fixed_point
+			|| saved.difficulty != game->flags->difficulty) {
+		free_saved_game(&saved);
+		return FALSE;
+	}
+
+	game->rng = saved.rng;
+	game->score = saved.score;
+	game->last_newlife_score = saved.last_newlife_score;
+	game->lives = saved.lives;
+	game->powerup_next_level = saved.powerup_next_level;
+
+	/* As in savegame_read, the replay so far no longer leads here */
+	if(game->recording) {
+		destroy_replay(game->recording);
+		game->recording = NULL;
+	}
+
+	/* On another level, the saved one is swapped in, and goes on the
+	 * canvas a frame at a time as a prefetched level does */
+	if(saved.level_no != game->level_no
+			|| !restore_level(game->level, saved.level)) {
+		retire_level(game);
+		game->level = saved.level;
+		game->level_no = saved.level_no;
+		realize_level(saved.level, 0);
+		gui_show_layer(saved.level->layer);
+		gui_new_level(saved.level);
+		prefetch_level(game, saved.level_no + 1);
+	}
+
+	restore_bat(game->bat, saved.bat);
+	destroy_path_cache(game);
+	destroy_ball_list(game->balls);
+	game->balls = saved.balls;
+	for(curr = saved.balls; curr; curr = g_list_next(curr))
+		((Ball *) curr->data)->fixed_point = saved.fixed_point;
+	add_list_to_canvas(saved.balls);
+	destroy_powerup_list(game->powerups);
+	game->powerups = saved.powerups;
+	add_list_to_canvas(saved.powerups);
+
+	reset_input(game);
+
+	return TRUE;
+}
+
+/* Saves game to filename. Returns FALSE, having warned the user, on failure */
+gboolean savegame_save(Game *game, gchar *filename) {
+	GString *out;
+	GError *error = NULL;
+	gboolean ret;
+
+	out = savegame_write(game);
+	ret = g_file_set_contents(filename, out->str, out->len, &error);
+	if(!ret) {
+		gb_warning(_("Cannot save game %s: %s"), filename, error->message);
+		g_error_free(error);
+	}
+	g_string_free(out, TRUE);
+
+	return ret;
+}
+
+/* Restores a game saved by savegame_save. Returns FALSE, having warned the
+ * user, on failure */
+gboolean savegame_load(Game *game, gchar *filename) {
+	GError *error = NULL;
+	gchar *contents;
+	gsize len;
+	gboolean ret;
+
+	if(!g_file_get_contents(filename, &contents, &len, &error)) {
+		gb_warning(_("Cannot read saved game %s: %s"), filename,
+				error->message);
+		g_error_free(error);
+		return FALSE;
+	}
+
+	ret = savegame_read(game, (guchar *) contents, len);
+	if(!ret)
+		gb_warning(_("%s is not a saved game, is damaged, or is from another version"),
+				filename);
+	g_free(contents);
+
+	return ret;
+}
+
+static void write_geometry(GString *out, Geometry *geometry) {
+	binio_put_svarint(out, geometry->x1);
+	binio_put_svarint(out, geometry->y1);
+	binio_put_svarint(out, geometry->x2);
+	binio_put_svarint(out, geometry->y2);
+}
+
+static void write_animation(GString *out, Animation *animation) {
+	gint id;
+
+	id = animation_id(animation);
+	g_assert(id >= 0);
+	binio_put_u8(out, id);
+	binio_put_u8(out, animation->type);
+	binio_put_varint(out, animation->frame_no);
+}
+
+static void write_level(GString *out, Level *level) {
+	Block *block;
+	GList *curr;
+	gint i, run, total, code;
+
+	binio_put_varint(out, level->width);
+	binio_put_varint(out, level->height);
+	binio_put_varint(out, level->difficulty);
+	binio_put_string(out, level->name);
+	binio_put_string(out, level->author);
+	binio_put_string(out, level->levelfile_title);
+	binio_put_varint(out, level->blocks_left);
+
+	total = level->width * level->height;
+	for(i = 0; i < total; i += run) {
+		block = level->blocks[i];
+		code = block ? block->type + 1 : 0;
+		run = 1;
+		if(block && block_is_changing(block)) {
+			binio_put_varint(out, run);
+			binio_put_u8(out, code);
+			write_animation(out, &block->animation);
+			continue;
+		}
+		for(; i + run < total; run++) {
+			block = level->blocks[i + run];
+			if((block ? block->type + 1 : 0) != code
+					|| (block && block_is_changing(block)))
+				break;
+		}
+		binio_put_varint(out, run);
+		binio_put_u8(out, code);
+	}
+
+	binio_put_varint(out, g_list_length(level->active_blocks));
+	for(curr = level->active_blocks; curr; curr = g_list_next(curr))
+		binio_put_varint(out, ((Block *) curr->data)->block_no);
+}
+
+static void write_bat(GString *out, Bat *bat) {
+	GList *curr;
+
+	write_geometry(out, &bat->geometry);
+	binio_put_varint(out, bat->width);
+	binio_put_u8(out, bat->type);
+	binio_put_varint(out, bat->num_lasers_allowed);
+	write_animation(out, &bat->animation);
+
+	binio_put_varint(out, g_list_length(bat->children));
+	for(curr = bat->children; curr; curr = g_list_next(curr)) {
+		write_geometry(out, &((Entity *) curr->data)->geometry);
+		write_animation(out, &((Entity *) curr->data)->animation);
+	}
+}
+
+static void read_geometry(BinReader *reader, Geometry *geometry) {
+	geometry->x1 = binio_get_svarint(reader);
+	geometry->y1 = binio_get_svarint(reader);
+	geometry->x2 = binio_get_svarint(reader);
+	geometry->y2 = binio_get_svarint(reader);
+}
+
+/* Sets reader->error if there's no such animation */
+static void read_animation(BinReader *reader, Animation *animation) {
+	gint id, type, frame_no;
+
+	id = binio_get_u8(reader);
+	type = binio_get_u8(reader);
+	frame_no = binio_get_varint(reader);
+	if(reader->error || !restore_animation(animation, id, type, frame_no)) {
+		reader->error = TRUE;
+		memset(animation, 0, sizeof(Animation));
+	}
+}
+
+/* Returns NULL, and sets reader->error, if the level is damaged */
+static Level *read_level(BinReader *reader) {
+	RawLevel *rawlevel;
+	Level *level;
+	Animation animation;
+	GList *active = NULL;
+	Block *block;
+	gint width, height, difficulty, i, total, run, code;
+	guint64 num_active, block_no;
+
+	width = binio_get_varint(reader);
+	height = binio_get_varint(reader);
+	difficulty = binio_get_varint(reader);
+	if(reader->error || width < MIN_BLOCKS_X || width > MAX_BLOCKS_X
+			|| height < MIN_BLOCKS_Y || height > MAX_BLOCKS_Y) {
+		reader->error = TRUE;
+		return NULL;
+	}
+
+	/* An empty level to put the saved blocks in */
+	rawlevel = new_rawlevel(width, height, difficulty, NULL, NULL, NULL);
+	rawlevel->name = binio_get_string(reader);
+	rawlevel->author = binio_get_string(reader);
+	rawlevel->levelfile_title = binio_get_string(reader);
+	memstats_add_string(MEM_RAWLEVEL_STRING, rawlevel->name);
+	memstats_add_string(MEM_RAWLEVEL_STRING, rawlevel->author);
+	memstats_add_string(MEM_RAWLEVEL_STRING, rawlevel->levelfile_title);
+	rawlevel->blocks = g_malloc0(sizeof(gchar) * width * height);
+	level = new_level(rawlevel);
+	free_rawlevel(rawlevel);
+	level->blocks_left = binio_get_varint(reader);
+
+	total = width * height;
+	for(i = 0; !reader->error && i < total; i += run) {
+		run = binio_get_varint(reader);
+		code = binio_get_u8(reader);
+		if(run < 1 || run > total - i || code > BLOCK_EXPLODE + 1) {
+			reader->error = TRUE;
+		} else if(code == BLOCK_DEAD + 1 || code == BLOCK_STRONG_1_DIE + 1
+				|| code == BLOCK_STRONG_2_DIE + 1
+				|| code == BLOCK_STRONG_3_DIE + 1) {
+			read_animation(reader, &animation);
+			if(run != 1 || reader->error
+					|| !restore_block(level, i, code - 1,
+						&animation))
+				reader->error = TRUE;
+		} else if(code) {
+			for(block_no = i; block_no < (guint64) (i + run); block_no++)
+				restore_block(level, block_no, code - 1, NULL);
+		}
+	}
+
+	/* restore_block made the active list in grid order, but it's iterated
+	 * in the order it was saved in */
+	num_active = binio_get_varint(reader);
+	if(num_active != g_list_length(level->active_blocks))
+		reader->error = TRUE;
+	for(i = 0; !reader->error && i < (gint) num_active; i++) {
+		block_no = binio_get_varint(reader);
+		block = block_no < (guint64) total ? level->blocks[block_no] : NULL;
+		if(!block || !block->active || g_list_find(active, block))
+			reader->error = TRUE;
+		else
+			active = g_list_prepend(active, block);
+	}
+	g_list_free(level->active_blocks);
+	level->active_blocks = g_list_reverse(active);
+
+	if(reader->error) {
+		reap_level(level, total);
+		return NULL;
+	}
+
+	return level;
+}
+
+/* Returns NULL, and sets reader->error, if the bat is damaged */
+static Bat *read_bat(BinReader *reader) {
+	Bat *bat;
+	Entity *laser;
+	guint64 num_lasers, i;
+
+	bat = g_malloc(sizeof(Bat));
+	read_geometry(reader, &bat->geometry);
+	bat->width = binio_get_varint(reader);
+	bat->type = binio_get_u8(reader);
+	bat->num_lasers_allowed = binio_get_varint(reader);
+	read_animation(reader, &bat->animation);
+	if(bat->type != BAT_DEFAULT && bat->type != BAT_LASER
+			&& bat->type != BAT_WIDE)
+		reader->error = TRUE;
+
+	bat->children = NULL;
+	bat->num_lasers = 0;
+	num_lasers = binio_get_varint(reader);
+	for(i = 0; !reader->error && i < num_lasers; i++) {
+		laser = g_malloc(sizeof(Entity));
+		memstats_add(MEM_LASER, sizeof(Entity));
+		read_geometry(reader, &laser->geometry);
+		read_animation(reader, &laser->animation);
+		bat->children = g_list_prepend(bat->children, laser);
+		bat->num_lasers++;
+	}
+	bat->children = g_list_reverse(bat->children);
+
+	if(reader->error) {
+		free_bat(bat);
+		return NULL;
+	}
+
+	return bat;
+}
+
+static GList *read_balls(BinReader *reader) {
+	GList *balls = NULL;
+	Ball *ball;
+	guint64 num_balls, i;
+
+	num_balls = binio_get_varint(reader);
+	for(i = 0; !reader->error && i < num_balls; i++) {
+		ball = g_malloc(sizeof(Ball));
+		memstats_add(MEM_BALL, sizeof(Ball));
+		read_geometry(reader, &ball->geometry);
+		ball->pseudo_x1 = binio_get_double(reader);
+		ball->pseudo_y1 = binio_get_double(reader);
+		ball->speed = binio_get_double(reader);
+		ball->direction = binio_get_double(reader);
+		ball->airtime = binio_get_varint(reader);
+		ball->type = binio_get_u8(reader);
+		read_animation(reader, &ball->animation);
+		if(ball->type != BALL_DEFAULT && ball->type != BALL_STUCK)
+			reader->error = TRUE;
+		balls = g_list_prepend(balls, ball);
+	}
+
+	return g_list_reverse(balls);
+}
+
+static GList *read_powerups(BinReader *reader) {
+	GList *powerups = NULL;
+	Powerup *powerup;
+	guint64 num_powerups, i;
+
+	num_powerups = binio_get_varint(reader);
+	for(i = 0; !reader->error && i < num_powerups; i++) {
+		powerup = g_malloc(sizeof(Powerup));
+		memstats_add(MEM_POWERUP, sizeof(Powerup));
+		read_geometry(reader, &powerup->geometry);
+		powerup->type = binio_get_u8(reader);
+		read_animation(reader, &powerup->animation);
+		if(powerup->type > POWER_WIDEBAT)
+			reader->error = TRUE;
+		powerups = g_list_prepend(powerups, powerup);
+	}
+
+	return g_list_reverse(powerups);
+}
+
+/* Frees a bat that was never put in a game */
+static void free_bat(Bat *bat) {
+	GList *curr;
+
+	for(curr = bat->children; curr; curr = g_list_next(curr)) {
+		memstats_remove(MEM_LASER, sizeof(Entity));
+		g_free(curr->data);
+	}
+	g_list_free(bat->children);
+	g_free(bat);
+}
+
+/* Blocks that are part way through changing have an animation of their own
+ * to save */
+static gboolean block_is_changing(Block *block) {
+	return block->type == BLOCK_DEAD || block->type == BLOCK_STRONG_1_DIE
+		|| block->type == BLOCK_STRONG_2_DIE
+		|| block->type == BLOCK_STRONG_3_DIE;
+}
+
+/* Reads a blob written by savegame_write into saved. Returns FALSE, having
+ * freed whatever was read, if the blob is damaged */
+static gboolean read_game(const guchar *data, gsize len, SavedGame *saved) {
+	BinReader reader;
+	const guchar *magic;
+	guint8 version;
+	gint64 lives;
+	guint64 level_no;
+
+	binio_reader_init(&reader, data, len);
+	magic = binio_get_bytes(&reader, strlen(SAVEGAME_MAGIC));
+	if(!magic || memcmp(magic, SAVEGAME_MAGIC, strlen(SAVEGAME_MAGIC)))
+		return FALSE;
+	version = binio_get_u8(&reader);
+	if(version < 1 || version > SAVEGAME_VERSION)
+		return FALSE;
+
+	saved->seed = binio_get_u32(&reader);
+	saved->rng.state = binio_get_varint(&reader);
+	saved->rng.inc = binio_get_varint(&reader);
+	saved->difficulty = binio_get_u8(&reader);
+	saved->endless = binio_get_u8(&reader) != 0;
+	saved->fixed_point = FALSE;
+	if(version >= 2)
+		saved->fixed_point = binio_get_u8(&reader) != 0;
+	saved->score = binio_get_svarint(&reader);
+	saved->last_newlife_score = binio_get_svarint(&reader);
+	lives = binio_get_svarint(&reader);
+	level_no = binio_get_varint(&reader);
+	saved->powerup_next_level = binio_get_u8(&reader) != 0;
+
+	/* Checked before anything is read in for the game, as a level number
+	 * past the last level, or too big to fit, would have the game look
+	 * for a level that isn't there */
+	if(reader.error || lives < 0 || lives > G_MAXINT
+			|| (saved->difficulty != DIFFICULTY_EASY
+				&& saved->difficulty != DIFFICULTY_MEDIUM
+				&& saved->difficulty != DIFFICULTY_HARD)
+			|| level_no >= (saved->endless ? G_MAXINT
+				: leveldata_num_levels()))
+		return FALSE;
+	saved->lives = lives;
+	saved->level_no = level_no;
+
+	saved->level = read_level(&reader);
+	saved->bat = read_bat(&reader);
+	saved->balls = read_balls(&reader);
+	saved->powerups = read_powerups(&reader);
+
+	if(reader.error || !saved->level || !saved->bat
+			|| reader.pos != reader.len) {
+		free_saved_game(saved);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Frees what read_game read, if it was never put in a game */
+static void free_saved_game(SavedGame *saved) {
+	if(saved->level)
+		reap_level(saved->level,
+				saved->level->width * saved->level->height);
+	if(saved->bat)
+		free_bat(saved->bat);
+	destroy_ball_list(saved->balls);
+	destroy_powerup_list(saved->powerups);
+}
+
+/* Makes bat, which is in the game, the same as saved, and frees saved. The
+ * bat keeps its canvas item, and only its lasers are made again */
+static void restore_bat(Bat *bat, Bat *saved) {
+	GnomeCanvasItem *canvas_item;
+	GList *curr;
+
+	for(curr = bat->children; curr; curr = g_list_next(curr)) {
+		remove_from_canvas((Entity *) curr->data);
+		memstats_remove(MEM_LASER, sizeof(Entity));
+		g_free(curr->data);
+	}
+	g_list_free(bat->children);
+
+	canvas_item = bat->animation.canvas_item;
+	*bat = *saved;
+	bat->animation.canvas_item = canvas_item;
+	g_free(saved);
+
+	update_canvas_position((Entity *) bat);
+	update_canvas_animation((Entity *) bat);
+	add_list_to_canvas(bat->children);
+}
+
+/* Puts each of a list of entities on the canvas */
+static void add_list_to_canvas(GList *entities) {
+	GList *curr;
+
+	for(curr = entities; curr; curr = g_list_next(curr))
+		add_to_canvas((Entity *) curr->data);
+}
+
+/* Forgets any input from before the game was restored */
+static void reset_input(Game *game) {
+	game->fire1_pressed = FALSE;
+	game->fire2_pressed = FALSE;
+	game->kill_ball_pressed = FALSE;
+	game->mouse_move = 0;
+	game->keyboard_move = 0;
+}
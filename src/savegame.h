@@ -0,0 +1,14 @@
+/*
+ * Saving and restoring games in progress
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+GString *savegame_write(Game *game);
+gboolean savegame_read(Game *game, const guchar *data, gsize len);
+gboolean savegame_restore(Game *game, const guchar *data, gsize len);
+gboolean savegame_save(Game *game, gchar *filename);
+gboolean savegame_load(Game *game, gchar *filename);
@@ -0,0 +1,174 @@
+/*
+ * Times each part of main, from the top of it until the title has first
+ * been drawn. With --trace-startup a line is printed for each part once the
+ * title is up, and with --exit-after-paint the game quits there as well, so
+ * that starting up can be timed over and over (see bench-startup.c).
+ *
+ * Along with the time, each part gets what Linux keeps count of for a
+ * process: the read and write calls (read_calls, write_calls) and bytes
+ * read from /proc/self/io, and the page faults from getrusage, the major
+ * ones being what makes a cold start slow. open_fds is how many files are
+ * open at the end of the part, from /proc/self/fd; it is not how many were
+ * opened. Taking each of these costs a couple of reads, which are counted
+ * in the part after it. bench-startup -s counts every system call and
+ * every file opened in each part, by running the game under strace and
+ * splitting the trace where each mark opens /proc/self/io.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "startup.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+/* The most parts that are kept track of */
+#define MAX_PHASES 16
+
+/* Internal Data Structures */
+typedef struct {
+	const gchar *name; /* The part that ended here */
+	gint64 ns; /* The monotonic clock */
+	gint64 cpu_ns; /* User and system time */
+	glong syscr, syscw, rchar; /* -1 where /proc/self/io can't be read */
+	glong majflt, minflt;
+	gint fds; /* -1 if /proc/self/fd can't be read */
+} Mark;
+
+/* Internal Functions */
+static void take_mark(Mark *mark, const gchar *name);
+static void read_io(Mark *mark);
+static gint count_fds(void);
+static void print_report(void);
+
+/* Internal Variables */
+static Mark marks[MAX_PHASES + 1];
+static gint num_marks = 0;
+static gboolean report_wanted = FALSE;
+static gboolean exit_wanted = FALSE;
+static gboolean painted = FALSE;
+
+/* Starts the clock. Should be the first thing main does */
+void startup_begin(void) {
+	num_marks = 0;
+	take_mark(&marks[num_marks++], NULL);
+}
+
+/* Notes that the part of starting up called name has just finished */
+void startup_phase(const gchar *name) {
+	if(num_marks == 0 || num_marks > MAX_PHASES)
+		return;
+
+	take_mark(&marks[num_marks++], name);
+}
+
+/* Sets whether startup_first_paint prints the times, and whether it quits
+ * the game afterwards. Quitting implies printing */
+void startup_set_report(gboolean report, gboolean exit_after_paint) {
+	report_wanted = report || exit_after_paint;
+	exit_wanted = exit_after_paint;
+}
+
+/* Called each time the canvas has been drawn. The first time, this ends the
+ * last part of starting up, and does what startup_set_report asked */
+void startup_first_paint(void) {
+	if(painted)
+		return;
+	painted = TRUE;
+
+	gdk_flush();
+	startup_phase("first_paint");
+
+	if(report_wanted)
+		print_report();
+	if(exit_wanted)
+		gtk_main_quit();
+}
+
+static void take_mark(Mark *mark, const gchar *name) {
+	struct timespec ts;
+	struct rusage usage;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	getrusage(RUSAGE_SELF, &usage);
+
+	mark->name = name;
+	mark->ns = (gint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+	mark->cpu_ns = ((gint64) usage.ru_utime.tv_sec
+			+ usage.ru_stime.tv_sec) * 1000000000
+		+ ((gint64) usage.ru_utime.tv_usec + usage.ru_stime.tv_usec)
+		* 1000;
+	mark->majflt = usage.ru_majflt;
+	mark->minflt = usage.ru_minflt;
+	read_io(mark);
+	mark->fds = count_fds();
+}
+
+/* Fills in the read and write call counts, and the bytes read, from
+ * /proc/self/io. bench-startup -s splits its trace of the game at each
+ * open of this file, so it must be opened once a mark, whether or not the
+ * counts are wanted */
+static void read_io(Mark *mark) {
+	FILE *fp;
+	gchar line[128];
+
+	mark->syscr = mark->syscw = mark->rchar = -1;
+
+	fp = fopen("/proc/self/io", "r");
+	if(!fp)
+		return;
+	while(fgets(line, sizeof(line), fp)) {
+		sscanf(line, "syscr: %ld", &mark->syscr);
+		sscanf(line, "syscw: %ld", &mark->syscw);
+		sscanf(line, "rchar: %ld", &mark->rchar);
+	}
+	fclose(fp);
+}
+
+/* Returns how many files the process has open, not counting the one used to
+ * find out */
+static gint count_fds(void) {
+	GDir *dir;
+	gint fds = 0;
+
+	dir = g_dir_open("/proc/self/fd", 0, NULL);
+	if(!dir)
+		return -1;
+	while(g_dir_read_name(dir))
+		fds++;
+	g_dir_close(dir);
+
+	return fds - 1;
+}
+
+/* Prints a line for each part, and one for the whole of starting up */
+static void print_report(void) {
+	Mark *prev, *curr;
+	gint i;
+
+	for(i = 1; i <= num_marks; i++) {
+		prev = &marks[i == num_marks ? 0 : i - 1];
+		curr = &marks[i == num_marks ? num_marks - 1 : i];
+
+		g_print("startup phase=%s ms=%.2f cpu_ms=%.2f",
+				i == num_marks ? "total" : curr->name,
+				(curr->ns - prev->ns) / 1e6,
+				(curr->cpu_ns - prev->cpu_ns) / 1e6);
+		if(curr->syscr >= 0 && prev->syscr >= 0)
+			g_print(" read_calls=%ld write_calls=%ld read_kb=%ld",
+					curr->syscr - prev->syscr,
+					curr->syscw - prev->syscw,
+					(curr->rchar - prev->rchar) / 1024);
+		g_print(" majflt=%ld minflt=%ld", curr->majflt - prev->majflt,
+				curr->minflt - prev->minflt);
+		if(curr->fds >= 0)
+			g_print(" open_fds=%d", curr->fds);
+		g_print("\n");
+	}
+}
@@ -0,0 +1,13 @@
+/*
+ * Timing of the parts of starting the game up
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+void startup_begin(void);
+void startup_phase(const gchar *name);
+void startup_set_report(gboolean report, gboolean exit_after_paint);
+void startup_first_paint(void);
@@ -0,0 +1,286 @@
+/*
+ * Hashing the state of a game. Replays hold the hash after every tick, so
+ * that playing one back can tell exactly when, and in what, a game stopped
+ * doing what it did when it was recorded. See replay.c.
+ *
+ * This has to be cheap, as it happens every tick. The balls, bat and
+ * powerups are few, and are hashed afresh. The block grid can be big, so its
+ * hash is kept up to date by block.c as blocks change: it's the XOR of
+ * statehash_block for every block in the level.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "statehash.h"
+#include <string.h>
+
+#define FNV_OFFSET 2166136261U
+#define FNV_PRIME 16777619U
+
+/* Internal Functions */
+static guint32 hash_int(guint32 hash, guint32 value);
+static guint32 hash_double(guint32 hash, gdouble value);
+static guint32 hash_geometry(guint32 hash, Geometry *geometry);
+static guint32 hash_balls(Game *game);
+static guint32 hash_bat(Game *game);
+static guint32 hash_powerups(Game *game);
+static guint32 hash_blocks(Game *game);
+static guint32 hash_player(Game *game);
+static guint32 hash_rng(Game *game);
+static void describe_geometry(GString *out, Geometry *geometry);
+
+/* Internal Variables */
+static const gchar *part_names[NUM_HASH_PARTS] = {
+	"balls", "bat", "powerups", "blocks", "player", "rng"
+};
+
+/* Hashes every part of game's state into hash */
+void statehash_compute(Game *game, StateHash *hash) {
+	hash->part[HASH_BALLS] = hash_balls(game);
+	hash->part[HASH_BAT] = hash_bat(game);
+	hash->part[HASH_POWERUPS] = hash_powerups(game);
+	hash->part[HASH_BLOCKS] = hash_blocks(game);
+	hash->part[HASH_PLAYER] = hash_player(game);
+	hash->part[HASH_RNG] = hash_rng(game);
+}
+
+/* What a block of type type at block_no contributes to its level's
+ * block_hash. This is the murmur3 finaliser, so that XORing these together
+ * doesn't cancel out in any obvious way */
+guint32 statehash_block(gint block_no, BlockType type) {
+	guint32 h;
+
+	h = ((guint32) block_no << 4) | (guint32) type;
+	h ^= h >> 16;
+	h *= 0x85ebca6bU;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35U;
+	h ^= h >> 16;
+
+	return h;
+}
+
+/* Returns a description of one part of game's state, a thing per line, for
+ * showing what changed when the hashes differ. Free it with g_free */
+gchar *statehash_describe(Game *game, HashPart part) {
+	GString *out;
+	GList *curr;
+	Ball *ball;
+	Powerup *powerup;
+	Block *block;
+	gint i;
+
+	out = g_string_new(NULL);
+	switch(part) {
+		case HASH_BALLS :
+			for(curr = game->balls, i = 0; curr;
+					curr = g_list_next(curr), i++) {
+				ball = (Ball *) curr->data;
+				g_string_append_printf(out, "ball %d: ", i);
+				describe_geometry(out, &ball->geometry);
+				g_string_append_printf(out, " pseudo %.17g,%.17g "
+						"speed %.17g direction %.17g "
+						"airtime %d type %d frame %d\n",
+						ball->pseudo_x1, ball->pseudo_y1,
+						ball->speed, ball->direction,
+						ball->airtime, ball->type,
+						ball->animation.frame_no);
+			}
+			break;
+		case HASH_BAT :
+			if(game->bat) {
+				g_string_append(out, "bat: ");
+				describe_geometry(out, &game->bat->geometry);
+				g_string_append_printf(out, " width %d type %d "
+						"lasers %d/%d\n",
+						game->bat->width, game->bat->type,
+						game->bat->num_lasers,
+						game->bat->num_lasers_allowed);
+				for(curr = game->bat->children, i = 0; curr;
+						curr = g_list_next(curr), i++) {
+					g_string_append_printf(out, "laser %d: ", i);
+					describe_geometry(out,
+						&((Entity *) curr->data)->geometry);
+					g_string_append_c(out, '\n');
+				}
+			}
+			break;
+		case HASH_POWERUPS :
+			for(curr = game->powerups, i = 0; curr;
+					curr = g_list_next(curr), i++) {
+				powerup = (Powerup *) curr->data;
+				g_string_append_printf(out, "powerup %d: ", i);
+				describe_geometry(out, &powerup->geometry);
+				g_string_append_printf(out, " type %d\n",
+						powerup->type);
+			}
+			break;
+		case HASH_BLOCKS :
+			if(game->level) {
+				g_string_append_printf(out, "blocks left: %d\n",
+						game->level->blocks_left);
+				for(i = 0; i < game->level->width
+						* game->level->height; i++) {
+					block = game->level->blocks[i];
+					if(block)
+						g_string_append_printf(out,
+							"block %d,%d: type %d "
+							"frame %d\n",
+							i % game->level->width,
+							i / game->level->width,
+							block->type,
+							block->animation.frame_no);
+				}
+			}
+			break;
+		case HASH_PLAYER :
+			g_string_append_printf(out, "state: %d\nscore: %d\n"
+					"last new life score: %d\nlives: %d\n"
+					"level: %d\nnext level pending: %d\n",
+					game->state, game->score,
+					game->last_newlife_score, game->lives,
+					game->level_no,
+					game->powerup_next_level);
+			break;
+		case HASH_RNG :
+			g_string_append_printf(out, "rng: %" G_GUINT64_FORMAT
+					" %" G_GUINT64_FORMAT "\n",
+					game->rng.state, game->rng.inc);
+			break;
+		default :
+			g_assert_not_reached();
+	}
+
+	return g_string_free(out, FALSE);
+}
+
+const gchar *statehash_part_name(HashPart part) {
+	g_assert(part < NUM_HASH_PARTS);
+
+	return part_names[part];
+}
+
+/* FNV-1a, a word at a time rather than a byte at a time */
+static guint32 hash_int(guint32 hash, guint32 value) {
+	return (hash ^ value) * FNV_PRIME;
+}
+
+/* Hashes the exact bits of value. This is what's wanted: the game is only
+ * deterministic if the floating point maths comes out exactly the same */
+static guint32 hash_double(guint32 hash, gdouble value) {
+	guint64 bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	hash = hash_int(hash, (guint32) bits);
+	return hash_int(hash, (guint32) (bits >> 32));
+}
+
+static guint32 hash_geometry(guint32 hash, Geometry *geometry) {
+	hash = hash_int(hash, geometry->x1);
+	hash = hash_int(hash, geometry->y1);
+	hash = hash_int(hash, geometry->x2);
+	return hash_int(hash, geometry->y2);
+}
+
+static guint32 hash_balls(Game *game) {
+	guint32 hash = FNV_OFFSET;
+	GList *curr;
+	Ball *ball;
+
+	for(curr = game->balls; curr; curr = g_list_next(curr)) {
+		ball = (Ball *) curr->data;
+		hash = hash_geometry(hash, &ball->geometry);
+		hash = hash_double(hash, ball->pseudo_x1);
+		hash = hash_double(hash, ball->pseudo_y1);
+		hash = hash_double(hash, ball->speed);
+		hash = hash_double(hash, ball->direction);
+		hash = hash_int(hash, ball->airtime);
+		hash = hash_int(hash, ball->type);
+		hash = hash_int(hash, ball->animation.frame_no);
+	}
+
+	return hash;
+}
+
+static guint32 hash_bat(Game *game) {
+	guint32 hash = FNV_OFFSET;
+	GList *curr;
+
+	if(!game->bat)
+		return hash;
+
+	hash = hash_geometry(hash, &game->bat->geometry);
+	hash = hash_int(hash, game->bat->width);
+	hash = hash_int(hash, game->bat->type);
+	hash = hash_int(hash, game->bat->num_lasers);
+	hash = hash_int(hash, game->bat->num_lasers_allowed);
+	for(curr = game->bat->children; curr; curr = g_list_next(curr))
+		hash = hash_geometry(hash, &((Entity *) curr->data)->geometry);
+
+	return hash;
+}
+
+static guint32 hash_powerups(Game *game) {
+	guint32 hash = FNV_OFFSET;
+	GList *curr;
+	Powerup *powerup;
+
+	for(curr = game->powerups; curr; curr = g_list_next(curr)) {
+		powerup = (Powerup *) curr->data;
+		hash = hash_geometry(hash, &powerup->geometry);
+		hash = hash_int(hash, powerup->type);
+	}
+
+	return hash;
+}
+
+/* The grid itself is covered by block_hash. Only the blocks that are
+ * animating can be part way through changing, so only their frames are
+ * hashed */
+static guint32 hash_blocks(Game *game) {
+	guint32 hash = FNV_OFFSET;
+	GList *curr;
+	Block *block;
+
+	if(!game->level)
+		return hash;
+
+	hash = hash_int(hash, game->level->block_hash);
+	hash = hash_int(hash, game->level->blocks_left);
+	for(curr = game->level->active_blocks; curr; curr = g_list_next(curr)) {
+		block = (Block *) curr->data;
+		hash = hash_int(hash, block->block_no);
+		hash = hash_int(hash, block->animation.frame_no);
+	}
+
+	return hash;
+}
+
+static guint32 hash_player(Game *game) {
+	guint32 hash = FNV_OFFSET;
+
+	hash = hash_int(hash, game->state);
+	hash = hash_int(hash, game->score);
+	hash = hash_int(hash, game->last_newlife_score);
+	hash = hash_int(hash, game->lives);
+	hash = hash_int(hash, game->level_no);
+	return hash_int(hash, game->powerup_next_level);
+}
+
+static guint32 hash_rng(Game *game) {
+	guint32 hash = FNV_OFFSET;
+
+	hash = hash_int(hash, (guint32) game->rng.state);
+	hash = hash_int(hash, (guint32) (game->rng.state >> 32));
+	hash = hash_int(hash, (guint32) game->rng.inc);
+	return hash_int(hash, (guint32) (game->rng.inc >> 32));
+}
+
+static void describe_geometry(GString *out, Geometry *geometry) {
+	g_string_append_printf(out, "%d,%d-%d,%d", geometry->x1, geometry->y1,
+			geometry->x2, geometry->y2);
+}
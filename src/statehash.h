@@ -0,0 +1,23 @@
+/*
+ * Hashing the state of a game, for finding where replays go out of sync
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+/* The parts of the game's state, each hashed separately so that a desync can
+ * be narrowed down to the part that went wrong */
+typedef enum { HASH_BALLS, HASH_BAT, HASH_POWERUPS, HASH_BLOCKS, HASH_PLAYER,
+	HASH_RNG, NUM_HASH_PARTS
+} HashPart;
+
+typedef struct {
+	guint32 part[NUM_HASH_PARTS];
+} StateHash;
+
+void statehash_compute(Game *game, StateHash *hash);
+guint32 statehash_block(gint block_no, BlockType type);
+gchar *statehash_describe(Game *game, HashPart part);
+const gchar *statehash_part_name(HashPart part);
@@ -0,0 +1,236 @@
+/*
+ * Writes a trace of what the game does, in the Trace Event Format that
+ * chrome://tracing and Perfetto read: spans for the parts of each frame,
+ * and instants for things like blocks being hit and lives being lost. A
+ * histogram of frame times shows that some frames are slow, and this shows
+ * what those frames were doing.
+ *
+ * Tracing is off unless the game is run with --trace, and then each event
+ * costs a test of trace_enabled. While on, each thread adds its events to a
+ * buffer of its own, so that threads never wait on each other. Full buffers,
+ * and those of threads that have finished, are handed to a writer thread,
+ * which turns them into JSON and writes them out, so that the game doesn't
+ * wait on the disk either. The main thread's last buffer is handed over by
+ * trace_stop. Events still buffered by other threads when the trace stops
+ * are dropped.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "trace.h"
+#include "util.h"
+#include <stdio.h>
+#include <unistd.h>
+
+/* How many events a thread buffers before handing them to the writer */
+#define BUFFER_EVENTS 4096
+
+/* Internal Data Structures */
+typedef struct {
+	const gchar *name; /* For 'M', the thread's name */
+	const gchar *arg_name; /* NULL if there's no arg */
+	gint64 ns;
+	gint arg;
+	gchar phase; /* 'B', 'E' or 'i', or 'M' to name a thread */
+} TraceEvent;
+
+typedef struct {
+	gint tid;
+	GArray *events; /* Contains TraceEvents */
+} TraceBuffer;
+
+/* Internal Functions */
+static TraceBuffer *new_buffer(gint tid);
+static TraceBuffer *get_buffer(void);
+static void hand_off_buffer(gpointer data);
+static void free_buffer(TraceBuffer *buffer);
+static gpointer writer_thread(gpointer data);
+static void write_buffer(TraceBuffer *buffer);
+
+/* Internal Variables */
+gint trace_enabled = FALSE;
+
+static GPrivate thread_buffer = G_PRIVATE_INIT(hand_off_buffer);
+static GMutex queue_lock; /* Guards queue, which threads hand off to */
+static GAsyncQueue *queue = NULL;
+static TraceBuffer stop_marker; /* Tells the writer to finish */
+static GThread *writer = NULL;
+static FILE *trace_fp;
+static gint64 start_ns;
+static gint next_tid = 1;
+static gboolean first_event;
+
+/* Starts writing a trace to filename. Returns FALSE, having warned why, if
+ * the file can't be written */
+gboolean trace_start(const gchar *filename) {
+	g_assert(!writer);
+
+	trace_fp = fopen(filename, "w");
+	if(!trace_fp) {
+		gb_warning(_("Cannot write trace to %s"), filename);
+		return FALSE;
+	}
+	fputs("{\"traceEvents\":[\n", trace_fp);
+	first_event = TRUE;
+	start_ns = now_ns();
+
+	queue = g_async_queue_new();
+	writer = g_thread_new("trace", writer_thread, g_async_queue_ref(queue));
+	g_atomic_int_set(&trace_enabled, TRUE);
+	trace_name_thread("main");
+
+	return TRUE;
+}
+
+/* Stops tracing, and waits for everything the main thread has traced to be
+ * written out. Must be called from the thread that called trace_start */
+void trace_stop(void) {
+	if(!writer)
+		return;
+
+	g_atomic_int_set(&trace_enabled, FALSE);
+	g_private_replace(&thread_buffer, NULL);
+
+	g_mutex_lock(&queue_lock);
+	g_async_queue_push(queue, &stop_marker);
+	g_async_queue_unref(queue);
+	queue = NULL;
+	g_mutex_unlock(&queue_lock);
+
+	g_thread_join(writer);
+	writer = NULL;
+
+	fputs("\n],\"displayTimeUnit\":\"ms\"}\n", trace_fp);
+	if(fclose(trace_fp) != 0)
+		gb_warning(_("Error while writing trace"));
+	trace_fp = NULL;
+}
+
+/* Gives the calling thread a name in the trace. name must be a string
+ * constant */
+void trace_name_thread(const gchar *name) {
+	if(trace_enabled)
+		trace_event('M', name, NULL, 0);
+}
+
+/* Adds an event to the calling thread's buffer. Use the TRACE_ macros rather
+ * than calling this */
+void trace_event(gchar phase, const gchar *name, const gchar *arg_name,
+		gint arg) {
+	TraceBuffer *buffer;
+	TraceEvent event;
+
+	event.name = name;
+	event.arg_name = arg_name;
+	event.ns = now_ns();
+	event.arg = arg;
+	event.phase = phase;
+
+	buffer = get_buffer();
+	g_array_append_val(buffer->events, event);
+	if(buffer->events->len >= BUFFER_EVENTS) {
+		g_private_set(&thread_buffer, new_buffer(buffer->tid));
+		hand_off_buffer(buffer);
+	}
+}
+
+static TraceBuffer *new_buffer(gint tid) {
+	TraceBuffer *buffer;
+
+	buffer = g_malloc(sizeof(TraceBuffer));
+	buffer->tid = tid;
+	buffer->events = g_array_sized_new(FALSE, FALSE, sizeof(TraceEvent),
+			BUFFER_EVENTS);
+
+	return buffer;
+}
+
+/* Returns the calling thread's buffer, giving it one, and a number of its
+ * own, if it has none yet */
+static TraceBuffer *get_buffer(void) {
+	TraceBuffer *buffer;
+
+	buffer = (TraceBuffer *) g_private_get(&thread_buffer);
+	if(!buffer) {
+		buffer = new_buffer(g_atomic_int_add(&next_tid, 1));
+		g_private_set(&thread_buffer, buffer);
+	}
+
+	return buffer;
+}
+
+/* Gives a buffer to the writer, or throws it away if the trace has been
+ * stopped. Also called as each thread finishes */
+static void hand_off_buffer(gpointer data) {
+	TraceBuffer *buffer = (TraceBuffer *) data;
+
+	g_mutex_lock(&queue_lock);
+	if(queue) {
+		g_async_queue_push(queue, buffer);
+		buffer = NULL;
+	}
+	g_mutex_unlock(&queue_lock);
+
+	if(buffer)
+		free_buffer(buffer);
+}
+
+static void free_buffer(TraceBuffer *buffer) {
+	g_array_free(buffer->events, TRUE);
+	g_free(buffer);
+}
+
+/* Body of the writer thread. Writes out buffers as they are handed off until
+ * trace_stop says to finish */
+static gpointer writer_thread(gpointer data) {
+	GAsyncQueue *writer_queue = (GAsyncQueue *) data;
+	TraceBuffer *buffer;
+
+	while((buffer = g_async_queue_pop(writer_queue)) != &stop_marker) {
+		write_buffer(buffer);
+		free_buffer(buffer);
+	}
+	g_async_queue_unref(writer_queue);
+
+	return NULL;
+}
+
+/* Writes out each event in buffer as a JSON object. Times are in
+ * microseconds from the start of the trace */
+static void write_buffer(TraceBuffer *buffer) {
+	TraceEvent *event;
+	guint i;
+	gint pid;
+
+	pid = getpid();
+	for(i = 0; i < buffer->events->len; i++) {
+		event = &g_array_index(buffer->events, TraceEvent, i);
+		if(!first_event)
+			fputs(",\n", trace_fp);
+		first_event = FALSE;
+
+		if(event->phase == 'M') {
+			fprintf(trace_fp, "{\"name\":\"thread_name\",\"ph\":\"M\","
+					"\"pid\":%d,\"tid\":%d,"
+					"\"args\":{\"name\":\"%s\"}}",
+					pid, buffer->tid, event->name);
+			continue;
+		}
+
+		fprintf(trace_fp, "{\"name\":\"%s\",\"ph\":\"%c\","
+				"\"ts\":%.3f,\"pid\":%d,\"tid\":%d",
+				event->name, event->phase,
+				(event->ns - start_ns) / 1e3, pid,
+				buffer->tid);
+		if(event->phase == 'i')
+			fputs(",\"s\":\"t\"", trace_fp);
+		if(event->arg_name)
+			fprintf(trace_fp, ",\"args\":{\"%s\":%d}",
+					event->arg_name, event->arg);
+		fputc('}', trace_fp);
+	}
+}
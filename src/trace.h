@@ -0,0 +1,31 @@
+/*
+ * Tracing what the game does over time, for chrome://tracing
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+/* TRUE while a trace is being written. Only to be read by the macros below,
+ * which are all that is done when tracing is off */
+extern gint trace_enabled;
+
+/* Spans, which must be ended on the thread they began on, in the order they
+ * were begun. name must be a string constant */
+#define TRACE_BEGIN(name) \
+	do { if(trace_enabled) trace_event('B', name, NULL, 0); } while(0)
+#define TRACE_END(name) \
+	do { if(trace_enabled) trace_event('E', name, NULL, 0); } while(0)
+
+/* Something that happened at a moment, along with a number saying more about
+ * it, called arg_name. Both names must be string constants */
+#define TRACE_INSTANT(name, arg_name, arg) \
+	do { if(trace_enabled) trace_event('i', name, arg_name, arg); } \
+	while(0)
+
+gboolean trace_start(const gchar *filename);
+void trace_stop(void);
+void trace_name_thread(const gchar *name);
+void trace_event(gchar phase, const gchar *name, const gchar *arg_name,
+		gint arg);
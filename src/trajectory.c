@@ -0,0 +1,342 @@
+/*
+ * Works out the path a ball will take, by moving a copy of it through the
+ * level with the same functions collision.c and ball.c use for the real
+ * thing, off the walls and the blocks, until it gets down to a given line
+ * (normally the top of the bat) or has gone a given number of ticks. The
+ * bounces have no entropy added, so with a bounce_entropy of 0 the path is
+ * exactly the one the ball takes.
+ *
+ * Working a path out means a block lookup for every tick of it, so they are
+ * kept, one per ball, and handed out again on later ticks for as long as the
+ * ball is where its path said it would be and none of the blocks that the
+ * path went off (or past, for the neighbours collision.c looks at on a
+ * corner hit) have changed. Blocks only ever go away during a level, so the
+ * empty spaces the path went through don't need watching.
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+#include "breakout.h"
+#include "ball.h"
+#include "block.h"
+#include "collision.h"
+#include "trajectory.h"
+
+/* Flags for what a path has done to each block */
+#define CELL_WATCHED 1
+#define CELL_KILLED 2
+
+/* Internal Data Structures */
+typedef struct {
+	gint block_no;
+	Block *block; /* NULL if there was none */
+	BlockType type;
+} WatchedBlock;
+
+typedef struct {
+	Ball *ball;
+	Level *level;
+	gint line_y;
+	guint start_tick; /* game->ticks when the path was worked out */
+	guint used_tick;
+	PathPoint start;
+	GArray *points; /* Contains PathPoints */
+	GArray *watched; /* Contains WatchedBlocks */
+	PathEnd end;
+} CachedPath;
+
+struct _PathCache {
+	GList *paths; /* Contains CachedPaths */
+};
+
+/* Internal Functions */
+static CachedPath *find_path(PathCache *cache, Game *game, Ball *ball);
+static gboolean path_still_good(CachedPath *cached, Game *game, Ball *ball,
+		gint line_y, gint max_ticks);
+static void work_out_path(CachedPath *cached, Game *game, Ball *ball,
+		gint line_y, gint max_ticks);
+static void watch_block(CachedPath *cached, guint8 *cells, Level *level,
+		gint block_no);
+static void set_point(PathPoint *point, Ball *ball);
+static gboolean at_point(PathPoint *point, Ball *ball);
+static void free_path(CachedPath *cached);
+
+/* Fills in path with where ball will go over the next max_ticks ticks, or
+ * until its bottom reaches line_y. The points belong to the cache, and are
+ * only good until the game next moves on. Returns FALSE, and leaves path
+ * alone, for a ball that isn't moving */
+gboolean predict_path(Game *game, Ball *ball, gint line_y, gint max_ticks,
+		BallPath *path) {
+	CachedPath *cached;
+	guint offset;
+
+	if(ball->type != BALL_DEFAULT || !game->level)
+		return FALSE;
+
+	if(!game->path_cache)
+		game->path_cache = g_malloc0(sizeof(PathCache));
+	cached = find_path(game->path_cache, game, ball);
+	/* A ball that doesn't come down within max_ticks is looked at twice
+	 * as far ahead, so that the path does for the next max_ticks ticks
+	 * rather than having to be worked out again every tick */
+	if(!path_still_good(cached, game, ball, line_y, max_ticks))
+		work_out_path(cached, game, ball, line_y, max_ticks * 2);
+	cached->used_tick = game->ticks;
+
+	offset = game->ticks - cached->start_tick;
+	path->points = &g_array_index(cached->points, PathPoint, offset);
+	path->num_points = cached->points->len - offset;
+	path->end = cached->end;
+	if(path->num_points > max_ticks) {
+		path->num_points = max_ticks;
+		path->end = PATH_TICKS;
+	}
+
+	return TRUE;
+}
+
+void destroy_path_cache(Game *game) {
+	GList *curr;
+
+	if(!game->path_cache)
+		return;
+
+	for(curr = game->path_cache->paths; curr; curr = g_list_next(curr))
+		free_path((CachedPath *) curr->data);
+	g_list_free(game->path_cache->paths);
+	g_free(game->path_cache);
+	game->path_cache = NULL;
+}
+
+/* Finds the path kept for ball, or makes an empty one. Paths that haven't
+ * been asked for since the last tick are thrown away on the way, as their
+ * balls have probably gone */
+static CachedPath *find_path(PathCache *cache, Game *game, Ball *ball) {
+	GList *curr, *next;
+	CachedPath *cached, *found = NULL;
+
+	for(curr = cache->paths; curr; curr = next) {
+		next = g_list_next(curr);
+		cached = (CachedPath *) curr->data;
+		if(cached->ball == ball) {
+			found = cached;
+		} else if(cached->used_tick + 1 < game->ticks
+				|| cached->used_tick > game->ticks) {
+			free_path(cached);
+			cache->paths = g_list_delete_link(cache->paths, curr);
+		}
+	}
+
+	if(!found) {
+		found = g_malloc0(sizeof(CachedPath));
+		found->ball = ball;
+		found->points = g_array_new(FALSE, FALSE, sizeof(PathPoint));
+		found->watched = g_array_new(FALSE, FALSE,
+				sizeof(WatchedBlock));
+		cache->paths = g_list_prepend(cache->paths, found);
+	}
+
+	return found;
+}
+
+/* Whether the path kept in cached can still be used. The ball has to be
+ * where it was meant to be by now, and the path has to still go far enough
+ * and not have had any of the blocks it depends on changed */
+static gboolean path_still_good(CachedPath *cached, Game *game, Ball *ball,
+		gint line_y, gint max_ticks) {
+	WatchedBlock *watched;
+	guint offset, i;
+
+	if(cached->level != game->level || cached->line_y != line_y
+			|| game->ticks < cached->start_tick)
+		return FALSE;
+
+	offset = game->ticks - cached->start_tick;
+	if(offset >= cached->points->len)
+		return FALSE;
+	if(offset == 0 && !at_point(&cached->start, ball))
+		return FALSE;
+	if(offset > 0 && !at_point(&g_array_index(cached->points, PathPoint,
+				offset - 1), ball))
+		return FALSE;
+	if(cached->end == PATH_TICKS
+			&& cached->points->len - offset < (guint) max_ticks)
+		return FALSE;
+
+	for(i = 0; i < cached->watched->len; i++) {
+		watched = &g_array_index(cached->watched, WatchedBlock, i);
+		if(game->level->blocks[watched->block_no] != watched->block)
+			return FALSE;
+		if(watched->block && watched->block->type != watched->type)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Moves a copy of ball on, tick by tick, as iterate_ball_default would, but
+ * stopping at line_y rather than bouncing off the bat */
+static void work_out_path(CachedPath *cached, Game *game, Ball *ball,
+		gint line_y, gint max_ticks) {
+	gint block_nos[MAX_TOUCHED_BLOCKS];
+	Ball copy;
+	Block *block;
+	PathPoint point;
+	Contact contact;
+	Side side;
+	guint8 *cells;
+	gint old_x1, old_y1, num_blocks, i, j;
+	gdouble old_direction;
+	gboolean hit, killed;
+
+	cached->level = game->level;
+	cached->line_y = line_y;
+	cached->start_tick = game->ticks;
+	set_point(&cached->start, ball);
+	g_array_set_size(cached->points, 0);
+	g_array_set_size(cached->watched, 0);
+	cached->end = PATH_TICKS;
+
+	/* The copy mustn't move the real ball about on the canvas */
+	copy = *ball;
+	copy.animation.canvas_item = NULL;
+
+	/* What the path has done to each block in the level so far. The real
+	 * ball would go straight through a block the path has knocked out if
+	 * it came back that way, but find_touched_blocks still sees it, so the
+	 * path gives up there. It gives up too if it hits another block in
+	 * the tick that it knocks one out, as the one knocked out would no
+	 * longer cover the edge it shared with the other */
+	cells = g_new0(guint8, game->level->width * game->level->height);
+
+	for(i = 0; i < max_ticks; i++) {
+		old_x1 = copy.geometry.x1;
+		old_y1 = copy.geometry.y1;
+		old_direction = copy.direction;
+
+		move_ball(&copy);
+
+		num_blocks = find_touched_blocks(game, &copy, block_nos);
+		hit = killed = FALSE;
+		for(j = 0; j < num_blocks; j++) {
+			block = game->level->blocks[block_nos[j]];
+			watch_block(cached, cells, game->level,
+					block->block_no);
+			watch_block(cached, cells, game->level,
+					block->block_no - game->level->width);
+			watch_block(cached, cells, game->level,
+					block->block_no + game->level->width);
+			if(block->block_no % game->level->width > 0)
+				watch_block(cached, cells, game->level,
+						block->block_no - 1);
+			if(block->block_no % game->level->width
+					< game->level->width - 1)
+				watch_block(cached, cells, game->level,
+						block->block_no + 1);
+
+			if(cells[block->block_no] & CELL_KILLED
+					|| block->type == BLOCK_EXPLODE) {
+				cached->end = PATH_UNSURE;
+				break;
+			}
+
+			if(ball_block_contact(game, block, &copy, &contact)) {
+				if(killed) {
+					cached->end = PATH_UNSURE;
+					break;
+				}
+				if(block->type == BLOCK_DEFAULT
+						|| block->type
+						== BLOCK_STRONG_1_DIE) {
+					cells[block->block_no] |= CELL_KILLED;
+					killed = TRUE;
+				}
+
+				increase_ball_speed(game, &copy);
+				resolve_contact(&copy, &contact);
+				hit = TRUE;
+			}
+		}
+		if(cached->end == PATH_UNSURE)
+			break;
+
+		if(!hit) {
+			if(copy.geometry.y2 >= line_y) {
+				set_point(&point, &copy);
+				g_array_append_val(cached->points, point);
+				cached->end = PATH_LINE;
+				break;
+			}
+
+			side = ball_wall_side(game->level, &copy);
+			if(side != SIDE_NONE) {
+				bounce_ball(&copy, side);
+				keep_ball_in(game->level, &copy);
+			} else if(copy.geometry.y2 > GAME_HEIGHT(game->level)) {
+				set_point(&point, &copy);
+				g_array_append_val(cached->points, point);
+				cached->end = PATH_LOST;
+				break;
+			}
+		}
+
+		if(copy.airtime < MAX_AIRTIME) {
+			copy.airtime++;
+		} else {
+			cached->end = PATH_UNSURE;
+			break;
+		}
+
+		/* iterate_ball_default destroys the block a ball is stuck
+		 * in */
+		if(old_x1 == copy.geometry.x1 && old_y1 == copy.geometry.y1
+				&& old_direction == copy.direction) {
+			cached->end = PATH_UNSURE;
+			break;
+		}
+
+		set_point(&point, &copy);
+		g_array_append_val(cached->points, point);
+	}
+
+	g_free(cells);
+}
+
+/* Notes the block at block_no, if that's in the level and not already being
+ * watched, as it is now */
+static void watch_block(CachedPath *cached, guint8 *cells, Level *level,
+		gint block_no) {
+	WatchedBlock watched;
+
+	if(block_no < 0 || block_no >= level->width * level->height
+			|| cells[block_no] & CELL_WATCHED)
+		return;
+	cells[block_no] |= CELL_WATCHED;
+
+	watched.block_no = block_no;
+	watched.block = level->blocks[block_no];
+	watched.type = watched.block ? watched.block->type : BLOCK_DEAD;
+	g_array_append_val(cached->watched, watched);
+}
+
+static void set_point(PathPoint *point, Ball *ball) {
+	point->x1 = ball->pseudo_x1;
+	point->y1 = ball->pseudo_y1;
+	point->direction = ball->direction;
+	point->speed = ball->speed;
+}
+
+static gboolean at_point(PathPoint *point, Ball *ball) {
+	return point->x1 == ball->pseudo_x1 && point->y1 == ball->pseudo_y1
+		&& point->direction == ball->direction
+		&& point->speed == ball->speed;
+}
+
+static void free_path(CachedPath *cached) {
+	g_array_free(cached->points, TRUE);
+	g_array_free(cached->watched, TRUE);
+	g_free(cached);
+}
@@ -0,0 +1,33 @@
+/*
+ * Predicting where balls will go
+ *
+ * Copyright (c) 2004 Michael Pearson <mipearson@internode.on.net>
+ *
+ * This file is licensed under the GNU General Public License. See the file
+ * "COPYING" for more details.
+ */
+
+/* Why a predicted path stops where it does. PATH_UNSURE means that what the
+ * ball does next can't be known ahead of time: it is about to be sent off in
+ * a random direction, or to set off an exploding block */
+typedef enum { PATH_LINE, PATH_TICKS, PATH_LOST, PATH_UNSURE } PathEnd;
+
+typedef struct {
+	gdouble x1; /* Where the ball's top left will be, as pseudo_x1 */
+	gdouble y1;
+	gdouble direction;
+	gdouble speed;
+} PathPoint;
+
+/* points[i] is where the ball will be after i + 1 more ticks */
+typedef struct {
+	const PathPoint *points;
+	gint num_points;
+	PathEnd end;
+} BallPath;
+
+typedef struct _PathCache PathCache;
+
+gboolean predict_path(Game *game, Ball *ball, gint line_y, gint max_ticks,
+		BallPath *path);
+void destroy_path_cache(Game *game);
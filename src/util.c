@@ -11,6 +11,9 @@
 
 #include "breakout.h"
 #include "gui.h"
+#include "util.h"
+#include <stdlib.h>
+#include <time.h>
 
 void gb_error(gchar *format, ...) {
 	va_list ap;
@@ -44,3 +47,42 @@ void gb_warning(gchar *format, ...) {
 	g_warning(message);
 	g_free(message);
 }
+
+/* Returns a monotonic time in nanoseconds, for timing things */
+gint64 now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (gint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Reads a string of counts like "16,64" into a new GArray of gints. Returns
+ * NULL if the string isn't of that form, or a count is less than 1 */
+GArray *parse_counts(const gchar *string) {
+	GArray *counts;
+	gchar **parts, *end;
+	glong count;
+	gint i, value;
+	gboolean ok = TRUE;
+
+	counts = g_array_new(FALSE, FALSE, sizeof(gint));
+	parts = g_strsplit(string, ",", -1);
+	for(i = 0; parts[i] && ok; i++) {
+		count = strtol(parts[i], &end, 10);
+		if(end == parts[i] || *end || count < 1 || count > G_MAXINT) {
+			ok = FALSE;
+		} else {
+			value = (gint) count;
+			g_array_append_val(counts, value);
+		}
+	}
+	g_strfreev(parts);
+
+	if(!ok || counts->len == 0) {
+		g_array_free(counts, TRUE);
+		return NULL;
+	}
+
+	return counts;
+}
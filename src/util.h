@@ -11,3 +11,5 @@
 
 void gb_error(gchar *format, ...);
 void gb_warning(gchar *format, ...);
+gint64 now_ns(void);
+GArray *parse_counts(const gchar *string);